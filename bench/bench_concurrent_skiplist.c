@@ -0,0 +1,136 @@
+/*
+ * Compares the concurrent skip list against a map behind a mutex, for a mix
+ * of lookups, inserts and removes from 1 up to the given number of threads.
+ *
+ * Usage: bench_concurrent_skiplist [operations per thread] [max threads]
+ *        [lookup percentage]
+ */
+#include <minimalist/concurrent_skiplist.h>
+#include <minimalist/hash.h>
+#include <minimalist/map.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define KEY_RANGE (1 << 20)
+
+struct worker {
+  struct minimalist_concurrent_skiplist *list;
+  struct minimalist_map *map;
+  pthread_mutex_t *lock;
+  size_t operations;
+  unsigned int lookups;
+  uint64_t seed;
+  size_t found;
+};
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const void *
+next_key(struct worker *worker, unsigned int *choice) {
+  uint64_t random = minimalist_hash_u64(worker->seed++);
+  *choice = (unsigned int)(random >> 32) % 100;
+  return (const void *)(uintptr_t)(random % KEY_RANGE + 1);
+}
+
+static void *
+run_skiplist(void *context) {
+  struct worker *worker = context;
+  const void *key = NULL;
+  unsigned int choice = 0;
+
+  for (size_t i = 0; i < worker->operations; i++) {
+    key = next_key(worker, &choice);
+    if (choice < worker->lookups) {
+      worker->found +=
+          minimalist_concurrent_skiplist_contains(worker->list, key);
+    } else if (choice % 2 == 0) {
+      minimalist_concurrent_skiplist_insert(worker->list, key, (void *)key);
+    } else {
+      minimalist_concurrent_skiplist_remove(worker->list, key, NULL);
+    }
+  }
+  return NULL;
+}
+
+static void *
+run_map(void *context) {
+  struct worker *worker = context;
+  const void *key = NULL;
+  unsigned int choice = 0;
+
+  for (size_t i = 0; i < worker->operations; i++) {
+    key = next_key(worker, &choice);
+    pthread_mutex_lock(worker->lock);
+    if (choice < worker->lookups) {
+      worker->found += minimalist_map_contains(worker->map, key);
+    } else if (choice % 2 == 0) {
+      minimalist_map_set(worker->map, key, (void *)key);
+    } else {
+      minimalist_map_remove(worker->map, key, NULL, NULL);
+    }
+    pthread_mutex_unlock(worker->lock);
+  }
+  return NULL;
+}
+
+static double
+measure(void *(*run)(void *), struct worker *workers, unsigned int threads) {
+  pthread_t ids[threads];
+  double start = now();
+
+  for (unsigned int t = 0; t < threads; t++) {
+    pthread_create(&ids[t], NULL, run, &workers[t]);
+  }
+  for (unsigned int t = 0; t < threads; t++) {
+    pthread_join(ids[t], NULL);
+  }
+  return now() - start;
+}
+
+int
+main(int argc, char **argv) {
+  size_t operations = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+  unsigned int max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 8;
+  unsigned int lookups = argc > 3 ? strtoul(argv[3], NULL, 10) : 80;
+  struct worker *workers = calloc(max_threads, sizeof(struct worker));
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  double skiplist = 0, map = 0, total = 0;
+
+  printf("operations per thread: %zu, lookups: %u%%\n", operations, lookups);
+  printf("threads  skiplist Mops/s  locked map Mops/s\n");
+  for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+    struct minimalist_concurrent_skiplist *list =
+        minimalist_concurrent_skiplist_new(NULL);
+    struct minimalist_map *locked = minimalist_map_new(NULL);
+
+    /* Start half full, which the even mix of inserts and removes keeps */
+    for (uintptr_t key = 1; key <= KEY_RANGE; key += 2) {
+      minimalist_concurrent_skiplist_insert(list, (void *)key, (void *)key);
+      minimalist_map_set(locked, (void *)key, (void *)key);
+    }
+    for (unsigned int t = 0; t < threads; t++) {
+      workers[t] = (struct worker){list, locked, &lock, operations, lookups,
+                                   (uint64_t)t << 40, 0};
+    }
+    skiplist = measure(run_skiplist, workers, threads);
+    for (unsigned int t = 0; t < threads; t++) {
+      workers[t].seed = (uint64_t)t << 40;
+    }
+    map = measure(run_map, workers, threads);
+    total = (double)operations * threads / 1e6;
+    printf("%7u  %15.2f  %17.2f\n", threads, total / skiplist, total / map);
+    minimalist_concurrent_skiplist_free(list);
+    minimalist_map_free(locked);
+  }
+  free(workers);
+  return 0;
+}
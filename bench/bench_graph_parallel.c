@@ -0,0 +1,65 @@
+/*
+ * Times the parallel BFS and connected components on a random graph, from 1
+ * up to the given number of threads.
+ *
+ * Usage: bench_graph_parallel [vertices] [average degree] [max threads]
+ *        [directed]
+ */
+#include <minimalist/graph.h>
+#include <minimalist/hash.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char **argv) {
+  uint32_t vertices = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  uint32_t degree = argc > 2 ? strtoul(argv[2], NULL, 10) : 16;
+  unsigned int max_threads = argc > 3 ? strtoul(argv[3], NULL, 10) : 8;
+  int directed = argc > 4 ? atoi(argv[4]) : 0;
+  struct minimalist_graph *graph = minimalist_graph_new(directed);
+  uint32_t *distances = malloc(sizeof(uint32_t) * vertices);
+  uint32_t *labels = malloc(sizeof(uint32_t) * vertices);
+  uint64_t random = 0;
+  uint32_t components = 0;
+  double start = 0, bfs = 0, cc = 0;
+
+  for (uint32_t v = 0; v < vertices; v++) {
+    minimalist_graph_add_vertex(graph, (void *)((uintptr_t)v + 1));
+  }
+  for (uint64_t e = 0; e < (uint64_t)vertices * degree / 2; e++) {
+    random = minimalist_hash_u64(e);
+    minimalist_graph_add_edge_id(graph,
+                                 (uint32_t)(random % vertices),
+                                 (uint32_t)((random >> 32) % vertices));
+  }
+
+  printf("vertices: %u, average degree: %u, %s\n",
+         vertices,
+         degree,
+         directed ? "directed" : "undirected");
+  printf("threads   bfs (s)  components (s)\n");
+  for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+    start = now();
+    minimalist_graph_bfs(graph, 0, distances, threads);
+    bfs = now() - start;
+    start = now();
+    components = minimalist_graph_components(graph, labels, threads);
+    cc = now() - start;
+    printf("%7u  %8.3f  %14.3f\n", threads, bfs, cc);
+  }
+  printf("components: %u\n", components);
+  free(distances);
+  free(labels);
+  minimalist_graph_free(graph);
+  return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Compares minimalist_hash_map_get_many against a loop of single gets.
+ *
+ * Usage: bench_hash_map [entries] [batch]
+ *
+ * Pick enough entries for the table and its chains to exceed the last level
+ * cache, otherwise both variants hit in cache and perform alike.
+ */
+#include <minimalist/hash.h>
+#include <minimalist/hash_map.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOOKUPS (1 << 22)
+
+static int
+compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char **argv) {
+  size_t entries = argc > 1 ? strtoull(argv[1], NULL, 10) : (1 << 23);
+  size_t batch = argc > 2 ? strtoull(argv[2], NULL, 10) : 128;
+  const void **keys = malloc(sizeof(void *) * LOOKUPS);
+  void **values = malloc(sizeof(void *) * LOOKUPS);
+  struct minimalist_hash_map *map = NULL;
+  uintptr_t found = 0;
+  double start = 0, single = 0, many = 0;
+
+  map = minimalist_hash_map_new(
+      entries, minimalist_hash_pointer, compare_pointers);
+  for (size_t i = 1; i <= entries; i++) {
+    minimalist_hash_map_set(map, (void *)i, (void *)(i * 2));
+  }
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    keys[i] = (void *)(uintptr_t)(minimalist_hash_u64(i) % entries + 1);
+  }
+
+  start = now();
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    values[i] = minimalist_hash_map_get(map, keys[i]);
+  }
+  single = now() - start;
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    found += (uintptr_t)values[i];
+  }
+
+  start = now();
+  for (size_t i = 0; i < LOOKUPS; i += batch) {
+    size_t n = LOOKUPS - i < batch ? LOOKUPS - i : batch;
+    minimalist_hash_map_get_many(map, keys + i, n, values + i);
+  }
+  many = now() - start;
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    found -= (uintptr_t)values[i];
+  }
+
+  printf("entries: %zu, batch: %zu, lookups: %d\n", entries, batch, LOOKUPS);
+  printf("get:      %8.2f ns/lookup\n", single * 1e9 / LOOKUPS);
+  printf("get_many: %8.2f ns/lookup\n", many * 1e9 / LOOKUPS);
+  minimalist_hash_map_free(map);
+  free(keys);
+  free(values);
+  return found != 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Compares minimalist_hash_map_build_parallel against a loop of sets.
+ *
+ * Usage: bench_hash_map_build [entries] [threads]
+ */
+#include <minimalist/hash.h>
+#include <minimalist/hash_map.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int
+compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char **argv) {
+  size_t entries = argc > 1 ? strtoull(argv[1], NULL, 10) : (1 << 23);
+  unsigned int threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+  const void **keys = malloc(sizeof(void *) * entries);
+  void **values = malloc(sizeof(void *) * entries);
+  struct minimalist_hash_map *map = NULL;
+  double start = 0, serial = 0, parallel = 0;
+
+  for (size_t i = 0; i < entries; i++) {
+    keys[i] = (void *)(uintptr_t)(minimalist_hash_u64(i) | 1);
+    values[i] = (void *)(i + 1);
+  }
+
+  start = now();
+  map = minimalist_hash_map_new(
+      entries, minimalist_hash_pointer, compare_pointers);
+  for (size_t i = 0; i < entries; i++) {
+    minimalist_hash_map_set(map, keys[i], values[i]);
+  }
+  serial = now() - start;
+  minimalist_hash_map_free(map);
+
+  start = now();
+  map = minimalist_hash_map_build_parallel(entries,
+                                           minimalist_hash_pointer,
+                                           compare_pointers,
+                                           keys,
+                                           values,
+                                           entries,
+                                           threads);
+  parallel = now() - start;
+  minimalist_hash_map_free(map);
+
+  printf("entries: %zu, threads: %u\n", entries, threads);
+  printf("set loop:       %8.3f s\n", serial);
+  printf("build_parallel: %8.3f s\n", parallel);
+  free(keys);
+  free(values);
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Measures the memory and time per entry of the ordered and hashed maps.
+ *
+ * Usage: bench_map_memory [map|set|hash_map|dict] [entries]
+ *
+ * Memory is the growth of the peak resident set size, so run one structure
+ * per process.
+ */
+#include <minimalist/dict.h>
+#include <minimalist/hash.h>
+#include <minimalist/hash_map.h>
+#include <minimalist/map.h>
+#include <minimalist/set.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static int
+compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double
+peak_bytes(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024.0;
+#endif
+}
+
+int
+main(int argc, char **argv) {
+  const char *kind = argc > 1 ? argv[1] : "map";
+  size_t entries = argc > 2 ? strtoull(argv[2], NULL, 10) : 1000000;
+  double before = 0, start = 0, elapsed = 0, after = 0;
+  void *key = NULL;
+
+  before = peak_bytes();
+  start = now();
+  if (strcmp(kind, "map") == 0) {
+    struct minimalist_map *map = minimalist_map_new(NULL);
+    for (size_t i = 0; i < entries; i++) {
+      key = (void *)(uintptr_t)minimalist_hash_u64(i);
+      minimalist_map_set(map, key, key);
+    }
+    elapsed = now() - start;
+    after = peak_bytes();
+    minimalist_map_free(map);
+  } else if (strcmp(kind, "set") == 0) {
+    struct minimalist_set *set = minimalist_set_new(NULL);
+    for (size_t i = 0; i < entries; i++) {
+      minimalist_set_add(set, (void *)(uintptr_t)minimalist_hash_u64(i));
+    }
+    elapsed = now() - start;
+    after = peak_bytes();
+    minimalist_set_free(set);
+  } else if (strcmp(kind, "hash_map") == 0) {
+    struct minimalist_hash_map *map = minimalist_hash_map_new(
+        entries, minimalist_hash_pointer, compare_pointers);
+    for (size_t i = 0; i < entries; i++) {
+      key = (void *)(uintptr_t)minimalist_hash_u64(i);
+      minimalist_hash_map_set(map, key, key);
+    }
+    elapsed = now() - start;
+    after = peak_bytes();
+    minimalist_hash_map_free(map);
+  } else if (strcmp(kind, "dict") == 0) {
+    struct minimalist_dict *dict =
+        minimalist_dict_new(minimalist_hash_pointer, compare_pointers);
+    for (size_t i = 0; i < entries; i++) {
+      key = (void *)(uintptr_t)minimalist_hash_u64(i);
+      minimalist_dict_set(dict, key, key);
+    }
+    elapsed = now() - start;
+    after = peak_bytes();
+    minimalist_dict_free(dict);
+  } else {
+    fprintf(stderr, "unknown structure: %s\n", kind);
+    return 1;
+  }
+
+  printf("%s, entries: %zu\n", kind, entries);
+  printf("memory: %8.2f bytes/entry\n", (after - before) / entries);
+  printf("insert: %8.2f ns/entry\n", elapsed * 1e9 / entries);
+  return 0;
+}
@@ -0,0 +1,138 @@
+#ifndef __MINIMALIST_ART_H__
+#define __MINIMALIST_ART_H__
+/**
+ * @file art.h
+ * @brief An adaptive radix tree over byte-string keys
+ *
+ * Keys are ordered by their bytes, shorter keys before longer keys sharing the
+ * same prefix. Lookups take time proportional to the key length, not to the
+ * number of keys. Keys are copied into the tree; values are not.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief An adaptive radix tree
+ */
+struct minimalist_art;
+
+/**
+ * @brief A run callback
+ */
+typedef void (*minimalist_art_run_fn)(void *context,
+                                      const void *key,
+                                      size_t key_len,
+                                      void *value);
+
+/**
+ * @brief Creates a new adaptive radix tree
+ *
+ * @return An empty tree, or NULL on allocation failure
+ */
+struct minimalist_art *minimalist_art_new(void);
+
+/**
+ * @brief Frees a tree and its copies of the keys
+ *
+ * @param art Tree to free
+ */
+void minimalist_art_free(struct minimalist_art *art);
+
+/**
+ * @brief Sets an element in a tree.
+ *
+ * A NULL value is stored like any other. Use minimalist_art_remove() to
+ * remove an element.
+ *
+ * @param art The tree on which to operate.
+ * @param key The key bytes.
+ * @param key_len The number of key bytes.
+ * @param value The value of the element.
+ */
+void minimalist_art_set(struct minimalist_art *art,
+                        const void *key,
+                        size_t key_len,
+                        void *value);
+
+/**
+ * @brief Gets element in a tree
+ *
+ * @param art The tree to search
+ * @param key The key bytes.
+ * @param key_len The number of key bytes.
+ *
+ * @return The element, if found. Otherwise, NULL.
+ */
+void *
+minimalist_art_get(struct minimalist_art *art, const void *key, size_t key_len);
+
+/**
+ * @brief Removes an element from a tree
+ *
+ * @param art The tree on which to operate.
+ * @param key The key bytes.
+ * @param key_len The number of key bytes.
+ *
+ * @return 1 if an element was removed, 0 if there was none
+ */
+int minimalist_art_remove(struct minimalist_art *art,
+                          const void *key,
+                          size_t key_len);
+
+/**
+ * @brief Tests whether a tree has an element, even one with a NULL value
+ *
+ * @param art The tree to search
+ * @param key The key bytes.
+ * @param key_len The number of key bytes.
+ *
+ * @return 1 if the element exists, 0 otherwise
+ */
+int minimalist_art_contains(struct minimalist_art *art,
+                            const void *key,
+                            size_t key_len);
+
+/**
+ * @brief Returns the number of elements in a tree
+ *
+ * @param art The tree
+ */
+size_t minimalist_art_size(struct minimalist_art *art);
+
+/**
+ * @brief Runs function on each element in key order
+ *
+ * @param art The tree
+ * @param run The function to run on the elements
+ * @param context A context for function
+ */
+void minimalist_art_run(struct minimalist_art *art,
+                        minimalist_art_run_fn run,
+                        void *context);
+
+/**
+ * @brief Runs function, in key order, on each element whose key starts with a
+ * prefix
+ *
+ * @param art The tree
+ * @param prefix The prefix bytes
+ * @param prefix_len The number of prefix bytes
+ * @param run The function to run on the elements
+ * @param context A context for function
+ */
+void minimalist_art_run_prefix(struct minimalist_art *art,
+                               const void *prefix,
+                               size_t prefix_len,
+                               minimalist_art_run_fn run,
+                               void *context);
+
+/**
+ * @brief Encodes an integer as a key that sorts in numeric order
+ *
+ * @param value The integer
+ * @param key Receives the 8 key bytes, most significant first
+ */
+void minimalist_art_key_u64(uint64_t value, unsigned char key[8]);
+
+#endif /* __MINIMALIST_ART_H__ */
@@ -0,0 +1,100 @@
+#ifndef __MINIMALIST_BLOOM_FILTER_H__
+#define __MINIMALIST_BLOOM_FILTER_H__
+/**
+ * @file bloom_filter.h
+ * @brief A cache-line blocked Bloom filter
+ *
+ * All bits of an element are set in the same 64 byte block, so a lookup
+ * touches a single cache line. A filter can be used on its own or attached to
+ * a hash map or set to reject most lookups of missing keys early.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A blocked Bloom filter
+ */
+struct minimalist_bloom_filter;
+
+/**
+ * @brief Creates a new, empty filter
+ *
+ * @param expected Number of elements the filter is sized for
+ * @param false_positive_rate Target false positive rate at that size
+ *
+ * @return A filter, or NULL on allocation failure
+ */
+struct minimalist_bloom_filter *
+minimalist_bloom_filter_new(size_t expected, double false_positive_rate);
+
+/**
+ * @brief Frees a filter
+ *
+ * @param filter The filter
+ */
+void minimalist_bloom_filter_free(struct minimalist_bloom_filter *filter);
+
+/**
+ * @brief Removes all elements from a filter
+ *
+ * @param filter The filter
+ */
+void minimalist_bloom_filter_clear(struct minimalist_bloom_filter *filter);
+
+/**
+ * @brief Adds an element by its hash
+ *
+ * @param filter The filter
+ * @param hash Hash of the element
+ */
+void minimalist_bloom_filter_add_hash(struct minimalist_bloom_filter *filter,
+                                      uint64_t hash);
+
+/**
+ * @brief Tests for an element by its hash
+ *
+ * @param filter The filter
+ * @param hash Hash of the element
+ *
+ * @retval 1 if the element may be in the filter
+ * @retval 0 if the element is definitely not in the filter
+ */
+int minimalist_bloom_filter_contains_hash(
+    struct minimalist_bloom_filter *filter, uint64_t hash);
+
+/**
+ * @brief Prefetches the block an element's hash maps to
+ *
+ * @param filter The filter
+ * @param hash Hash of the element
+ */
+void minimalist_bloom_filter_prefetch(struct minimalist_bloom_filter *filter,
+                                      uint64_t hash);
+
+/**
+ * @brief Adds a byte string
+ *
+ * @param filter The filter
+ * @param data The bytes
+ * @param len Number of bytes
+ */
+void minimalist_bloom_filter_add(struct minimalist_bloom_filter *filter,
+                                 const void *data,
+                                 size_t len);
+
+/**
+ * @brief Tests for a byte string
+ *
+ * @param filter The filter
+ * @param data The bytes
+ * @param len Number of bytes
+ *
+ * @retval 1 if the bytes may be in the filter
+ * @retval 0 if the bytes are definitely not in the filter
+ */
+int minimalist_bloom_filter_contains(struct minimalist_bloom_filter *filter,
+                                     const void *data,
+                                     size_t len);
+
+#endif /* __MINIMALIST_BLOOM_FILTER_H__ */
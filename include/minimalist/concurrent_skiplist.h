@@ -0,0 +1,153 @@
+#ifndef __MINIMALIST_CONCURRENT_SKIPLIST_H__
+#define __MINIMALIST_CONCURRENT_SKIPLIST_H__
+/**
+ * @file concurrent_skiplist.h
+ * @brief An ordered map that threads can share without locks
+ *
+ * A lock-free skip list. Lookups never write and never wait. Inserts and
+ * removals retry only when another thread changed the same spot. A removal
+ * first marks the element, which hides it from every operation, and then
+ * unlinks it. Unlinked elements are freed once no thread can still be
+ * reading them, which is tracked with epochs: each operation registers the
+ * epoch it started in, and elements are freed two epochs after their
+ * removal.
+ *
+ * Elements are ordered as in minimalist_map, using the same compare
+ * callback.
+ */
+
+#include <minimalist/types.h>
+
+#include <stddef.h>
+
+/**
+ * @brief A concurrent skip list
+ */
+struct minimalist_concurrent_skiplist;
+
+/**
+ * @brief A run callback, returning nonzero to stop the run
+ */
+typedef int (*minimalist_concurrent_skiplist_run_fn)(void *context,
+                                                     const void *key,
+                                                     void *value);
+
+/**
+ * @brief Creates a new, empty skip list
+ *
+ * If compare is NULL, the addresses are compared.
+ *
+ * @param compare The comparison method used for keys
+ *
+ * @return A skip list, or NULL on allocation failure
+ */
+struct minimalist_concurrent_skiplist *
+minimalist_concurrent_skiplist_new(minimalist_const_compare_fn compare);
+
+/**
+ * @brief Frees a skip list
+ *
+ * No other thread may be using the skip list.
+ *
+ * @param list The skip list
+ */
+void minimalist_concurrent_skiplist_free(
+    struct minimalist_concurrent_skiplist *list);
+
+/**
+ * @brief Adds an element unless its key is already present
+ *
+ * @param list The skip list
+ * @param key The key of the element
+ * @param value The value of the element
+ *
+ * @return 1 if the element was added, 0 if the key was present, or -1 on
+ * allocation failure
+ */
+int minimalist_concurrent_skiplist_insert(
+    struct minimalist_concurrent_skiplist *list,
+    const void *key,
+    void *value);
+
+/**
+ * @brief Sets an element, replacing the value of a present key
+ *
+ * @param list The skip list
+ * @param key The key of the element
+ * @param value The value of the element
+ *
+ * @return 1 if the element was added, 0 if its value was replaced, or -1 on
+ * allocation failure
+ */
+int minimalist_concurrent_skiplist_set(
+    struct minimalist_concurrent_skiplist *list,
+    const void *key,
+    void *value);
+
+/**
+ * @brief Gets an element
+ *
+ * @param list The skip list
+ * @param key The key of the element
+ *
+ * @return The value, if found. Otherwise, NULL.
+ */
+void *minimalist_concurrent_skiplist_get(
+    struct minimalist_concurrent_skiplist *list, const void *key);
+
+/**
+ * @brief Tests whether a skip list has an element, even one with a NULL value
+ *
+ * @param list The skip list
+ * @param key The key of the element
+ *
+ * @return 1 if the element exists, 0 otherwise
+ */
+int minimalist_concurrent_skiplist_contains(
+    struct minimalist_concurrent_skiplist *list, const void *key);
+
+/**
+ * @brief Removes an element
+ *
+ * @param list The skip list
+ * @param key The key of the element
+ * @param old_value If not NULL, receives the value of the removed element
+ *
+ * @return 1 if an element was removed, 0 if there was none
+ */
+int minimalist_concurrent_skiplist_remove(
+    struct minimalist_concurrent_skiplist *list,
+    const void *key,
+    void **old_value);
+
+/**
+ * @brief Returns the number of elements
+ *
+ * While other threads modify the skip list, the count may be off by the
+ * operations still in progress.
+ *
+ * @param list The skip list
+ */
+size_t minimalist_concurrent_skiplist_size(
+    struct minimalist_concurrent_skiplist *list);
+
+/**
+ * @brief Runs a function on the elements in order, from a key on
+ *
+ * The run is weakly consistent: it visits every element present for all of
+ * it, may or may not visit elements added or removed meanwhile, and never
+ * visits a key twice or out of order. The function may use the skip list.
+ *
+ * @param list The skip list
+ * @param from The first key to visit, or NULL to start with the first
+ * element
+ * @param run The function to run on the elements, returning nonzero to stop
+ * @param context A context for function
+ */
+void minimalist_concurrent_skiplist_run(
+    struct minimalist_concurrent_skiplist *list,
+    const void *from,
+    minimalist_concurrent_skiplist_run_fn run,
+    void *context);
+
+#endif /* __MINIMALIST_CONCURRENT_SKIPLIST_H__ */
@@ -0,0 +1,96 @@
+#ifndef __MINIMALIST_DICT_H__
+#define __MINIMALIST_DICT_H__
+/**
+ * @file dict.h
+ * @brief An insertion-ordered hash map with a compact layout
+ *
+ * Entries are stored in a dense array in insertion order and found through a
+ * small open-addressed index of 8, 16, 32 or 64-bit entry numbers, the
+ * narrowest that fits. Iterating is a linear scan of the entries. Removed
+ * entries are left as holes that are compacted away as the dict grows or
+ * once they make up half of the array.
+ */
+
+#include <minimalist/types.h>
+
+#include <stddef.h>
+
+/**
+ * @brief An insertion-ordered hash map
+ */
+struct minimalist_dict;
+
+/**
+ * @brief A run callback
+ */
+typedef void (*minimalist_dict_run_fn)(void *context,
+                                       const void *key,
+                                       void *value);
+
+/**
+ * @brief Creates a new, empty dict
+ *
+ * @param hash The hash function used for keys
+ * @param compare The comparison function used for keys, returning 0 for
+ * equal keys
+ *
+ * @return A dict, or NULL if hash or compare is missing or on allocation
+ * failure
+ */
+struct minimalist_dict *
+minimalist_dict_new(minimalist_hash_fn hash,
+                    minimalist_const_compare_fn compare);
+
+/**
+ * @brief Frees a dict
+ *
+ * @param dict Dict to free
+ */
+void minimalist_dict_free(struct minimalist_dict *dict);
+
+/**
+ * @brief Sets an element in a dict
+ *
+ * A new key goes after all others. Replacing the value of an existing key
+ * keeps its position. Setting the value to NULL removes any previously set
+ * element.
+ *
+ * @param dict The dict on which to operate.
+ * @param key The key of the element.
+ * @param value The value of the element.
+ */
+void minimalist_dict_set(struct minimalist_dict *dict,
+                         const void *key,
+                         void *value);
+
+/**
+ * @brief Gets element in a dict
+ *
+ * @param dict The dict to search
+ * @param key The key of the element to get
+ *
+ * @return The element, if found. Otherwise, NULL.
+ */
+void *minimalist_dict_get(struct minimalist_dict *dict, const void *key);
+
+/**
+ * @brief Returns the number of elements in a dict
+ *
+ * @param dict The dict
+ */
+size_t minimalist_dict_size(struct minimalist_dict *dict);
+
+/**
+ * @brief Runs function on each element in insertion order
+ *
+ * The function must not modify the dict.
+ *
+ * @param dict The dict
+ * @param run The function to run on the elements
+ * @param context A context for function
+ */
+void minimalist_dict_run(struct minimalist_dict *dict,
+                         minimalist_dict_run_fn run,
+                         void *context);
+
+#endif /* __MINIMALIST_DICT_H__ */
@@ -3,11 +3,32 @@
 /**
  * @file graph.h
  * @brief A graph implementation using adjacency lists
+ *
+ * Vertices are arbitrary pointers. Each distinct pointer is interned into a
+ * dense ID, assigned in insertion order from 0, which indexes the adjacency
+ * lists. Algorithms can keep per-vertex state in plain arrays of
+ * minimalist_graph_num_vertices() entries.
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Returned by the ID functions for a missing vertex */
+#define MINIMALIST_GRAPH_INVALID ((uint32_t)-1)
+
 /** @brief A graph **/
 struct minimalist_graph;
 
+/** @brief Edge list file formats read by minimalist_graph_load() */
+enum minimalist_graph_format {
+  /** Lines of two decimal IDs, with # or % starting comment lines */
+  MINIMALIST_GRAPH_TEXT,
+  /** Pairs of native-endian 32-bit IDs */
+  MINIMALIST_GRAPH_U32,
+  /** Pairs of native-endian 64-bit IDs */
+  MINIMALIST_GRAPH_U64
+};
+
 /** @brief List of neighbors */
 typedef void **minimalist_graph_neighbor_list_t;
 
@@ -43,14 +64,289 @@ void
 minimalist_graph_add_edge(struct minimalist_graph *graph, void *a, void *b);
 
 /**
- * @brief Get all neighbors of a NULL.
+ * @brief Adds an edge unless it would close a cycle
+ *
+ * For undirected graphs, an edge closes a cycle if its ends are already
+ * connected, which is answered in near constant time by a union-find. For
+ * directed graphs, it closes a cycle if b reaches a, which is answered by
+ * maintaining a topological order that only gets searched and updated
+ * between a and b. Both are set up by the first call and then kept up to
+ * date by every edge added. Unchecked edges that close a directed cycle make
+ * later checks fall back to a full search.
+ *
+ * Vertices are added even if the edge isn't.
+ *
+ * @param graph Graph
+ * @param a First node to connect
+ * @param b Second node to connect
+ *
+ * @return 1 if the edge was added, 0 if it would have closed a cycle or is
+ * already in a graph with unique edges, or -1 on allocation failure
+ */
+int minimalist_graph_try_add_edge(struct minimalist_graph *graph,
+                                  void *a,
+                                  void *b);
+
+/**
+ * @brief Get all neighbors of a node.
  *
  * @return NULL if node doesn't exist, otherwise a NULL terminated list of
- * pointers to neighbor nodes.
+ * pointers to neighbor nodes. The list must be freed with free().
  */
 minimalist_graph_neighbor_list_t
 minimalist_graph_get_neighbors(struct minimalist_graph *graph, void *node);
 
+/**
+ * @brief Adds a vertex to the graph
+ *
+ * @param graph Graph
+ * @param vertex The vertex
+ *
+ * @return The ID of the vertex, whether it was added now or before, or
+ * MINIMALIST_GRAPH_INVALID on allocation failure
+ */
+uint32_t minimalist_graph_add_vertex(struct minimalist_graph *graph,
+                                     void *vertex);
+
+/**
+ * @brief Gets the ID of a vertex
+ *
+ * @param graph Graph
+ * @param vertex The vertex
+ *
+ * @return The ID, or MINIMALIST_GRAPH_INVALID if vertex isn't in the graph
+ */
+uint32_t minimalist_graph_vertex_id(struct minimalist_graph *graph,
+                                    const void *vertex);
+
+/**
+ * @brief Gets the vertex with an ID
+ *
+ * @param graph Graph
+ * @param id The ID
+ *
+ * @return The vertex, or NULL if the ID isn't in use
+ */
+void *minimalist_graph_vertex(struct minimalist_graph *graph, uint32_t id);
+
+/**
+ * @brief Returns the number of vertices, which is one past the highest ID
+ *
+ * @param graph Graph
+ */
+uint32_t minimalist_graph_num_vertices(struct minimalist_graph *graph);
+
+/**
+ * @brief Adds an edge between two vertex IDs
+ *
+ * If the graph is directed, the direction is a to b. Unknown IDs are ignored.
+ *
+ * @param graph Graph
+ * @param a ID of the first vertex
+ * @param b ID of the second vertex
+ */
+void minimalist_graph_add_edge_id(struct minimalist_graph *graph,
+                                  uint32_t a,
+                                  uint32_t b);
+
+/**
+ * @brief Adds an edge between two vertex IDs unless it would close a cycle
+ *
+ * See minimalist_graph_try_add_edge().
+ *
+ * @param graph Graph
+ * @param a ID of the first vertex
+ * @param b ID of the second vertex
+ *
+ * @return 1 if the edge was added, 0 if it would have closed a cycle or is
+ * already in a graph with unique edges, or -1 if an ID is unknown or on
+ * allocation failure
+ */
+int minimalist_graph_try_add_edge_id(struct minimalist_graph *graph,
+                                     uint32_t a,
+                                     uint32_t b);
+
+/**
+ * @brief Sets whether edges are kept unique
+ *
+ * While set, adding an edge that is already in the graph does nothing, and
+ * minimalist_graph_try_add_edge() returns 0 for it. Duplicate edges added
+ * before are kept. Unset by default.
+ *
+ * @param graph Graph
+ * @param unique Whether edges are kept unique
+ */
+void minimalist_graph_set_unique_edges(struct minimalist_graph *graph,
+                                       int unique);
+
+/**
+ * @brief Checks whether the graph has an edge
+ *
+ * Vertices with many neighbors keep them indexed, so this takes constant
+ * time for them. Other lists are scanned, or binary searched if they were
+ * loaded by minimalist_graph_load() and haven't changed since.
+ *
+ * @param graph Graph
+ * @param a First node
+ * @param b Second node
+ *
+ * @return 1 if the edge from a to b, or between a and b if the graph is
+ * undirected, is in the graph, otherwise 0
+ */
+int minimalist_graph_has_edge(struct minimalist_graph *graph,
+                              const void *a,
+                              const void *b);
+
+/**
+ * @brief Checks whether the graph has an edge between two vertex IDs
+ *
+ * See minimalist_graph_has_edge().
+ *
+ * @param graph Graph
+ * @param a ID of the first vertex
+ * @param b ID of the second vertex
+ *
+ * @return 1 if the edge is in the graph, or 0 if it isn't or an ID is unknown
+ */
+int minimalist_graph_has_edge_id(struct minimalist_graph *graph,
+                                 uint32_t a,
+                                 uint32_t b);
+
+/**
+ * @brief Removes an edge from the graph
+ *
+ * Removes one copy of the edge if it was added more than once. The last
+ * neighbor of a vertex takes the place of the removed one, so neighbor
+ * orders may change. Both vertices stay in the graph.
+ *
+ * @param graph Graph
+ * @param a First node
+ * @param b Second node
+ *
+ * @return 1 if the edge was removed, 0 if it wasn't in the graph, or -1 on
+ * allocation failure
+ */
+int minimalist_graph_remove_edge(struct minimalist_graph *graph,
+                                 const void *a,
+                                 const void *b);
+
+/**
+ * @brief Removes an edge between two vertex IDs
+ *
+ * See minimalist_graph_remove_edge().
+ *
+ * @param graph Graph
+ * @param a ID of the first vertex
+ * @param b ID of the second vertex
+ *
+ * @return 1 if the edge was removed, 0 if it wasn't in the graph or an ID is
+ * unknown, or -1 on allocation failure
+ */
+int minimalist_graph_remove_edge_id(struct minimalist_graph *graph,
+                                    uint32_t a,
+                                    uint32_t b);
+
+/**
+ * @brief Gets the neighbor IDs of a vertex
+ *
+ * @param graph Graph
+ * @param id ID of the vertex
+ * @param neighbors Receives the neighbor IDs, which stay valid until the
+ * graph is next modified
+ *
+ * @return The number of neighbors
+ */
+uint32_t minimalist_graph_get_neighbor_ids(struct minimalist_graph *graph,
+                                           uint32_t id,
+                                           const uint32_t **neighbors);
+
+/**
+ * @brief Loads a graph from an edge list file
+ *
+ * The file is mapped into memory and parsed by up to threads threads, each
+ * taking a chunk of at least a megabyte. Every vertex ID in the file becomes
+ * the vertex with the same ID, up to the highest one, and is represented by
+ * the pointer value ID + 1. Each vertex's neighbors are sorted by ID, so the
+ * result doesn't depend on the number of threads. The neighbors share a
+ * single allocation, which a list leaves when an edge is added to it.
+ *
+ * @param path Path of the file
+ * @param format Format of the file
+ * @param directed Whether graph is directed
+ * @param threads Number of threads to use, or 0 for one per online CPU
+ *
+ * @return A graph, or NULL with errno set on failure. errno is EINVAL if the
+ * file isn't a valid edge list or has an ID of MINIMALIST_GRAPH_INVALID or
+ * more.
+ */
+struct minimalist_graph *
+minimalist_graph_load(const char *path,
+                      enum minimalist_graph_format format,
+                      int directed,
+                      unsigned int threads);
+
+/**
+ * @brief Finds the distance of every vertex from a source, in parallel
+ *
+ * A level-synchronous BFS that switches to scanning unvisited vertices for a
+ * parent once the frontier grows large, and back once it shrinks. Threads
+ * share the work of each level through a work-stealing pool. The result
+ * doesn't depend on the number of threads. The graph must not be modified
+ * meanwhile.
+ *
+ * @param graph Graph
+ * @param source ID of the source vertex
+ * @param distances Receives, for every vertex ID, the number of edges from
+ * source, or MINIMALIST_GRAPH_INVALID if it can't be reached
+ * @param threads Number of threads to use, or 0 for one per online CPU
+ *
+ * @return 0 on success, or -1 if source is unknown or on allocation failure
+ */
+int minimalist_graph_bfs(struct minimalist_graph *graph,
+                         uint32_t source,
+                         uint32_t *distances,
+                         unsigned int threads);
+
+/**
+ * @brief Finds the vertices reachable from any of a set of sources
+ *
+ * Runs the BFS of minimalist_graph_bfs() from all sources at once. Unknown
+ * sources are ignored.
+ *
+ * @param graph Graph
+ * @param sources IDs of the source vertices
+ * @param num_sources Number of sources
+ * @param reached If not NULL, receives 1 for every vertex ID reached and 0
+ * for the others
+ * @param threads Number of threads to use, or 0 for one per online CPU
+ *
+ * @return The number of vertices reached, sources included, or
+ * MINIMALIST_GRAPH_INVALID on allocation failure
+ */
+uint32_t minimalist_graph_reachable(struct minimalist_graph *graph,
+                                    const uint32_t *sources,
+                                    size_t num_sources,
+                                    unsigned char *reached,
+                                    unsigned int threads);
+
+/**
+ * @brief Finds the connected components, in parallel
+ *
+ * Components of directed graphs ignore the direction of edges. Every vertex
+ * is labeled with the lowest ID in its component, whatever the number of
+ * threads. The graph must not be modified meanwhile.
+ *
+ * @param graph Graph
+ * @param labels Receives the label of every vertex ID
+ * @param threads Number of threads to use, or 0 for one per online CPU
+ *
+ * @return The number of components, or MINIMALIST_GRAPH_INVALID on
+ * allocation failure
+ */
+uint32_t minimalist_graph_components(struct minimalist_graph *graph,
+                                     uint32_t *labels,
+                                     unsigned int threads);
+
 /**
  * @brief Gets list of paths between two nodes.
  */
@@ -60,6 +356,9 @@ minimalist_graph_path_list_t minimalist_graph_get_paths(
 /**
  * @brief Test if graph is cyclic
  *
+ * For undirected graphs, parallel edges between two vertices and loops are
+ * cycles, as they are for minimalist_graph_try_add_edge().
+ *
  * @param graph
  */
 int minimalist_graph_cyclic(struct minimalist_graph *graph);
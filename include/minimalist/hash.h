@@ -0,0 +1,69 @@
+#ifndef __MINIMALIST_HASH_H__
+#define __MINIMALIST_HASH_H__
+/**
+ * @file hash.h
+ * @brief Fast, general purpose hash functions
+ *
+ * The integer mixers are bijective, so distinct inputs never collide. The
+ * byte-string hash is a wyhash-style design for short inputs with a wide,
+ * multi-lane accumulator loop for long inputs.
+ *
+ * @note Results depend on the byte order of the host and are not meant to be
+ * stable across architectures.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Mixes a 32-bit integer
+ *
+ * @param x Value to mix
+ *
+ * @return A well distributed 32-bit hash of x
+ */
+uint32_t minimalist_hash_u32(uint32_t x);
+
+/**
+ * @brief Mixes a 64-bit integer
+ *
+ * @param x Value to mix
+ *
+ * @return A well distributed 64-bit hash of x
+ */
+uint64_t minimalist_hash_u64(uint64_t x);
+
+/**
+ * @brief Hashes a sequence of bytes
+ *
+ * @param data Bytes to hash
+ * @param len Number of bytes
+ * @param seed Seed to start from
+ *
+ * @return A 64-bit hash of data
+ */
+uint64_t minimalist_hash_bytes(const void *data, size_t len, uint64_t seed);
+
+/**
+ * @brief Hashes a pointer by its address
+ *
+ * Suitable as a minimalist_hash_map_hash_fn for pointer-identity keys.
+ *
+ * @param ptr Pointer to hash
+ *
+ * @return Hash of the address
+ */
+size_t minimalist_hash_pointer(const void *ptr);
+
+/**
+ * @brief Hashes a NUL-terminated string
+ *
+ * Suitable as a minimalist_hash_map_hash_fn for string keys.
+ *
+ * @param str String to hash
+ *
+ * @return Hash of the string contents
+ */
+size_t minimalist_hash_string(const void *str);
+
+#endif /* __MINIMALIST_HASH_H__ */
@@ -12,6 +12,8 @@
  */
 struct minimalist_hash_map;
 
+struct minimalist_bloom_filter;
+
 /**
  * @brief A function pointer to a hash function
  */
@@ -22,14 +24,56 @@ typedef size_t (*minimalist_hash_map_hash_fn)(const void *);
  */
 typedef int (*minimalist_hash_map_compare_fn)(const void *, const void *);
 
+/**
+ * @brief A run callback
+ */
+typedef void (*minimalist_hash_map_run_fn)(void *context,
+                                           const void *key,
+                                           void *value);
+
 /**
  * @brief Creates a new hash map
+ *
+ * @param buckets Number of buckets, rounded up to a power of two
+ * @param hash The hash function used for keys
+ * @param compare The comparison function used for keys
+ *
+ * @return A hash map, or NULL if hash or compare is missing
  */
 struct minimalist_hash_map *
 minimalist_hash_map_new(size_t buckets,
                         minimalist_hash_map_hash_fn hash,
                         minimalist_hash_map_compare_fn compare);
 
+/**
+ * @brief Builds a hash map from arrays of keys and values using several
+ * threads
+ *
+ * The entries are hashed in parallel, partitioned by bucket range and linked
+ * into their buckets with each thread owning disjoint ranges, so no locks are
+ * taken. All entries come from a single allocation. The result is the same as
+ * setting the entries in order: a repeated key keeps its last value.
+ *
+ * @param buckets Number of buckets, rounded up to a power of two, or 0 for n
+ * @param hash The hash function used for keys
+ * @param compare The comparison function used for keys
+ * @param keys The keys
+ * @param values The values, none of which may be NULL
+ * @param n Number of entries
+ * @param threads Number of threads, or 0 for one per online processor
+ *
+ * @return A hash map, or NULL if hash or compare is missing or on allocation
+ * failure
+ */
+struct minimalist_hash_map *
+minimalist_hash_map_build_parallel(size_t buckets,
+                                   minimalist_hash_map_hash_fn hash,
+                                   minimalist_hash_map_compare_fn compare,
+                                   const void *const *keys,
+                                   void *const *values,
+                                   size_t n,
+                                   unsigned int threads);
+
 /**
  * @brief Frees the hash map
  */
@@ -56,4 +100,90 @@ void minimalist_hash_map_set(struct minimalist_hash_map *map,
  */
 void *minimalist_hash_map_get(struct minimalist_hash_map *map, const void *key);
 
+/**
+ * @brief Finds or adds an entry with a single lookup
+ *
+ * An added entry starts with a NULL value, which the caller can set through
+ * the returned slot. Until then, get returns NULL for it but contains
+ * doesn't.
+ *
+ * @param map
+ * @param key
+ * @param inserted If not NULL, set to whether the entry was added
+ *
+ * @return The value slot of the entry, valid until the entry is removed, or
+ * NULL on allocation failure
+ */
+void **minimalist_hash_map_upsert(struct minimalist_hash_map *map,
+                                  const void *key,
+                                  int *inserted);
+
+/**
+ * @brief Removes an entry
+ *
+ * @param map
+ * @param key
+ * @param old_key If not NULL, receives the key of the removed entry
+ * @param old_value If not NULL, receives the value of the removed entry
+ *
+ * @return 1 if an entry was removed, 0 if there was none
+ */
+int minimalist_hash_map_remove(struct minimalist_hash_map *map,
+                               const void *key,
+                               const void **old_key,
+                               void **old_value);
+
+/**
+ * @brief Tests whether an entry exists, even one with a NULL value
+ *
+ * @param map
+ * @param key
+ *
+ * @return 1 if the entry exists, 0 otherwise
+ */
+int minimalist_hash_map_contains(struct minimalist_hash_map *map,
+                                 const void *key);
+
+/**
+ * @brief Gets several hash map entries at once
+ *
+ * Hashes the keys in groups and prefetches their buckets and chain heads
+ * before resolving them, so the cache misses of different keys overlap.
+ *
+ * @param map
+ * @param keys Keys to look up
+ * @param n Number of keys
+ * @param values Receives the value stored for each key, or NULL.
+ */
+void minimalist_hash_map_get_many(struct minimalist_hash_map *map,
+                                  const void *const *keys,
+                                  size_t n,
+                                  void **values);
+
+/**
+ * @brief Runs function on each entry in the hash map
+ *
+ * Entries are visited in no particular order.
+ *
+ * @param map The hash map
+ * @param run The function to run on the entries
+ * @param context A context for function
+ */
+void minimalist_hash_map_run(struct minimalist_hash_map *map,
+                             minimalist_hash_map_run_fn run,
+                             void *context);
+
+/**
+ * @brief Attaches a filter that rejects lookups of missing keys early
+ *
+ * The filter is filled with the hashes of all current keys and every key
+ * added later. Removed keys stay in the filter and only cost a full lookup.
+ * The map doesn't take ownership of the filter.
+ *
+ * @param map The hash map
+ * @param filter The filter, or NULL to detach the current one
+ */
+void minimalist_hash_map_attach_filter(struct minimalist_hash_map *map,
+                                       struct minimalist_bloom_filter *filter);
+
 #endif /* __MINIMALIST_HASH_MAP_H__ */
@@ -0,0 +1,126 @@
+#ifndef __MINIMALIST_HEAP_H__
+#define __MINIMALIST_HEAP_H__
+/**
+ * @file heap.h
+ * @brief An indexed d-ary heap priority queue
+ *
+ * Values are kept in one contiguous array laid out as a d-ary heap. Every
+ * pushed value gets a handle that stays valid until the value is popped, so
+ * its priority can be changed in O(log n).
+ */
+
+#include <minimalist/types.h>
+
+#include <stddef.h>
+
+/** @brief Returned by minimalist_heap_push on failure */
+#define MINIMALIST_HEAP_INVALID ((size_t)-1)
+
+/**
+ * @brief A priority queue
+ */
+struct minimalist_heap;
+
+/**
+ * @brief Creates a new heap
+ *
+ * compare follows the same convention as minimalist_map_new(): values pop in
+ * the order minimalist_map_run() would visit them as keys of a map with the
+ * same compare, so compare(a, b) > 0 pops a before b. If compare is NULL,
+ * the lowest address pops first.
+ *
+ * @param arity Number of children per node, 0 for the default of 4
+ * @param compare The comparison method used for values
+ *
+ * @return An empty heap, or NULL on allocation failure
+ */
+struct minimalist_heap *
+minimalist_heap_new(unsigned int arity, minimalist_const_compare_fn compare);
+
+/**
+ * @brief Creates a heap from an array of values in O(n)
+ *
+ * The handle of values[i] is i.
+ *
+ * @param arity Number of children per node, 0 for the default of 4
+ * @param compare The comparison method used for values
+ * @param values The values
+ * @param n Number of values
+ *
+ * @return A heap, or NULL on allocation failure
+ */
+struct minimalist_heap *
+minimalist_heap_from_array(unsigned int arity,
+                           minimalist_const_compare_fn compare,
+                           const void *const *values,
+                           size_t n);
+
+/**
+ * @brief Frees a heap
+ *
+ * @param heap The heap
+ */
+void minimalist_heap_free(struct minimalist_heap *heap);
+
+/**
+ * @brief Adds a value
+ *
+ * @param heap The heap
+ * @param value The value
+ *
+ * @return A handle for the value, or MINIMALIST_HEAP_INVALID on failure
+ */
+size_t minimalist_heap_push(struct minimalist_heap *heap, const void *value);
+
+/**
+ * @brief Returns the first value without removing it
+ *
+ * @param heap The heap
+ *
+ * @return The value, or NULL if the heap is empty
+ */
+const void *minimalist_heap_peek(struct minimalist_heap *heap);
+
+/**
+ * @brief Removes and returns the first value
+ *
+ * The handle of the value becomes invalid and may be reused.
+ *
+ * @param heap The heap
+ *
+ * @return The value, or NULL if the heap is empty
+ */
+const void *minimalist_heap_pop(struct minimalist_heap *heap);
+
+/**
+ * @brief Replaces a value, moving it to match its new priority
+ *
+ * Used to decrease (or increase) the key of a queued value.
+ *
+ * @param heap The heap
+ * @param handle The handle returned when the value was pushed
+ * @param value The new value
+ */
+void minimalist_heap_update(struct minimalist_heap *heap,
+                            size_t handle,
+                            const void *value);
+
+/**
+ * @brief Checks if a handle refers to a queued value
+ *
+ * @param heap The heap
+ * @param handle The handle
+ *
+ * @retval 1 if the value is still queued
+ * @retval 0 otherwise
+ */
+int minimalist_heap_contains(struct minimalist_heap *heap, size_t handle);
+
+/**
+ * @brief Returns the number of queued values
+ *
+ * @param heap The heap
+ */
+size_t minimalist_heap_size(struct minimalist_heap *heap);
+
+#endif /* __MINIMALIST_HEAP_H__ */
@@ -0,0 +1,131 @@
+#ifndef __MINIMALIST_LRU_CACHE_H__
+#define __MINIMALIST_LRU_CACHE_H__
+/**
+ * @file lru_cache.h
+ * @brief A bounded, sharded cache built on the hash map
+ *
+ * Every operation is O(1). Keys are spread over shards that each have their
+ * own lock, capacity and eviction order, so the cache can be shared between
+ * threads.
+ */
+
+#include <minimalist/hash_map.h>
+
+#include <stddef.h>
+
+/**
+ * @brief A bounded cache
+ */
+struct minimalist_lru_cache;
+
+/**
+ * @brief Eviction policies
+ */
+enum minimalist_lru_cache_policy {
+  /** Evicts the least recently used entry, moving entries on every hit */
+  MINIMALIST_LRU_CACHE_LRU,
+  /** SIEVE: a CLOCK variant that only marks entries on a hit */
+  MINIMALIST_LRU_CACHE_SIEVE
+};
+
+/**
+ * @brief Called for every entry that leaves the cache
+ */
+typedef void (*minimalist_lru_cache_evict_fn)(void *context,
+                                              const void *key,
+                                              void *value);
+
+/**
+ * @brief Returns the cost of an entry against the capacity
+ */
+typedef size_t (*minimalist_lru_cache_size_fn)(const void *key,
+                                               const void *value);
+
+/**
+ * @brief Creates a new cache
+ *
+ * @param capacity Maximum number of entries, or total size if a size
+ * callback is set
+ * @param shards Number of independently locked shards, at least 1 and at
+ * most capacity
+ * @param policy The eviction policy
+ * @param hash The hash function used for keys
+ * @param compare The comparison function used for keys
+ *
+ * @return A cache, or NULL if hash or compare is missing
+ */
+struct minimalist_lru_cache *
+minimalist_lru_cache_new(size_t capacity,
+                         unsigned int shards,
+                         enum minimalist_lru_cache_policy policy,
+                         minimalist_hash_map_hash_fn hash,
+                         minimalist_hash_map_compare_fn compare);
+
+/**
+ * @brief Frees the cache, passing the remaining entries to the evict callback
+ *
+ * @param cache The cache
+ */
+void minimalist_lru_cache_free(struct minimalist_lru_cache *cache);
+
+/**
+ * @brief Sets the callback run for every entry that leaves the cache
+ *
+ * The callback runs without any shard lock held. Must be set before the cache
+ * is shared between threads.
+ *
+ * @param cache The cache
+ * @param evict The callback
+ * @param context A context for the callback
+ */
+void minimalist_lru_cache_set_evict_fn(struct minimalist_lru_cache *cache,
+                                       minimalist_lru_cache_evict_fn evict,
+                                       void *context);
+
+/**
+ * @brief Measures capacity by entry size instead of entry count
+ *
+ * Must be set before any entry is added.
+ *
+ * @param cache The cache
+ * @param size The callback returning the size of an entry
+ */
+void minimalist_lru_cache_set_size_fn(struct minimalist_lru_cache *cache,
+                                      minimalist_lru_cache_size_fn size);
+
+/**
+ * @brief Gets an entry and marks it as used
+ *
+ * When the cache is shared between threads, the entry may be evicted by
+ * another thread as soon as this returns.
+ *
+ * @param cache The cache
+ * @param key The key
+ *
+ * @return Value stored in entry, or NULL.
+ */
+void *minimalist_lru_cache_get(struct minimalist_lru_cache *cache,
+                               const void *key);
+
+/**
+ * @brief Adds or replaces an entry, evicting others as needed
+ *
+ * Setting the value to NULL removes the entry. A replaced value is passed to
+ * the evict callback.
+ *
+ * @param cache The cache
+ * @param key The key
+ * @param value The value
+ */
+void minimalist_lru_cache_put(struct minimalist_lru_cache *cache,
+                              const void *key,
+                              void *value);
+
+/**
+ * @brief Returns the used capacity of the cache
+ *
+ * @param cache The cache
+ */
+size_t minimalist_lru_cache_size(struct minimalist_lru_cache *cache);
+
+#endif /* __MINIMALIST_LRU_CACHE_H__ */
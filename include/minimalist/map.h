@@ -42,7 +42,8 @@ void minimalist_map_free(struct minimalist_map *map);
 /**
  * @brief Sets an element in a map.
  *
- * Setting the value to NULL removes any previously set element.
+ * A NULL value is stored like any other. Use minimalist_map_remove() to
+ * remove an element.
  *
  * @param map The map on which to operate.
  * @param key The key to use for the element.
@@ -61,6 +62,48 @@ minimalist_map_set(struct minimalist_map *map, const void *key, void *value);
  */
 void *minimalist_map_get(struct minimalist_map *map, const void *key);
 
+/**
+ * @brief Finds or adds an element with a single search
+ *
+ * An added element starts with a NULL value, which the caller can set
+ * through the returned slot.
+ *
+ * @param map The map on which to operate.
+ * @param key The key of the element.
+ * @param inserted If not NULL, set to whether the element was added
+ *
+ * @return The value slot of the element, valid until the map is next
+ * modified, or NULL on allocation failure
+ */
+void **minimalist_map_upsert(struct minimalist_map *map,
+                             const void *key,
+                             int *inserted);
+
+/**
+ * @brief Removes an element from a map
+ *
+ * @param map The map on which to operate.
+ * @param key The key of the element.
+ * @param old_key If not NULL, receives the key of the removed element
+ * @param old_value If not NULL, receives the value of the removed element
+ *
+ * @return 1 if an element was removed, 0 if there was none
+ */
+int minimalist_map_remove(struct minimalist_map *map,
+                          const void *key,
+                          const void **old_key,
+                          void **old_value);
+
+/**
+ * @brief Tests whether a map has an element, even one with a NULL value
+ *
+ * @param map The map to search
+ * @param key The key of the element.
+ *
+ * @return 1 if the element exists, 0 otherwise
+ */
+int minimalist_map_contains(struct minimalist_map *map, const void *key);
+
 /**
  * @brief Runs function on each value in map
  *
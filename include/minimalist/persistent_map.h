@@ -0,0 +1,135 @@
+#ifndef __MINIMALIST_PERSISTENT_MAP_H__
+#define __MINIMALIST_PERSISTENT_MAP_H__
+/**
+ * @file persistent_map.h
+ * @brief An immutable map using a path-copying balanced tree
+ *
+ * Every version of a persistent map is immutable. Updates return a new version
+ * that shares all untouched subtrees with the old one, so taking a snapshot is
+ * O(1) and an update allocates O(log n) nodes. Versions are reference counted
+ * and may be read and released from any thread.
+ */
+
+#include <minimalist/types.h>
+
+#include <stddef.h>
+
+/**
+ * @brief A version of a persistent map
+ */
+struct minimalist_persistent_map;
+
+/**
+ * @brief A run callback
+ */
+typedef void (*minimalist_persistent_map_run_fn)(void *context,
+                                                 const void *key,
+                                                 void *value);
+
+/**
+ * @brief Creates a new, empty persistent map
+ *
+ * If compare is NULL, the addresses are compared.
+ *
+ * @param compare The comparison method use for keys
+ *
+ * @return An empty version, or NULL on allocation failure
+ */
+struct minimalist_persistent_map *
+minimalist_persistent_map_new(minimalist_const_compare_fn compare);
+
+/**
+ * @brief Takes another reference to a version
+ *
+ * @param map The version to snapshot
+ *
+ * @return map, which must be released with minimalist_persistent_map_free
+ */
+struct minimalist_persistent_map *
+minimalist_persistent_map_retain(struct minimalist_persistent_map *map);
+
+/**
+ * @brief Releases a reference to a version
+ *
+ * Nodes are freed once no remaining version refers to them.
+ *
+ * @param map The version to release
+ */
+void minimalist_persistent_map_free(struct minimalist_persistent_map *map);
+
+/**
+ * @brief Creates a new version with an element set
+ *
+ * A NULL value is stored like any other. Use
+ * minimalist_persistent_map_remove() to remove an element. The original
+ * version is left unchanged and still has to be released.
+ *
+ * @param map The version to start from
+ * @param key The key to use for the element.
+ * @param value The value of the element.
+ *
+ * @return The new version, or NULL on allocation failure
+ */
+struct minimalist_persistent_map *
+minimalist_persistent_map_set(struct minimalist_persistent_map *map,
+                              const void *key,
+                              void *value);
+
+/**
+ * @brief Creates a new version without an element
+ *
+ * The original version is left unchanged and still has to be released.
+ *
+ * @param map The version to start from
+ * @param key The key of the element.
+ *
+ * @return The new version, which is another reference to map if it has no
+ * such element, or NULL on allocation failure
+ */
+struct minimalist_persistent_map *
+minimalist_persistent_map_remove(struct minimalist_persistent_map *map,
+                                 const void *key);
+
+/**
+ * @brief Gets element in a version
+ *
+ * @param map The version to search
+ * @param key The key of the element.
+ *
+ * @return The element, if found. Otherwise, NULL.
+ */
+void *minimalist_persistent_map_get(struct minimalist_persistent_map *map,
+                                    const void *key);
+
+/**
+ * @brief Tests whether a version has an element, even one with a NULL value
+ *
+ * @param map The version to search
+ * @param key The key of the element.
+ *
+ * @return 1 if the element exists, 0 otherwise
+ */
+int minimalist_persistent_map_contains(struct minimalist_persistent_map *map,
+                                       const void *key);
+
+/**
+ * @brief Returns the number of elements in a version
+ *
+ * @param map The version
+ */
+size_t minimalist_persistent_map_size(struct minimalist_persistent_map *map);
+
+/**
+ * @brief Runs function on each value in a version
+ *
+ * Elements are visited in the same order as minimalist_map_run.
+ *
+ * @param map The version
+ * @param run The function to run on the values
+ * @param context A context for function
+ */
+void minimalist_persistent_map_run(struct minimalist_persistent_map *map,
+                                   minimalist_persistent_map_run_fn run,
+                                   void *context);
+
+#endif /* __MINIMALIST_PERSISTENT_MAP_H__ */
@@ -14,6 +14,8 @@ typedef void (*minimalist_set_run_fn)(void *context, const void *value);
  */
 struct minimalist_set;
 
+struct minimalist_bloom_filter;
+
 /**
  * @brief Allocates a set structure
  *
@@ -71,4 +73,18 @@ void minimalist_set_run(struct minimalist_set *set,
                         minimalist_set_run_fn run,
                         void *context);
 
+/**
+ * @brief Attaches a filter that rejects lookups of missing values early
+ *
+ * The filter is filled with the hashes of all current values and every value
+ * added later. The set doesn't take ownership of the filter.
+ *
+ * @param set The set
+ * @param filter The filter, or NULL to detach the current one
+ * @param hash The hash callback, consistent with the compare callback
+ */
+void minimalist_set_attach_filter(struct minimalist_set *set,
+                                  struct minimalist_bloom_filter *filter,
+                                  minimalist_hash_fn hash);
+
 #endif /* __MINIMALIST_SET_H__ */
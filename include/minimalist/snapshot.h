@@ -0,0 +1,138 @@
+#ifndef __MINIMALIST_SNAPSHOT_H__
+#define __MINIMALIST_SNAPSHOT_H__
+/**
+ * @file snapshot.h
+ * @brief Read-only, memory-mapped snapshots of maps with byte-string entries
+ *
+ * A snapshot file is itself the index: hash map snapshots hold an
+ * open-addressing table and map snapshots hold a sorted array of records, so
+ * an opened snapshot is queried in place and pages are only faulted in when
+ * touched.
+ *
+ * Keys and values are stored as raw bytes. Snapshot files use the byte order
+ * of the host that wrote them.
+ */
+
+#include <minimalist/hash_map.h>
+#include <minimalist/map.h>
+
+#include <stddef.h>
+
+/**
+ * @brief A read-only, memory-mapped snapshot
+ */
+struct minimalist_snapshot;
+
+/**
+ * @brief Returns the number of bytes to store for a key or value
+ */
+typedef size_t (*minimalist_snapshot_size_fn)(const void *data);
+
+/**
+ * @brief A run callback
+ */
+typedef void (*minimalist_snapshot_run_fn)(void *context,
+                                           const void *key,
+                                           size_t key_len,
+                                           const void *value,
+                                           size_t value_len);
+
+/**
+ * @brief Saves a hash map to a snapshot file
+ *
+ * Entries with a NULL value are saved with a zero-length value.
+ *
+ * @param map The hash map to save
+ * @param path Path of the file to write
+ * @param key_size Returns the number of bytes of a key
+ * @param value_size Returns the number of bytes of a value
+ *
+ * @retval 0 on success
+ * @retval -1 on failure, with errno set
+ */
+int minimalist_hash_map_save(struct minimalist_hash_map *map,
+                             const char *path,
+                             minimalist_snapshot_size_fn key_size,
+                             minimalist_snapshot_size_fn value_size);
+
+/**
+ * @brief Opens a hash map snapshot file
+ *
+ * @param path Path of a file written by minimalist_hash_map_save
+ *
+ * @return A snapshot, or NULL if the file can't be mapped or is invalid
+ */
+struct minimalist_snapshot *minimalist_hash_map_open_mmap(const char *path);
+
+/**
+ * @brief Saves a map to a snapshot file
+ *
+ * Entries with a NULL value are saved with a zero-length value. Entries are
+ * stored ordered by their key bytes, not by the map's compare callback.
+ *
+ * @param map The map to save
+ * @param path Path of the file to write
+ * @param key_size Returns the number of bytes of a key
+ * @param value_size Returns the number of bytes of a value
+ *
+ * @retval 0 on success
+ * @retval -1 on failure, with errno set
+ */
+int minimalist_map_save(struct minimalist_map *map,
+                        const char *path,
+                        minimalist_snapshot_size_fn key_size,
+                        minimalist_snapshot_size_fn value_size);
+
+/**
+ * @brief Opens a map snapshot file
+ *
+ * @param path Path of a file written by minimalist_map_save
+ *
+ * @return A snapshot, or NULL if the file can't be mapped or is invalid
+ */
+struct minimalist_snapshot *minimalist_map_open_mmap(const char *path);
+
+/**
+ * @brief Unmaps and frees a snapshot
+ *
+ * @param snapshot The snapshot
+ */
+void minimalist_snapshot_close(struct minimalist_snapshot *snapshot);
+
+/**
+ * @brief Gets the value stored for a key
+ *
+ * @param snapshot The snapshot
+ * @param key The key bytes
+ * @param key_len Number of key bytes
+ * @param value_len Receives the number of value bytes, may be NULL
+ *
+ * @return Pointer into the mapped file, or NULL if key isn't found.
+ */
+const void *minimalist_snapshot_get(struct minimalist_snapshot *snapshot,
+                                    const void *key,
+                                    size_t key_len,
+                                    size_t *value_len);
+
+/**
+ * @brief Returns the number of entries in a snapshot
+ *
+ * @param snapshot The snapshot
+ */
+size_t minimalist_snapshot_count(struct minimalist_snapshot *snapshot);
+
+/**
+ * @brief Runs function on each entry in a snapshot
+ *
+ * Map snapshots are visited in key byte order, hash map snapshots in no
+ * particular order.
+ *
+ * @param snapshot The snapshot
+ * @param run The function to run on the entries
+ * @param context A context for function
+ */
+void minimalist_snapshot_run(struct minimalist_snapshot *snapshot,
+                             minimalist_snapshot_run_fn run,
+                             void *context);
+
+#endif /* __MINIMALIST_SNAPSHOT_H__ */
@@ -0,0 +1,131 @@
+#ifndef __MINIMALIST_STATIC_MAP_H__
+#define __MINIMALIST_STATIC_MAP_H__
+/**
+ * @file static_map.h
+ * @brief A read-only map over a fixed set of byte-string keys
+ *
+ * The map is built once with a minimal perfect hash in the style of PTHash:
+ * keys are hashed into small buckets, and each bucket gets a pilot value
+ * that sends all of its keys to distinct slots, with exactly one slot per
+ * key. A lookup hashes the key once, reads its bucket's pilot and compares
+ * the key in the single slot it points to.
+ *
+ * A map is one contiguous, position-independent blob, which can be saved and
+ * opened in place, or written out as a C source file whose table is const
+ * data. Blobs use the byte order of the host that built them.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief A static map
+ */
+struct minimalist_static_map;
+
+/**
+ * @brief Returns the number of bytes to store for a key or value
+ */
+typedef size_t (*minimalist_static_map_size_fn)(const void *data);
+
+/**
+ * @brief Declares a map generated by minimalist_static_map_write_c()
+ */
+#define MINIMALIST_STATIC_MAP_DECLARE(name)                                    \
+  extern const struct minimalist_static_map *const name
+
+/**
+ * @brief Builds a static map
+ *
+ * The key and value bytes are copied into the map.
+ *
+ * @param keys The keys, which must be distinct
+ * @param values The values
+ * @param n Number of entries
+ * @param key_size Returns the number of bytes of a key
+ * @param value_size Returns the number of bytes of a value
+ *
+ * @return A map, or NULL with errno set on failure. errno is EINVAL if two
+ * keys have the same bytes, or ERANGE if no perfect hash was found for the
+ * keys, which is vanishingly unlikely for distinct keys.
+ */
+struct minimalist_static_map *
+minimalist_static_map_new(const void *const *keys,
+                          const void *const *values,
+                          size_t n,
+                          minimalist_static_map_size_fn key_size,
+                          minimalist_static_map_size_fn value_size);
+
+/**
+ * @brief Frees a map built by minimalist_static_map_new()
+ *
+ * @param map The map
+ */
+void minimalist_static_map_free(struct minimalist_static_map *map);
+
+/**
+ * @brief Gets a value
+ *
+ * @param map The map
+ * @param key The key bytes
+ * @param key_len Number of key bytes
+ * @param value_len If not NULL, receives the number of value bytes
+ *
+ * @return The value bytes, which live as long as the map, or NULL if the key
+ * isn't in the map
+ */
+const void *minimalist_static_map_get(const struct minimalist_static_map *map,
+                                      const void *key,
+                                      size_t key_len,
+                                      size_t *value_len);
+
+/**
+ * @brief Returns the number of entries in a map
+ *
+ * @param map The map
+ */
+size_t minimalist_static_map_size(const struct minimalist_static_map *map);
+
+/**
+ * @brief Returns the blob of a map, to be saved
+ *
+ * @param map The map
+ * @param size Receives the number of bytes of the blob
+ *
+ * @return The blob, which is the map itself
+ */
+const void *minimalist_static_map_blob(const struct minimalist_static_map *map,
+                                       size_t *size);
+
+/**
+ * @brief Opens a blob in place
+ *
+ * The blob is checked but not copied, and must stay valid while the map is
+ * used. The map must not be freed.
+ *
+ * @param blob A blob from minimalist_static_map_blob(), aligned to 8 bytes
+ * @param size Number of bytes of the blob
+ *
+ * @return The map, or NULL with errno set to EINVAL if the blob is invalid
+ */
+const struct minimalist_static_map *
+minimalist_static_map_open(const void *blob, size_t size);
+
+/**
+ * @brief Writes a map as a C source file
+ *
+ * The file defines name as a const struct minimalist_static_map pointer to
+ * const data, which MINIMALIST_STATIC_MAP_DECLARE(name) declares. It is
+ * usable as is, with no call to minimalist_static_map_open().
+ *
+ * @param map The map
+ * @param path Path of the file to write
+ * @param name A C identifier for the map
+ *
+ * @retval 0 on success
+ * @retval -1 on failure, with errno set
+ */
+int minimalist_static_map_write_c(const struct minimalist_static_map *map,
+                                  const char *path,
+                                  const char *name);
+
+#endif /* __MINIMALIST_STATIC_MAP_H__ */
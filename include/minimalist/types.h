@@ -5,6 +5,8 @@
  * @brief Types used throughout the library
  */
 
+#include <stddef.h>
+
 /**
  * @brief A compare callback
  */
@@ -15,4 +17,9 @@ typedef int (*minimalist_compare_fn)(void *a, void *b);
  */
 typedef int (*minimalist_const_compare_fn)(const void *a, const void *b);
 
+/**
+ * @brief A hash callback
+ */
+typedef size_t (*minimalist_hash_fn)(const void *value);
+
 #endif /* __MINIMALIST_TYPES_H__ */
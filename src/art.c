@@ -0,0 +1,865 @@
+#include "minimalist/art.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Number of compressed path bytes stored in a node */
+#define MAX_PREFIX 16
+
+/* Leaves are stored in child slots with the low pointer bit set */
+#define IS_LEAF(x) (((uintptr_t)(x)) & 1)
+#define TAG_LEAF(x) ((struct art_node *)((uintptr_t)(x) | 1))
+#define LEAF_OF(x) ((struct art_leaf *)((uintptr_t)(x) & ~(uintptr_t)1))
+
+enum node_type { NODE4, NODE16, NODE48, NODE256 };
+
+struct art_leaf {
+  void *value;
+  size_t key_len;
+  unsigned char key[];
+};
+
+/*
+ * A node at depth d covers key bytes [d, d + prefix_len) with its compressed
+ * path and branches on byte d + prefix_len. Only the first MAX_PREFIX bytes of
+ * the path are stored; longer paths are checked against a leaf below the
+ * node. A key ending right after the path is kept in leaf.
+ */
+struct art_node {
+  uint8_t type;
+  uint16_t num_children;
+  uint32_t prefix_len;
+  unsigned char prefix[MAX_PREFIX];
+  struct art_leaf *leaf;
+};
+
+struct art_node4 {
+  struct art_node node;
+  unsigned char keys[4];
+  struct art_node *children[4];
+};
+
+struct art_node16 {
+  struct art_node node;
+  unsigned char keys[16];
+  struct art_node *children[16];
+};
+
+struct art_node48 {
+  struct art_node node;
+  unsigned char index[256]; /* Child slot plus one, zero when empty */
+  struct art_node *children[48];
+};
+
+struct art_node256 {
+  struct art_node node;
+  struct art_node *children[256];
+};
+
+struct minimalist_art {
+  struct art_node *root;
+  size_t size;
+};
+
+static size_t
+min_size(size_t a, size_t b) {
+  return a < b ? a : b;
+}
+
+static struct art_leaf *
+leaf_new(const unsigned char *key, size_t key_len, void *value) {
+  struct art_leaf *leaf = malloc(sizeof(struct art_leaf) + key_len);
+  if (leaf) {
+    leaf->value = value;
+    leaf->key_len = key_len;
+    memcpy(leaf->key, key, key_len);
+  }
+  return leaf;
+}
+
+static int
+leaf_matches(const struct art_leaf *leaf,
+             const unsigned char *key,
+             size_t key_len) {
+  return leaf->key_len == key_len && memcmp(leaf->key, key, key_len) == 0;
+}
+
+static struct art_node *
+node_new(enum node_type type) {
+  struct art_node *node = NULL;
+  switch (type) {
+  case NODE4:
+    node = calloc(1, sizeof(struct art_node4));
+    break;
+  case NODE16:
+    node = calloc(1, sizeof(struct art_node16));
+    break;
+  case NODE48:
+    node = calloc(1, sizeof(struct art_node48));
+    break;
+  case NODE256:
+    node = calloc(1, sizeof(struct art_node256));
+    break;
+  }
+  if (node) {
+    node->type = type;
+  }
+  return node;
+}
+
+static void
+copy_header(struct art_node *dst, const struct art_node *src) {
+  dst->num_children = src->num_children;
+  dst->prefix_len = src->prefix_len;
+  memcpy(dst->prefix, src->prefix, MAX_PREFIX);
+  dst->leaf = src->leaf;
+}
+
+static void
+free_node(struct art_node *node) {
+  int i = 0;
+
+  if (node == NULL) {
+    return;
+  }
+  if (IS_LEAF(node)) {
+    free(LEAF_OF(node));
+    return;
+  }
+  switch (node->type) {
+  case NODE4:
+    for (i = 0; i < node->num_children; i++) {
+      free_node(((struct art_node4 *)node)->children[i]);
+    }
+    break;
+  case NODE16:
+    for (i = 0; i < node->num_children; i++) {
+      free_node(((struct art_node16 *)node)->children[i]);
+    }
+    break;
+  case NODE48:
+    for (i = 0; i < 48; i++) {
+      free_node(((struct art_node48 *)node)->children[i]);
+    }
+    break;
+  case NODE256:
+    for (i = 0; i < 256; i++) {
+      free_node(((struct art_node256 *)node)->children[i]);
+    }
+    break;
+  }
+  free(node->leaf);
+  free(node);
+}
+
+static struct art_node **
+find_child(struct art_node *node, unsigned char c) {
+  struct art_node4 *node4 = NULL;
+  struct art_node16 *node16 = NULL;
+  struct art_node48 *node48 = NULL;
+  struct art_node256 *node256 = NULL;
+  int i = 0;
+
+  switch (node->type) {
+  case NODE4:
+    node4 = (struct art_node4 *)node;
+    for (i = 0; i < node->num_children; i++) {
+      if (node4->keys[i] == c) {
+        return &node4->children[i];
+      }
+    }
+    break;
+  case NODE16:
+    node16 = (struct art_node16 *)node;
+#ifdef __SSE2__
+    {
+      __m128i keys = _mm_loadu_si128((const __m128i *)node16->keys);
+      __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8((char)c), keys);
+      int mask =
+          _mm_movemask_epi8(matches) & ((1 << node->num_children) - 1);
+      if (mask) {
+        return &node16->children[__builtin_ctz(mask)];
+      }
+    }
+#else
+    for (i = 0; i < node->num_children; i++) {
+      if (node16->keys[i] == c) {
+        return &node16->children[i];
+      }
+    }
+#endif
+    break;
+  case NODE48:
+    node48 = (struct art_node48 *)node;
+    if (node48->index[c]) {
+      return &node48->children[node48->index[c] - 1];
+    }
+    break;
+  case NODE256:
+    node256 = (struct art_node256 *)node;
+    if (node256->children[c]) {
+      return &node256->children[c];
+    }
+    break;
+  }
+  return NULL;
+}
+
+/* Inserts into a sorted key array of count entries */
+static void
+insert_sorted(unsigned char *keys,
+              struct art_node **children,
+              int count,
+              unsigned char c,
+              struct art_node *child) {
+  int i = 0;
+  while (i < count && keys[i] < c) {
+    i++;
+  }
+  memmove(keys + i + 1, keys + i, count - i);
+  memmove(children + i + 1, children + i, sizeof(void *) * (count - i));
+  keys[i] = c;
+  children[i] = child;
+}
+
+/*
+ * Adds a child to node, growing it into the next node type when it is full.
+ * ref is the slot holding node and is updated when the node is replaced.
+ */
+static int
+add_child(struct art_node **ref,
+          struct art_node *node,
+          unsigned char c,
+          struct art_node *child) {
+  struct art_node4 *node4 = NULL;
+  struct art_node16 *node16 = NULL;
+  struct art_node48 *node48 = NULL;
+  struct art_node256 *node256 = NULL;
+  struct art_node *grown = NULL;
+  int i = 0;
+
+  switch (node->type) {
+  case NODE4:
+    node4 = (struct art_node4 *)node;
+    if (node->num_children < 4) {
+      insert_sorted(
+          node4->keys, node4->children, node->num_children, c, child);
+      break;
+    }
+    grown = node_new(NODE16);
+    if (grown == NULL) {
+      return -1;
+    }
+    copy_header(grown, node);
+    node16 = (struct art_node16 *)grown;
+    memcpy(node16->keys, node4->keys, 4);
+    memcpy(node16->children, node4->children, sizeof(void *) * 4);
+    free(node);
+    *ref = grown;
+    return add_child(ref, grown, c, child);
+  case NODE16:
+    node16 = (struct art_node16 *)node;
+    if (node->num_children < 16) {
+      insert_sorted(
+          node16->keys, node16->children, node->num_children, c, child);
+      break;
+    }
+    grown = node_new(NODE48);
+    if (grown == NULL) {
+      return -1;
+    }
+    copy_header(grown, node);
+    node48 = (struct art_node48 *)grown;
+    for (i = 0; i < 16; i++) {
+      node48->index[node16->keys[i]] = i + 1;
+      node48->children[i] = node16->children[i];
+    }
+    free(node);
+    *ref = grown;
+    return add_child(ref, grown, c, child);
+  case NODE48:
+    node48 = (struct art_node48 *)node;
+    if (node->num_children < 48) {
+      while (node48->children[i] != NULL) {
+        i++;
+      }
+      node48->children[i] = child;
+      node48->index[c] = i + 1;
+      break;
+    }
+    grown = node_new(NODE256);
+    if (grown == NULL) {
+      return -1;
+    }
+    copy_header(grown, node);
+    node256 = (struct art_node256 *)grown;
+    for (i = 0; i < 256; i++) {
+      if (node48->index[i]) {
+        node256->children[i] = node48->children[node48->index[i] - 1];
+      }
+    }
+    free(node);
+    *ref = grown;
+    return add_child(ref, grown, c, child);
+  case NODE256:
+    node256 = (struct art_node256 *)node;
+    node256->children[c] = child;
+    break;
+  }
+  node->num_children++;
+  return 0;
+}
+
+static struct art_leaf *
+min_leaf(struct art_node *node) {
+  while (!IS_LEAF(node)) {
+    if (node->leaf) {
+      return node->leaf;
+    }
+    switch (node->type) {
+    case NODE4:
+      node = ((struct art_node4 *)node)->children[0];
+      break;
+    case NODE16:
+      node = ((struct art_node16 *)node)->children[0];
+      break;
+    case NODE48: {
+      struct art_node48 *node48 = (struct art_node48 *)node;
+      int i = 0;
+      while (node48->index[i] == 0) {
+        i++;
+      }
+      node = node48->children[node48->index[i] - 1];
+      break;
+    }
+    case NODE256: {
+      struct art_node256 *node256 = (struct art_node256 *)node;
+      int i = 0;
+      while (node256->children[i] == NULL) {
+        i++;
+      }
+      node = node256->children[i];
+      break;
+    }
+    }
+  }
+  return LEAF_OF(node);
+}
+
+/*
+ * Returns how many bytes of the node's compressed path match key at depth.
+ * Bytes beyond the stored prefix are compared against a leaf below the node.
+ */
+static size_t
+prefix_mismatch(struct art_node *node,
+                const unsigned char *key,
+                size_t key_len,
+                size_t depth) {
+  size_t length = min_size(node->prefix_len, key_len - depth);
+  size_t stored = min_size(length, MAX_PREFIX);
+  struct art_leaf *leaf = NULL;
+  size_t i = 0;
+
+  for (i = 0; i < stored; i++) {
+    if (node->prefix[i] != key[depth + i]) {
+      return i;
+    }
+  }
+  if (length > MAX_PREFIX) {
+    leaf = min_leaf(node);
+    for (; i < length; i++) {
+      if (leaf->key[depth + i] != key[depth + i]) {
+        return i;
+      }
+    }
+  }
+  return length;
+}
+
+/* Places leaf in node, which covers key up to depth */
+static int
+attach(struct art_node **ref,
+       struct art_node *node,
+       struct art_leaf *leaf,
+       size_t depth) {
+  if (depth == leaf->key_len) {
+    node->leaf = leaf;
+    return 0;
+  }
+  return add_child(ref, node, leaf->key[depth], TAG_LEAF(leaf));
+}
+
+static int
+split_leaf(struct art_node **ref, struct art_leaf *leaf, size_t depth) {
+  struct art_leaf *existing = LEAF_OF(*ref);
+  struct art_node *node = node_new(NODE4);
+  size_t length = min_size(existing->key_len, leaf->key_len) - depth;
+  size_t common = 0;
+
+  if (node == NULL) {
+    return -1;
+  }
+  while (common < length &&
+         existing->key[depth + common] == leaf->key[depth + common]) {
+    common++;
+  }
+  node->prefix_len = common;
+  memcpy(node->prefix, leaf->key + depth, min_size(common, MAX_PREFIX));
+  *ref = node;
+  attach(ref, node, existing, depth + common);
+  attach(ref, node, leaf, depth + common);
+  return 0;
+}
+
+static int
+split_prefix(struct art_node **ref,
+             struct art_leaf *leaf,
+             size_t depth,
+             size_t matched) {
+  struct art_node *node = *ref;
+  struct art_node *parent = node_new(NODE4);
+  struct art_leaf *below = NULL;
+  unsigned char c = 0;
+
+  if (parent == NULL) {
+    return -1;
+  }
+  parent->prefix_len = matched;
+  memcpy(parent->prefix, node->prefix, min_size(matched, MAX_PREFIX));
+
+  if (node->prefix_len <= MAX_PREFIX) {
+    c = node->prefix[matched];
+    node->prefix_len -= matched + 1;
+    memmove(node->prefix, node->prefix + matched + 1, node->prefix_len);
+  } else {
+    below = min_leaf(node);
+    c = below->key[depth + matched];
+    node->prefix_len -= matched + 1;
+    memcpy(node->prefix,
+           below->key + depth + matched + 1,
+           min_size(node->prefix_len, MAX_PREFIX));
+  }
+
+  *ref = parent;
+  add_child(ref, parent, c, node);
+  attach(ref, parent, leaf, depth + matched);
+  return 0;
+}
+
+/*
+ * Inserts or replaces the element for key below the slot ref at depth.
+ * Returns 1 if an element was added, 0 if one was replaced and -1 on failure.
+ */
+static int
+insert(struct art_node **ref,
+       const unsigned char *key,
+       size_t key_len,
+       size_t depth,
+       void *value) {
+  struct art_node *node = *ref;
+  struct art_node **child = NULL;
+  struct art_leaf *leaf = NULL;
+  size_t matched = 0;
+
+  if (node != NULL && IS_LEAF(node) &&
+      leaf_matches(LEAF_OF(node), key, key_len)) {
+    LEAF_OF(node)->value = value;
+    return 0;
+  }
+  if (node != NULL && !IS_LEAF(node)) {
+    matched = prefix_mismatch(node, key, key_len, depth);
+    if (matched == node->prefix_len) {
+      depth += node->prefix_len;
+      if (depth == key_len && node->leaf) {
+        node->leaf->value = value;
+        return 0;
+      }
+      if (depth < key_len) {
+        child = find_child(node, key[depth]);
+        if (child != NULL) {
+          return insert(child, key, key_len, depth + 1, value);
+        }
+      }
+    }
+  }
+
+  leaf = leaf_new(key, key_len, value);
+  if (leaf == NULL) {
+    return -1;
+  }
+  if (node == NULL) {
+    *ref = TAG_LEAF(leaf);
+  } else if (IS_LEAF(node)) {
+    if (split_leaf(ref, leaf, depth) != 0) {
+      free(leaf);
+      return -1;
+    }
+  } else if (matched < node->prefix_len) {
+    if (split_prefix(ref, leaf, depth, matched) != 0) {
+      free(leaf);
+      return -1;
+    }
+  } else if (attach(ref, node, leaf, depth) != 0) {
+    free(leaf);
+    return -1;
+  }
+  return 1;
+}
+
+static void
+collapse(struct art_node **ref) {
+  struct art_node4 *node4 = (struct art_node4 *)*ref;
+  struct art_node *node = *ref;
+  struct art_node *child = node4->children[0];
+  unsigned char prefix[MAX_PREFIX];
+  size_t length = 0, count = 0;
+
+  if (!IS_LEAF(child)) {
+    length = min_size(node->prefix_len, MAX_PREFIX);
+    memcpy(prefix, node->prefix, length);
+    if (length < MAX_PREFIX) {
+      prefix[length++] = node4->keys[0];
+    }
+    count = min_size(child->prefix_len, MAX_PREFIX - length);
+    memcpy(prefix + length, child->prefix, count);
+    memcpy(child->prefix, prefix, length + count);
+    child->prefix_len += node->prefix_len + 1;
+  }
+  *ref = child;
+  free(node);
+}
+
+/* Moves a node into a smaller node type once it has few enough children */
+static void
+shrink(struct art_node **ref) {
+  struct art_node *node = *ref;
+  struct art_node *smaller = NULL;
+  struct art_node4 *node4 = NULL;
+  struct art_node16 *node16 = NULL;
+  struct art_node48 *node48 = NULL;
+  struct art_node256 *node256 = NULL;
+  int i = 0, count = 0;
+
+  switch (node->type) {
+  case NODE4:
+    if (node->num_children == 0) {
+      *ref = node->leaf ? TAG_LEAF(node->leaf) : NULL;
+      free(node);
+    } else if (node->num_children == 1 && node->leaf == NULL) {
+      collapse(ref);
+    }
+    return;
+  case NODE16:
+    if (node->num_children > 3 || (smaller = node_new(NODE4)) == NULL) {
+      return;
+    }
+    node16 = (struct art_node16 *)node;
+    node4 = (struct art_node4 *)smaller;
+    memcpy(node4->keys, node16->keys, node->num_children);
+    memcpy(node4->children,
+           node16->children,
+           sizeof(void *) * node->num_children);
+    break;
+  case NODE48:
+    if (node->num_children > 12 || (smaller = node_new(NODE16)) == NULL) {
+      return;
+    }
+    node48 = (struct art_node48 *)node;
+    node16 = (struct art_node16 *)smaller;
+    for (i = 0; i < 256; i++) {
+      if (node48->index[i]) {
+        node16->keys[count] = i;
+        node16->children[count++] = node48->children[node48->index[i] - 1];
+      }
+    }
+    break;
+  case NODE256:
+    if (node->num_children > 37 || (smaller = node_new(NODE48)) == NULL) {
+      return;
+    }
+    node256 = (struct art_node256 *)node;
+    node48 = (struct art_node48 *)smaller;
+    for (i = 0; i < 256; i++) {
+      if (node256->children[i]) {
+        node48->children[count] = node256->children[i];
+        node48->index[i] = ++count;
+      }
+    }
+    break;
+  }
+  copy_header(smaller, node);
+  free(node);
+  *ref = smaller;
+}
+
+static void
+remove_child(struct art_node *node, struct art_node **child, unsigned char c) {
+  struct art_node4 *node4 = NULL;
+  struct art_node16 *node16 = NULL;
+  struct art_node48 *node48 = NULL;
+  int i = 0;
+
+  switch (node->type) {
+  case NODE4:
+    node4 = (struct art_node4 *)node;
+    i = child - node4->children;
+    memmove(node4->keys + i, node4->keys + i + 1, node->num_children - i - 1);
+    memmove(node4->children + i,
+            node4->children + i + 1,
+            sizeof(void *) * (node->num_children - i - 1));
+    break;
+  case NODE16:
+    node16 = (struct art_node16 *)node;
+    i = child - node16->children;
+    memmove(
+        node16->keys + i, node16->keys + i + 1, node->num_children - i - 1);
+    memmove(node16->children + i,
+            node16->children + i + 1,
+            sizeof(void *) * (node->num_children - i - 1));
+    break;
+  case NODE48:
+    node48 = (struct art_node48 *)node;
+    node48->index[c] = 0;
+    *child = NULL;
+    break;
+  case NODE256:
+    *child = NULL;
+    break;
+  }
+  node->num_children--;
+}
+
+/* Removes the element for key below the slot ref, returning 1 if found */
+static int
+remove_key(struct art_node **ref,
+       const unsigned char *key,
+       size_t key_len,
+       size_t depth) {
+  struct art_node *node = *ref;
+  struct art_node **child = NULL;
+
+  if (node == NULL) {
+    return 0;
+  }
+  if (IS_LEAF(node)) {
+    if (!leaf_matches(LEAF_OF(node), key, key_len)) {
+      return 0;
+    }
+    free(LEAF_OF(node));
+    *ref = NULL;
+    return 1;
+  }
+  if (prefix_mismatch(node, key, key_len, depth) != node->prefix_len) {
+    return 0;
+  }
+  depth += node->prefix_len;
+  if (depth == key_len) {
+    if (node->leaf == NULL) {
+      return 0;
+    }
+    free(node->leaf);
+    node->leaf = NULL;
+    shrink(ref);
+    return 1;
+  }
+  child = find_child(node, key[depth]);
+  if (child == NULL) {
+    return 0;
+  }
+  if (IS_LEAF(*child)) {
+    if (!leaf_matches(LEAF_OF(*child), key, key_len)) {
+      return 0;
+    }
+    free(LEAF_OF(*child));
+    remove_child(node, child, key[depth]);
+    shrink(ref);
+    return 1;
+  }
+  return remove_key(child, key, key_len, depth + 1);
+}
+
+struct minimalist_art *
+minimalist_art_new(void) {
+  return calloc(1, sizeof(struct minimalist_art));
+}
+
+void
+minimalist_art_free(struct minimalist_art *art) {
+  if (art) {
+    free_node(art->root);
+    free(art);
+  }
+}
+
+void
+minimalist_art_set(struct minimalist_art *art,
+                   const void *key,
+                   size_t key_len,
+                   void *value) {
+  if (insert(&art->root, key, key_len, 0, value) == 1) {
+    art->size++;
+  }
+}
+
+int
+minimalist_art_remove(struct minimalist_art *art,
+                      const void *key,
+                      size_t key_len) {
+  int removed = remove_key(&art->root, key, key_len, 0);
+  art->size -= removed;
+  return removed;
+}
+
+static struct art_leaf *
+find_leaf(struct minimalist_art *art, const void *key, size_t key_len) {
+  const unsigned char *bytes = key;
+  struct art_node *node = art->root;
+  struct art_node **child = NULL;
+  size_t depth = 0;
+
+  while (node != NULL && !IS_LEAF(node)) {
+    /* Paths longer than the stored prefix are verified by the leaf */
+    if (node->prefix_len > key_len - depth ||
+        memcmp(node->prefix,
+               bytes + depth,
+               min_size(node->prefix_len, MAX_PREFIX)) != 0) {
+      return NULL;
+    }
+    depth += node->prefix_len;
+    if (depth == key_len) {
+      return node->leaf && leaf_matches(node->leaf, bytes, key_len)
+                 ? node->leaf
+                 : NULL;
+    }
+    child = find_child(node, bytes[depth++]);
+    node = child ? *child : NULL;
+  }
+  if (node != NULL && leaf_matches(LEAF_OF(node), bytes, key_len)) {
+    return LEAF_OF(node);
+  }
+  return NULL;
+}
+
+void *
+minimalist_art_get(struct minimalist_art *art,
+                   const void *key,
+                   size_t key_len) {
+  struct art_leaf *leaf = find_leaf(art, key, key_len);
+  return leaf ? leaf->value : NULL;
+}
+
+int
+minimalist_art_contains(struct minimalist_art *art,
+                        const void *key,
+                        size_t key_len) {
+  return find_leaf(art, key, key_len) != NULL;
+}
+
+size_t
+minimalist_art_size(struct minimalist_art *art) {
+  return art->size;
+}
+
+static void
+run_leaf(struct art_leaf *leaf, minimalist_art_run_fn run, void *context) {
+  run(context, leaf->key, leaf->key_len, leaf->value);
+}
+
+static void
+run_node(struct art_node *node, minimalist_art_run_fn run, void *context) {
+  struct art_node48 *node48 = NULL;
+  struct art_node256 *node256 = NULL;
+  int i = 0;
+
+  if (IS_LEAF(node)) {
+    run_leaf(LEAF_OF(node), run, context);
+    return;
+  }
+  if (node->leaf) {
+    run_leaf(node->leaf, run, context);
+  }
+  switch (node->type) {
+  case NODE4:
+    for (i = 0; i < node->num_children; i++) {
+      run_node(((struct art_node4 *)node)->children[i], run, context);
+    }
+    break;
+  case NODE16:
+    for (i = 0; i < node->num_children; i++) {
+      run_node(((struct art_node16 *)node)->children[i], run, context);
+    }
+    break;
+  case NODE48:
+    node48 = (struct art_node48 *)node;
+    for (i = 0; i < 256; i++) {
+      if (node48->index[i]) {
+        run_node(node48->children[node48->index[i] - 1], run, context);
+      }
+    }
+    break;
+  case NODE256:
+    node256 = (struct art_node256 *)node;
+    for (i = 0; i < 256; i++) {
+      if (node256->children[i]) {
+        run_node(node256->children[i], run, context);
+      }
+    }
+    break;
+  }
+}
+
+void
+minimalist_art_run(struct minimalist_art *art,
+                   minimalist_art_run_fn run,
+                   void *context) {
+  if (run && art->root) {
+    run_node(art->root, run, context);
+  }
+}
+
+void
+minimalist_art_run_prefix(struct minimalist_art *art,
+                          const void *prefix,
+                          size_t prefix_len,
+                          minimalist_art_run_fn run,
+                          void *context) {
+  const unsigned char *bytes = prefix;
+  struct art_node *node = art->root;
+  struct art_node **child = NULL;
+  struct art_leaf *leaf = NULL;
+  size_t depth = 0;
+
+  while (run && node != NULL) {
+    if (IS_LEAF(node)) {
+      leaf = LEAF_OF(node);
+      if (leaf->key_len >= prefix_len &&
+          memcmp(leaf->key, bytes, prefix_len) == 0) {
+        run_leaf(leaf, run, context);
+      }
+      return;
+    }
+    if (prefix_mismatch(node, bytes, prefix_len, depth) !=
+        min_size(node->prefix_len, prefix_len - depth)) {
+      return;
+    }
+    if (depth + node->prefix_len >= prefix_len) {
+      run_node(node, run, context);
+      return;
+    }
+    depth += node->prefix_len;
+    child = find_child(node, bytes[depth++]);
+    node = child ? *child : NULL;
+  }
+}
+
+void
+minimalist_art_key_u64(uint64_t value, unsigned char key[8]) {
+  for (int i = 7; i >= 0; i--) {
+    key[i] = (unsigned char)value;
+    value >>= 8;
+  }
+}
@@ -0,0 +1,139 @@
+#include "minimalist/bloom_filter.h"
+
+#include "minimalist/hash.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_BITS 512
+#define BLOCK_WORDS (BLOCK_BITS / 64)
+#define MAX_HASHES 16
+
+#define LN2 0.69314718055994530942
+
+struct minimalist_bloom_filter {
+  uint64_t *blocks;
+  size_t num_blocks;
+  unsigned int num_hashes;
+};
+
+struct minimalist_bloom_filter *
+minimalist_bloom_filter_new(size_t expected, double false_positive_rate) {
+  struct minimalist_bloom_filter *filter = NULL;
+  double bits_per_element = 0;
+
+  if (expected == 0) {
+    expected = 1;
+  }
+  if (false_positive_rate <= 0 || false_positive_rate >= 1) {
+    false_positive_rate = 0.01;
+  }
+  bits_per_element = -log(false_positive_rate) / (LN2 * LN2);
+
+  filter = malloc(sizeof(struct minimalist_bloom_filter));
+  if (filter == NULL) {
+    return NULL;
+  }
+  filter->num_blocks =
+      (size_t)ceil(bits_per_element * expected / BLOCK_BITS);
+  if (filter->num_blocks == 0) {
+    filter->num_blocks = 1;
+  }
+  filter->num_hashes = (unsigned int)(bits_per_element * LN2 + 0.5);
+  if (filter->num_hashes == 0) {
+    filter->num_hashes = 1;
+  } else if (filter->num_hashes > MAX_HASHES) {
+    filter->num_hashes = MAX_HASHES;
+  }
+  filter->blocks =
+      aligned_alloc(BLOCK_BITS / 8, filter->num_blocks * BLOCK_BITS / 8);
+  if (filter->blocks == NULL) {
+    free(filter);
+    return NULL;
+  }
+  minimalist_bloom_filter_clear(filter);
+  return filter;
+}
+
+void
+minimalist_bloom_filter_free(struct minimalist_bloom_filter *filter) {
+  if (filter) {
+    free(filter->blocks);
+    free(filter);
+  }
+}
+
+void
+minimalist_bloom_filter_clear(struct minimalist_bloom_filter *filter) {
+  memset(filter->blocks, 0, filter->num_blocks * BLOCK_BITS / 8);
+}
+
+/*
+ * The hash is remixed so that weak hash map hashes still spread well. The
+ * high half picks the block and the low bits seed the double hashing that
+ * picks the bits within it.
+ */
+static uint64_t *
+get_block(struct minimalist_bloom_filter *filter, uint64_t hash) {
+  uint64_t index = ((hash >> 32) * filter->num_blocks) >> 32;
+  return filter->blocks + index * BLOCK_WORDS;
+}
+
+void
+minimalist_bloom_filter_add_hash(struct minimalist_bloom_filter *filter,
+                                 uint64_t hash) {
+  uint64_t *block = NULL;
+  unsigned int bit = 0, step = 0;
+
+  hash = minimalist_hash_u64(hash);
+  block = get_block(filter, hash);
+  bit = hash % BLOCK_BITS;
+  step = ((hash >> 9) % BLOCK_BITS) | 1;
+  for (unsigned int i = 0; i < filter->num_hashes; i++) {
+    block[bit / 64] |= (uint64_t)1 << (bit % 64);
+    bit = (bit + step) % BLOCK_BITS;
+  }
+}
+
+int
+minimalist_bloom_filter_contains_hash(struct minimalist_bloom_filter *filter,
+                                      uint64_t hash) {
+  uint64_t *block = NULL;
+  unsigned int bit = 0, step = 0;
+
+  hash = minimalist_hash_u64(hash);
+  block = get_block(filter, hash);
+  bit = hash % BLOCK_BITS;
+  step = ((hash >> 9) % BLOCK_BITS) | 1;
+  for (unsigned int i = 0; i < filter->num_hashes; i++) {
+    if ((block[bit / 64] & ((uint64_t)1 << (bit % 64))) == 0) {
+      return 0;
+    }
+    bit = (bit + step) % BLOCK_BITS;
+  }
+  return 1;
+}
+
+void
+minimalist_bloom_filter_prefetch(struct minimalist_bloom_filter *filter,
+                                 uint64_t hash) {
+#if defined(__GNUC__)
+  __builtin_prefetch(get_block(filter, minimalist_hash_u64(hash)));
+#endif
+}
+
+void
+minimalist_bloom_filter_add(struct minimalist_bloom_filter *filter,
+                            const void *data,
+                            size_t len) {
+  minimalist_bloom_filter_add_hash(filter, minimalist_hash_bytes(data, len, 0));
+}
+
+int
+minimalist_bloom_filter_contains(struct minimalist_bloom_filter *filter,
+                                 const void *data,
+                                 size_t len) {
+  return minimalist_bloom_filter_contains_hash(
+      filter, minimalist_hash_bytes(data, len, 0));
+}
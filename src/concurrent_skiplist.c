@@ -0,0 +1,603 @@
+#include "minimalist/concurrent_skiplist.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Enough levels for 2^32 elements at one in two nodes per level */
+#define MAX_LEVELS 32
+
+/* Retired nodes between attempts to advance the epoch */
+#define RETIRES_PER_ADVANCE 64
+
+/* Set in a next pointer once its node is removed */
+#define MARK ((uintptr_t)1)
+
+/* Node states, so that the last of its inserter and remover frees it */
+#define NODE_BUILDING 1
+#define NODE_REMOVED 2
+
+/*
+ * Every level of the list is a Harris linked list: a node is removed by
+ * marking its next pointers, top level first, and then unlinked by whichever
+ * search passes it. The level 0 mark decides which remover wins.
+ */
+struct skiplist_node {
+  const void *key;
+  _Atomic(void *) value;
+  atomic_int state;
+  int height;
+  /* Links retired nodes, as next can still be read by other threads */
+  struct skiplist_node *retired;
+  atomic_uintptr_t next[];
+};
+
+/*
+ * Nodes retired in an epoch, freed once the global epoch is two past it.
+ * Each thread keeps three, one per epoch still in use.
+ */
+struct limbo {
+  uint64_t epoch;
+  struct skiplist_node *nodes;
+};
+
+/*
+ * A thread's registration with a list. epoch holds the pinned epoch shifted
+ * left, with the low bit set while the thread is inside an operation.
+ * Records are never unlinked, so a list has one per thread that ever used
+ * it.
+ */
+struct epoch_record {
+  atomic_uint_fast64_t epoch;
+  struct epoch_record *next;
+  pthread_t owner;
+  unsigned int depth;
+  unsigned int retires;
+  uint64_t random;
+  struct limbo limbo[3];
+};
+
+struct minimalist_concurrent_skiplist {
+  minimalist_const_compare_fn compare;
+  uint64_t id;
+  atomic_uint_fast64_t epoch;
+  _Atomic(struct epoch_record *) records;
+  /* Operations by threads whose record couldn't be allocated */
+  atomic_uint unregistered;
+  /* Nodes they retired, freed with the list */
+  _Atomic(struct skiplist_node *) orphans;
+  atomic_int levels;
+  atomic_size_t size;
+  struct skiplist_node *head;
+};
+
+/* Identifies lists for the record cache, as addresses get reused */
+static atomic_uint_fast64_t next_id = 1;
+
+static _Thread_local struct {
+  uint64_t id;
+  struct epoch_record *record;
+} cached_record;
+
+static int
+address_compare(const void *a, const void *b) {
+  return (a < b) - (a > b);
+}
+
+static struct skiplist_node *
+unmarked(uintptr_t next) {
+  return (struct skiplist_node *)(next & ~MARK);
+}
+
+static struct skiplist_node *
+node_new(const void *key, void *value, int height) {
+  struct skiplist_node *node = malloc(sizeof(struct skiplist_node) +
+                                      sizeof(atomic_uintptr_t) * height);
+  if (node != NULL) {
+    node->key = key;
+    atomic_init(&node->value, value);
+    atomic_init(&node->state, NODE_BUILDING);
+    node->height = height;
+    node->retired = NULL;
+  }
+  return node;
+}
+
+static void
+limbo_free(struct limbo *limbo) {
+  struct skiplist_node *node = limbo->nodes, *next = NULL;
+  while (node != NULL) {
+    next = node->retired;
+    free(node);
+    node = next;
+  }
+  limbo->nodes = NULL;
+}
+
+struct minimalist_concurrent_skiplist *
+minimalist_concurrent_skiplist_new(minimalist_const_compare_fn compare) {
+  struct minimalist_concurrent_skiplist *list =
+      malloc(sizeof(struct minimalist_concurrent_skiplist));
+
+  if (list == NULL) {
+    return NULL;
+  }
+  list->head = node_new(NULL, NULL, MAX_LEVELS);
+  if (list->head == NULL) {
+    free(list);
+    return NULL;
+  }
+  for (int i = 0; i < MAX_LEVELS; i++) {
+    atomic_init(&list->head->next[i], 0);
+  }
+  list->compare = compare ? compare : address_compare;
+  list->id = atomic_fetch_add(&next_id, 1);
+  atomic_init(&list->epoch, 0);
+  atomic_init(&list->records, NULL);
+  atomic_init(&list->unregistered, 0);
+  atomic_init(&list->orphans, NULL);
+  atomic_init(&list->levels, 1);
+  atomic_init(&list->size, 0);
+  return list;
+}
+
+void
+minimalist_concurrent_skiplist_free(
+    struct minimalist_concurrent_skiplist *list) {
+  struct skiplist_node *node = NULL, *next = NULL;
+  struct epoch_record *record = NULL, *next_record = NULL;
+
+  if (list == NULL) {
+    return;
+  }
+  node = list->head;
+  while (node != NULL) {
+    next = unmarked(atomic_load(&node->next[0]));
+    free(node);
+    node = next;
+  }
+  record = atomic_load(&list->records);
+  while (record != NULL) {
+    next_record = record->next;
+    for (int i = 0; i < 3; i++) {
+      limbo_free(&record->limbo[i]);
+    }
+    free(record);
+    record = next_record;
+  }
+  node = atomic_load(&list->orphans);
+  while (node != NULL) {
+    next = node->retired;
+    free(node);
+    node = next;
+  }
+  free(list);
+}
+
+/* Finds or adds the record of the calling thread */
+static struct epoch_record *
+get_record(struct minimalist_concurrent_skiplist *list) {
+  struct epoch_record *record = NULL;
+  pthread_t self = pthread_self();
+
+  if (cached_record.id == list->id) {
+    return cached_record.record;
+  }
+  record = atomic_load(&list->records);
+  while (record != NULL && !pthread_equal(record->owner, self)) {
+    record = record->next;
+  }
+  if (record == NULL) {
+    record = calloc(1, sizeof(struct epoch_record));
+    if (record == NULL) {
+      return NULL;
+    }
+    record->owner = self;
+    record->random = (uintptr_t)record * 0x9e3779b97f4a7c15ull | 1;
+    record->next = atomic_load(&list->records);
+    while (!atomic_compare_exchange_weak(
+        &list->records, &record->next, record)) {
+    }
+  }
+  cached_record.id = list->id;
+  cached_record.record = record;
+  return record;
+}
+
+/*
+ * Pins the current epoch for the calling thread, reading it again after
+ * publishing it so that the epoch can't have moved on unseen.
+ */
+static struct epoch_record *
+pin(struct minimalist_concurrent_skiplist *list) {
+  struct epoch_record *record = get_record(list);
+  uint64_t epoch = 0;
+
+  if (record == NULL) {
+    /* Keeps the epoch from advancing at all until unpinned */
+    atomic_fetch_add(&list->unregistered, 1);
+    return NULL;
+  }
+  if (record->depth++ == 0) {
+    do {
+      epoch = atomic_load(&list->epoch);
+      atomic_store(&record->epoch, epoch << 1 | 1);
+    } while (atomic_load(&list->epoch) != epoch);
+  }
+  return record;
+}
+
+static void
+unpin(struct minimalist_concurrent_skiplist *list,
+      struct epoch_record *record) {
+  if (record == NULL) {
+    atomic_fetch_sub(&list->unregistered, 1);
+  } else if (--record->depth == 0) {
+    atomic_store_explicit(&record->epoch, 0, memory_order_release);
+  }
+}
+
+/* Advances the epoch if every pinned thread has seen the current one */
+static void
+try_advance(struct minimalist_concurrent_skiplist *list) {
+  uint64_t epoch = atomic_load(&list->epoch), pinned = 0;
+  struct epoch_record *record = atomic_load(&list->records);
+
+  for (; record != NULL; record = record->next) {
+    pinned = atomic_load(&record->epoch);
+    if ((pinned & 1) && pinned >> 1 != epoch) {
+      return;
+    }
+  }
+  if (atomic_load(&list->unregistered) == 0) {
+    atomic_compare_exchange_strong(&list->epoch, &epoch, epoch + 1);
+  }
+}
+
+static void
+reclaim(struct minimalist_concurrent_skiplist *list,
+        struct epoch_record *record) {
+  uint64_t epoch = atomic_load(&list->epoch);
+  for (int i = 0; i < 3; i++) {
+    if (record->limbo[i].nodes != NULL && record->limbo[i].epoch + 2 <= epoch) {
+      limbo_free(&record->limbo[i]);
+    }
+  }
+}
+
+/*
+ * Hands an unlinked node over to be freed. It is tagged with the global
+ * epoch, as threads pinned in it or before may still hold it.
+ */
+static void
+retire(struct minimalist_concurrent_skiplist *list,
+       struct epoch_record *record,
+       struct skiplist_node *node) {
+  uint64_t epoch = atomic_load(&list->epoch);
+  struct limbo *limbo = NULL;
+
+  if (record == NULL) {
+    node->retired = atomic_load(&list->orphans);
+    while (!atomic_compare_exchange_weak(
+        &list->orphans, &node->retired, node)) {
+    }
+    return;
+  }
+  limbo = &record->limbo[epoch % 3];
+  if (limbo->nodes != NULL && limbo->epoch != epoch) {
+    limbo_free(limbo);
+  }
+  limbo->epoch = epoch;
+  node->retired = limbo->nodes;
+  limbo->nodes = node;
+  if (++record->retires % RETIRES_PER_ADVANCE == 0) {
+    try_advance(list);
+    reclaim(list, record);
+  }
+}
+
+static int
+random_height(struct epoch_record *record) {
+  uint64_t bits = 0;
+  int height = 1;
+
+  if (record == NULL) {
+    return 1;
+  }
+  record->random ^= record->random << 13;
+  record->random ^= record->random >> 7;
+  record->random ^= record->random << 17;
+  bits = record->random;
+  while ((bits & 1) && height < MAX_LEVELS) {
+    height++;
+    bits >>= 1;
+  }
+  return height;
+}
+
+/*
+ * Finds the nodes around key on every level, unlinking removed nodes on the
+ * way. preds[i] is the last node ordered before key on level i and succs[i]
+ * the node after it. Returns whether succs[0] holds key.
+ */
+static int
+find(struct minimalist_concurrent_skiplist *list,
+     const void *key,
+     struct skiplist_node **preds,
+     struct skiplist_node **succs) {
+  struct skiplist_node *pred = NULL, *curr = NULL;
+  uintptr_t next = 0;
+  int comparison = 0, levels = 0;
+
+retry:
+  pred = list->head;
+  /* Levels above are empty, or the CAS linking a node there will fail */
+  levels = atomic_load_explicit(&list->levels, memory_order_relaxed);
+  for (int level = MAX_LEVELS - 1; level >= levels; level--) {
+    preds[level] = pred;
+    succs[level] = NULL;
+  }
+  comparison = -1;
+  for (int level = levels - 1; level >= 0; level--) {
+    curr = unmarked(atomic_load(&pred->next[level]));
+    comparison = -1;
+    while (curr != NULL) {
+      next = atomic_load(&curr->next[level]);
+      if (next & MARK) {
+        if (!atomic_compare_exchange_strong(
+                &pred->next[level], &(uintptr_t){(uintptr_t)curr},
+                next & ~MARK)) {
+          goto retry;
+        }
+        curr = unmarked(next);
+        continue;
+      }
+      comparison = list->compare(curr->key, key);
+      if (comparison <= 0) {
+        break;
+      }
+      pred = curr;
+      curr = unmarked(next);
+    }
+    preds[level] = pred;
+    succs[level] = curr;
+  }
+  return succs[0] != NULL && comparison == 0;
+}
+
+/* Finds the first node at or after key without modifying the list */
+static struct skiplist_node *
+search(struct minimalist_concurrent_skiplist *list, const void *key) {
+  struct skiplist_node *pred = list->head, *curr = NULL;
+  int levels = atomic_load_explicit(&list->levels, memory_order_relaxed);
+
+  for (int level = levels - 1; level >= 0; level--) {
+    curr = unmarked(atomic_load(&pred->next[level]));
+    while (curr != NULL) {
+      if (list->compare(curr->key, key) <= 0) {
+        break;
+      }
+      pred = curr;
+      curr = unmarked(atomic_load(&curr->next[level]));
+    }
+  }
+  return curr;
+}
+
+/* Skips removed nodes, which stay ordered until freed */
+static struct skiplist_node *
+first_present(struct skiplist_node *node) {
+  while (node != NULL && (atomic_load(&node->next[0]) & MARK)) {
+    node = unmarked(atomic_load(&node->next[0]));
+  }
+  return node;
+}
+
+/*
+ * Whichever of a node's inserter and remover finishes last frees it, after
+ * a search that unlinks any level the inserter linked late.
+ */
+static void
+finish(struct minimalist_concurrent_skiplist *list,
+       struct epoch_record *record,
+       struct skiplist_node *node,
+       int done) {
+  struct skiplist_node *preds[MAX_LEVELS], *succs[MAX_LEVELS];
+  int state = atomic_fetch_xor(&node->state, done);
+
+  if ((state ^ done) == NODE_REMOVED) {
+    find(list, node->key, preds, succs);
+    retire(list, record, node);
+  }
+}
+
+static void
+raise_levels(struct minimalist_concurrent_skiplist *list, int height) {
+  int levels = atomic_load_explicit(&list->levels, memory_order_relaxed);
+  while (levels < height && !atomic_compare_exchange_weak(
+                                &list->levels, &levels, height)) {
+  }
+}
+
+/* Links a new node, or returns the present node holding key */
+static struct skiplist_node *
+add(struct minimalist_concurrent_skiplist *list,
+    struct epoch_record *record,
+    const void *key,
+    void *value,
+    int *added) {
+  struct skiplist_node *preds[MAX_LEVELS], *succs[MAX_LEVELS];
+  struct skiplist_node *node = NULL;
+  uintptr_t next = 0;
+  int height = 0;
+
+  *added = 0;
+  for (;;) {
+    if (find(list, key, preds, succs)) {
+      free(node);
+      return succs[0];
+    }
+    if (node == NULL) {
+      height = random_height(record);
+      node = node_new(key, value, height);
+      if (node == NULL) {
+        return NULL;
+      }
+    }
+    for (int i = 0; i < height; i++) {
+      atomic_store_explicit(
+          &node->next[i], (uintptr_t)succs[i], memory_order_relaxed);
+    }
+    if (atomic_compare_exchange_strong(
+            &preds[0]->next[0], &(uintptr_t){(uintptr_t)succs[0]},
+            (uintptr_t)node)) {
+      break;
+    }
+  }
+  *added = 1;
+  atomic_fetch_add_explicit(&list->size, 1, memory_order_relaxed);
+  raise_levels(list, height);
+
+  /* The node is in the list; link the levels above unless it gets removed */
+  for (int i = 1; i < height; i++) {
+    for (;;) {
+      next = atomic_load(&node->next[i]);
+      if ((next & MARK) ||
+          (next != (uintptr_t)succs[i] &&
+           !atomic_compare_exchange_strong(
+               &node->next[i], &next, (uintptr_t)succs[i]))) {
+        goto done;
+      }
+      if (atomic_compare_exchange_strong(
+              &preds[i]->next[i], &(uintptr_t){(uintptr_t)succs[i]},
+              (uintptr_t)node)) {
+        break;
+      }
+      if (!find(list, key, preds, succs) || succs[0] != node) {
+        goto done;
+      }
+    }
+  }
+done:
+  finish(list, record, node, NODE_BUILDING);
+  return node;
+}
+
+int
+minimalist_concurrent_skiplist_insert(
+    struct minimalist_concurrent_skiplist *list,
+    const void *key,
+    void *value) {
+  struct epoch_record *record = pin(list);
+  int added = 0;
+  struct skiplist_node *node = add(list, record, key, value, &added);
+
+  unpin(list, record);
+  return node == NULL ? -1 : added;
+}
+
+int
+minimalist_concurrent_skiplist_set(struct minimalist_concurrent_skiplist *list,
+                                   const void *key,
+                                   void *value) {
+  struct epoch_record *record = pin(list);
+  int added = 0;
+  struct skiplist_node *node = add(list, record, key, value, &added);
+
+  if (node != NULL && !added) {
+    atomic_store(&node->value, value);
+  }
+  unpin(list, record);
+  return node == NULL ? -1 : added;
+}
+
+void *
+minimalist_concurrent_skiplist_get(struct minimalist_concurrent_skiplist *list,
+                                   const void *key) {
+  struct epoch_record *record = pin(list);
+  struct skiplist_node *node = first_present(search(list, key));
+  void *value = NULL;
+
+  if (node != NULL && list->compare(node->key, key) == 0) {
+    value = atomic_load(&node->value);
+  }
+  unpin(list, record);
+  return value;
+}
+
+int
+minimalist_concurrent_skiplist_contains(
+    struct minimalist_concurrent_skiplist *list, const void *key) {
+  struct epoch_record *record = pin(list);
+  struct skiplist_node *node = first_present(search(list, key));
+  int found = node != NULL && list->compare(node->key, key) == 0;
+
+  unpin(list, record);
+  return found;
+}
+
+int
+minimalist_concurrent_skiplist_remove(
+    struct minimalist_concurrent_skiplist *list,
+    const void *key,
+    void **old_value) {
+  struct skiplist_node *preds[MAX_LEVELS], *succs[MAX_LEVELS];
+  struct epoch_record *record = pin(list);
+  struct skiplist_node *node = NULL;
+  uintptr_t next = 0;
+  int removed = 0;
+
+  if (find(list, key, preds, succs)) {
+    node = succs[0];
+    for (int i = node->height - 1; i > 0; i--) {
+      next = atomic_load(&node->next[i]);
+      while (!(next & MARK) && !atomic_compare_exchange_weak(
+                                    &node->next[i], &next, next | MARK)) {
+      }
+    }
+    next = atomic_load(&node->next[0]);
+    while (!(next & MARK) && !removed) {
+      removed =
+          atomic_compare_exchange_weak(&node->next[0], &next, next | MARK);
+    }
+  }
+  if (removed) {
+    if (old_value) {
+      *old_value = atomic_load(&node->value);
+    }
+    atomic_fetch_sub_explicit(&list->size, 1, memory_order_relaxed);
+    finish(list, record, node, NODE_REMOVED);
+  }
+  unpin(list, record);
+  return removed;
+}
+
+size_t
+minimalist_concurrent_skiplist_size(
+    struct minimalist_concurrent_skiplist *list) {
+  return atomic_load_explicit(&list->size, memory_order_relaxed);
+}
+
+void
+minimalist_concurrent_skiplist_run(struct minimalist_concurrent_skiplist *list,
+                                   const void *from,
+                                   minimalist_concurrent_skiplist_run_fn run,
+                                   void *context) {
+  struct epoch_record *record = NULL;
+  struct skiplist_node *node = NULL;
+
+  if (run == NULL) {
+    return;
+  }
+  record = pin(list);
+  node = from ? search(list, from)
+              : unmarked(atomic_load(&list->head->next[0]));
+  for (node = first_present(node); node != NULL;
+       node = first_present(unmarked(atomic_load(&node->next[0])))) {
+    if (run(context, node->key, atomic_load(&node->value))) {
+      break;
+    }
+  }
+  unpin(list, record);
+}
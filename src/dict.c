@@ -0,0 +1,251 @@
+#include "minimalist/dict.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 2^64 divided by the golden ratio, used for Fibonacci hashing */
+#define FIBONACCI_MULTIPLIER 0x9e3779b97f4a7c15ull
+
+/* Index slot values, truncated to the slot width */
+#define SLOT_EMPTY SIZE_MAX
+#define SLOT_DELETED (SIZE_MAX - 1)
+
+#define MIN_SLOTS 8
+
+/* A removed entry keeps its place with a NULL value until compacted */
+struct dict_entry {
+  size_t hash;
+  const void *key;
+  void *value;
+};
+
+/*
+ * The index is an open-addressed table of entry numbers, probed linearly.
+ * It is kept at most two thirds full, counting the entries removed since the
+ * last compaction, so num_entries never exceeds capacity.
+ */
+struct minimalist_dict {
+  minimalist_hash_fn hash;
+  minimalist_const_compare_fn compare;
+  size_t num_slots;
+  unsigned int shift;
+  unsigned int width;
+  void *index;
+  struct dict_entry *entries;
+  size_t num_entries;
+  size_t capacity;
+  size_t size;
+};
+
+static size_t
+slot_get(const struct minimalist_dict *dict, size_t slot) {
+  uint64_t value = 0, max = 0;
+  switch (dict->width) {
+  case 1:
+    value = ((const uint8_t *)dict->index)[slot];
+    max = UINT8_MAX;
+    break;
+  case 2:
+    value = ((const uint16_t *)dict->index)[slot];
+    max = UINT16_MAX;
+    break;
+  case 4:
+    value = ((const uint32_t *)dict->index)[slot];
+    max = UINT32_MAX;
+    break;
+  default:
+    return (size_t)((const uint64_t *)dict->index)[slot];
+  }
+  /* Widen the two reserved values */
+  return value >= max - 1 ? (size_t)(value - max) + SLOT_EMPTY : value;
+}
+
+static void
+slot_set(struct minimalist_dict *dict, size_t slot, size_t value) {
+  switch (dict->width) {
+  case 1:
+    ((uint8_t *)dict->index)[slot] = (uint8_t)value;
+    break;
+  case 2:
+    ((uint16_t *)dict->index)[slot] = (uint16_t)value;
+    break;
+  case 4:
+    ((uint32_t *)dict->index)[slot] = (uint32_t)value;
+    break;
+  default:
+    ((uint64_t *)dict->index)[slot] = value;
+    break;
+  }
+}
+
+static size_t
+first_slot(const struct minimalist_dict *dict, size_t hash) {
+  return (size_t)(((uint64_t)hash * FIBONACCI_MULTIPLIER) >> dict->shift);
+}
+
+/* Returns the slot holding key, or the first empty slot on its probe path */
+static size_t
+find_slot(const struct minimalist_dict *dict, const void *key, size_t hash) {
+  size_t slot = first_slot(dict, hash), entry = 0;
+  const struct dict_entry *found = NULL;
+
+  while ((entry = slot_get(dict, slot)) != SLOT_EMPTY) {
+    if (entry != SLOT_DELETED) {
+      found = &dict->entries[entry];
+      if (found->hash == hash && dict->compare(found->key, key) == 0) {
+        break;
+      }
+    }
+    slot = (slot + 1) & (dict->num_slots - 1);
+  }
+  return slot;
+}
+
+static size_t
+free_slot(const struct minimalist_dict *dict, size_t hash) {
+  size_t slot = first_slot(dict, hash), entry = 0;
+  while ((entry = slot_get(dict, slot)) != SLOT_EMPTY &&
+         entry != SLOT_DELETED) {
+    slot = (slot + 1) & (dict->num_slots - 1);
+  }
+  return slot;
+}
+
+/* Compacts the entries into a table with room for twice the current size */
+static int
+resize(struct minimalist_dict *dict) {
+  size_t num_slots = MIN_SLOTS, capacity = 0, size = 0;
+  unsigned int shift = 64 - 3, width = 8;
+  struct dict_entry *entries = NULL;
+  void *index = NULL;
+
+  while (num_slots / 3 * 2 < dict->size * 2 + 1) {
+    num_slots <<= 1;
+    shift--;
+  }
+  capacity = num_slots / 3 * 2;
+  if (num_slots <= (size_t)UINT8_MAX + 1) {
+    width = 1;
+  } else if (num_slots <= (size_t)UINT16_MAX + 1) {
+    width = 2;
+  } else if (num_slots <= (size_t)UINT32_MAX + 1) {
+    width = 4;
+  }
+  entries = malloc(sizeof(struct dict_entry) * capacity);
+  index = malloc(width * num_slots);
+  if (entries == NULL || index == NULL) {
+    free(entries);
+    free(index);
+    return 0;
+  }
+
+  for (size_t i = 0; i < dict->num_entries; i++) {
+    if (dict->entries[i].value != NULL) {
+      entries[size++] = dict->entries[i];
+    }
+  }
+  free(dict->entries);
+  free(dict->index);
+  dict->entries = entries;
+  dict->index = index;
+  dict->num_slots = num_slots;
+  dict->shift = shift;
+  dict->width = width;
+  dict->num_entries = size;
+  dict->capacity = capacity;
+  memset(index, 0xff, width * num_slots);
+  for (size_t i = 0; i < size; i++) {
+    slot_set(dict, free_slot(dict, entries[i].hash), i);
+  }
+  return 1;
+}
+
+struct minimalist_dict *
+minimalist_dict_new(minimalist_hash_fn hash,
+                    minimalist_const_compare_fn compare) {
+  struct minimalist_dict *dict = NULL;
+
+  if (hash == NULL || compare == NULL) {
+    return NULL;
+  }
+  dict = calloc(1, sizeof(struct minimalist_dict));
+  if (dict) {
+    dict->hash = hash;
+    dict->compare = compare;
+    if (!resize(dict)) {
+      free(dict);
+      dict = NULL;
+    }
+  }
+  return dict;
+}
+
+void
+minimalist_dict_free(struct minimalist_dict *dict) {
+  if (dict != NULL) {
+    free(dict->entries);
+    free(dict->index);
+    free(dict);
+  }
+}
+
+void
+minimalist_dict_set(struct minimalist_dict *dict,
+                    const void *key,
+                    void *value) {
+  size_t hash = dict->hash(key);
+  size_t slot = find_slot(dict, key, hash);
+  size_t entry = slot_get(dict, slot);
+
+  if (entry != SLOT_EMPTY) {
+    dict->entries[entry].value = value;
+    if (value == NULL) {
+      slot_set(dict, slot, SLOT_DELETED);
+      dict->entries[entry].key = NULL;
+      dict->size--;
+      if (dict->num_entries > MIN_SLOTS &&
+          dict->size <= dict->num_entries / 2) {
+        resize(dict);
+      }
+    }
+  } else if (value != NULL) {
+    if (dict->num_entries == dict->capacity && !resize(dict)) {
+      return;
+    }
+    entry = dict->num_entries++;
+    dict->entries[entry].hash = hash;
+    dict->entries[entry].key = key;
+    dict->entries[entry].value = value;
+    slot_set(dict, free_slot(dict, hash), entry);
+    dict->size++;
+  }
+}
+
+void *
+minimalist_dict_get(struct minimalist_dict *dict, const void *key) {
+  size_t hash = dict->hash(key);
+  size_t entry = slot_get(dict, find_slot(dict, key, hash));
+  return entry != SLOT_EMPTY ? dict->entries[entry].value : NULL;
+}
+
+size_t
+minimalist_dict_size(struct minimalist_dict *dict) {
+  return dict->size;
+}
+
+void
+minimalist_dict_run(struct minimalist_dict *dict,
+                    minimalist_dict_run_fn run,
+                    void *context) {
+  const struct dict_entry *entry = NULL;
+
+  if (run) {
+    for (size_t i = 0; i < dict->num_entries; i++) {
+      entry = &dict->entries[i];
+      if (entry->value != NULL) {
+        run(context, entry->key, entry->value);
+      }
+    }
+  }
+}
@@ -1,30 +1,42 @@
 #include "minimalist/graph.h"
 
-#include "minimalist/map.h"
-#include "minimalist/set.h"
+#include "graph_internal.h"
+#include "minimalist/hash.h"
+#include "minimalist/hash_map.h"
 
-#include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
-struct adjacency_list {
-  int num_neighbors;
-  void **neighbors;
-};
+/* Initial number of vertex slots and ID buckets */
+#define INITIAL_VERTICES 16
 
-typedef void **adjacency_list;
+/*
+ * Lists with more room than this keep an index of their neighbors after the
+ * neighbors themselves, in the same allocation. The index is a linear probing
+ * table of positions in the list, at most half full, keyed by the neighbor at
+ * that position, so has_edge and remove_edge don't scan hub vertices.
+ */
+#define HASHED_NEIGHBORS 32
+#define EMPTY_SLOT MINIMALIST_GRAPH_INVALID
 
-struct minimalist_graph {
-  int directed;
-  struct minimalist_map *adjacency_lists;
-};
+static void tracking_free(struct minimalist_graph *graph);
+static int tracking_reserve(struct minimalist_graph *graph, uint32_t capacity);
+static void tracking_add_vertex(struct minimalist_graph *graph, uint32_t id);
+static int tracking_add_edge(struct minimalist_graph *graph,
+                             uint32_t a,
+                             uint32_t b);
+static int reorder(struct minimalist_graph *graph, uint32_t a, uint32_t b);
 
 struct minimalist_graph *
 minimalist_graph_new(int directed) {
   struct minimalist_graph *graph = calloc(1, sizeof(struct minimalist_graph));
   if (graph) {
     graph->directed = directed;
-    graph->adjacency_lists = minimalist_map_new(NULL);
-    if (graph->adjacency_lists == NULL) {
+    graph->num_buckets = INITIAL_VERTICES;
+    graph->ids = minimalist_hash_map_new(
+        graph->num_buckets, minimalist_hash_pointer, address_equal);
+    if (graph->ids == NULL) {
       free(graph);
       graph = NULL;
     }
@@ -32,67 +44,489 @@ minimalist_graph_new(int directed) {
   return graph;
 }
 
-static void
-run_free(void *context, const void *key, void *value) {
-  if (value) {
-    free(value);
-  }
+/* Whether list points into the edges shared by all lists of a loaded graph */
+static int
+list_shared(const struct minimalist_graph *graph,
+            const struct adjacency_list *list) {
+  uintptr_t address = (uintptr_t)list->neighbors;
+  return list->capacity > INLINE_NEIGHBORS &&
+         address - (uintptr_t)graph->edges <
+             graph->num_edges * sizeof(uint32_t);
 }
 
 void
 minimalist_graph_free(struct minimalist_graph *graph) {
   if (graph != NULL) {
-    if (graph->adjacency_lists) {
-      minimalist_map_run(graph->adjacency_lists, run_free, NULL);
+    for (uint32_t i = 0; i < graph->num_vertices; i++) {
+      if (graph->lists[i].capacity > INLINE_NEIGHBORS &&
+          !list_shared(graph, &graph->lists[i])) {
+        free(graph->lists[i].neighbors);
+      }
     }
-    minimalist_map_free(graph->adjacency_lists);
+    tracking_free(graph);
+    free(graph->edges);
+    minimalist_hash_map_free(graph->ids);
+    free(graph->vertices);
+    free(graph->lists);
     free(graph);
   }
 }
 
+static uint32_t *
+list_neighbors(struct adjacency_list *list) {
+  return list->capacity > INLINE_NEIGHBORS ? list->neighbors
+                                           : list->inline_neighbors;
+}
+
+static int
+list_hashed(const struct minimalist_graph *graph,
+            const struct adjacency_list *list) {
+  return list->capacity > HASHED_NEIGHBORS && !list_shared(graph, list);
+}
+
+/* Number of index slots for a list with room for capacity neighbors */
+static size_t
+index_size(uint32_t capacity) {
+  size_t size = 1;
+  while (size < (size_t)capacity * 2) {
+    size *= 2;
+  }
+  return size;
+}
+
+/* Finds the slot holding position, or any position of neighbor if EMPTY_SLOT */
+static uint32_t *
+index_find(struct adjacency_list *list, uint32_t neighbor, uint32_t position) {
+  uint32_t *index = list->neighbors + list->capacity;
+  size_t mask = index_size(list->capacity) - 1;
+  size_t i = minimalist_hash_u32(neighbor) & mask;
+
+  for (; index[i] != EMPTY_SLOT; i = (i + 1) & mask) {
+    if (list->neighbors[index[i]] == neighbor &&
+        (position == EMPTY_SLOT || index[i] == position)) {
+      return &index[i];
+    }
+  }
+  return NULL;
+}
+
+static void
+index_insert(struct adjacency_list *list, uint32_t position) {
+  uint32_t *index = list->neighbors + list->capacity;
+  size_t mask = index_size(list->capacity) - 1;
+  size_t i = minimalist_hash_u32(list->neighbors[position]) & mask;
+
+  while (index[i] != EMPTY_SLOT) {
+    i = (i + 1) & mask;
+  }
+  index[i] = position;
+}
+
+/* Empties a slot, moving later entries back so no probe stops short */
 static void
-add_neighbor(struct minimalist_graph *graph, void *a, void *b) {
-  struct adjacency_list *list = minimalist_map_get(graph->adjacency_lists, a);
-  if (list == NULL) {
-    list = malloc(sizeof(struct adjacency_list));
-    list->num_neighbors = 1;
-    list->neighbors = malloc(sizeof(void *) * list->num_neighbors);
-    list->neighbors[0] = b;
-    minimalist_map_set(graph->adjacency_lists, a, list);
+index_erase(struct adjacency_list *list, uint32_t *slot) {
+  uint32_t *index = list->neighbors + list->capacity;
+  size_t mask = index_size(list->capacity) - 1;
+  size_t hole = (size_t)(slot - index), i = hole, home = 0;
+
+  for (i = (i + 1) & mask; index[i] != EMPTY_SLOT; i = (i + 1) & mask) {
+    home = minimalist_hash_u32(list->neighbors[index[i]]) & mask;
+    /* The entry may move unless its probe starts after the hole */
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      index[hole] = index[i];
+      hole = i;
+    }
+  }
+  index[hole] = EMPTY_SLOT;
+}
+
+static void
+index_build(struct adjacency_list *list) {
+  memset(list->neighbors + list->capacity,
+         0xff,
+         sizeof(uint32_t) * index_size(list->capacity));
+  for (uint32_t i = 0; i < list->num_neighbors; i++) {
+    index_insert(list, i);
+  }
+}
+
+/* Moves a list to an allocation of its own with room for capacity neighbors */
+static int
+list_resize(struct minimalist_graph *graph,
+            struct adjacency_list *list,
+            uint32_t capacity) {
+  size_t size = sizeof(uint32_t) * capacity;
+  uint32_t *neighbors = NULL;
+
+  if (capacity > HASHED_NEIGHBORS) {
+    size += sizeof(uint32_t) * index_size(capacity);
+  }
+  if (list->capacity == INLINE_NEIGHBORS || list_shared(graph, list)) {
+    neighbors = malloc(size);
+    if (neighbors == NULL) {
+      return 0;
+    }
+    memcpy(neighbors,
+           list_neighbors(list),
+           sizeof(uint32_t) * list->num_neighbors);
   } else {
-    list->num_neighbors++;
-    list->neighbors =
-        realloc(list->neighbors, sizeof(void *) * list->num_neighbors);
-    list->neighbors[list->num_neighbors - 1] = b;
+    neighbors = realloc(list->neighbors, size);
+    if (neighbors == NULL) {
+      return 0;
+    }
+  }
+  list->neighbors = neighbors;
+  list->capacity = capacity;
+  if (capacity > HASHED_NEIGHBORS) {
+    index_build(list);
+  }
+  return 1;
+}
+
+/* Returns a position of b in the list, or MINIMALIST_GRAPH_INVALID */
+static uint32_t
+list_find(const struct minimalist_graph *graph,
+          struct adjacency_list *list,
+          uint32_t b) {
+  const uint32_t *neighbors = list_neighbors(list);
+  const uint32_t *slot = NULL;
+  uint32_t low = 0, high = list->num_neighbors, middle = 0;
+
+  if (list_hashed(graph, list)) {
+    slot = index_find(list, b, EMPTY_SLOT);
+    return slot ? *slot : MINIMALIST_GRAPH_INVALID;
+  }
+  if (list_shared(graph, list)) {
+    /* Loaded lists are sorted */
+    while (low < high) {
+      middle = low + (high - low) / 2;
+      if (neighbors[middle] < b) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return low < list->num_neighbors && neighbors[low] == b
+               ? low
+               : MINIMALIST_GRAPH_INVALID;
+  }
+  for (uint32_t i = 0; i < list->num_neighbors; i++) {
+    if (neighbors[i] == b) {
+      return i;
+    }
+  }
+  return MINIMALIST_GRAPH_INVALID;
+}
+
+/*
+ * Removes the neighbor at position by moving the last one into its place.
+ * The list must not be shared.
+ */
+static void
+list_remove(struct minimalist_graph *graph,
+            struct adjacency_list *list,
+            uint32_t position) {
+  uint32_t *neighbors = list_neighbors(list);
+  uint32_t last = list->num_neighbors - 1;
+
+  if (list_hashed(graph, list)) {
+    index_erase(list, index_find(list, neighbors[position], position));
+    if (position != last) {
+      *index_find(list, neighbors[last], last) = position;
+    }
+  }
+  neighbors[position] = neighbors[last];
+  list->num_neighbors--;
+}
+
+static int
+grow_ids(struct minimalist_graph *graph) {
+  size_t num_buckets = graph->num_buckets * 2;
+  struct minimalist_hash_map *ids = minimalist_hash_map_new(
+      num_buckets, minimalist_hash_pointer, address_equal);
+  if (ids == NULL) {
+    return 0;
+  }
+  for (uint32_t i = 0; i < graph->num_vertices; i++) {
+    minimalist_hash_map_set(
+        ids, graph->vertices[i], (void *)((uintptr_t)i + 1));
+  }
+  minimalist_hash_map_free(graph->ids);
+  graph->ids = ids;
+  graph->num_buckets = num_buckets;
+  return 1;
+}
+
+static int
+grow_vertices(struct minimalist_graph *graph) {
+  uint32_t capacity =
+      graph->capacity ? graph->capacity * 2 : INITIAL_VERTICES;
+  void **vertices = NULL;
+  struct adjacency_list *lists = NULL;
+
+  if (capacity <= graph->capacity || capacity == MINIMALIST_GRAPH_INVALID) {
+    return 0;
+  }
+  vertices = realloc(graph->vertices, sizeof(void *) * capacity);
+  if (vertices == NULL) {
+    return 0;
+  }
+  graph->vertices = vertices;
+  lists = realloc(graph->lists, sizeof(struct adjacency_list) * capacity);
+  if (lists == NULL) {
+    return 0;
+  }
+  graph->lists = lists;
+  if (graph->tracking && !tracking_reserve(graph, capacity)) {
+    return 0;
+  }
+  graph->capacity = capacity;
+  return 1;
+}
+
+uint32_t
+minimalist_graph_add_vertex(struct minimalist_graph *graph, void *vertex) {
+  uint32_t id = minimalist_graph_vertex_id(graph, vertex);
+  struct adjacency_list *list = NULL;
+
+  if (id != MINIMALIST_GRAPH_INVALID) {
+    return id;
+  }
+  if (graph->num_vertices == graph->capacity && !grow_vertices(graph)) {
+    return MINIMALIST_GRAPH_INVALID;
+  }
+  if (graph->num_vertices >= graph->num_buckets && !grow_ids(graph)) {
+    return MINIMALIST_GRAPH_INVALID;
+  }
+  id = graph->num_vertices++;
+  graph->vertices[id] = vertex;
+  list = &graph->lists[id];
+  list->num_neighbors = 0;
+  list->capacity = INLINE_NEIGHBORS;
+  minimalist_hash_map_set(graph->ids, vertex, (void *)((uintptr_t)id + 1));
+  if (graph->tracking) {
+    tracking_add_vertex(graph, id);
+  }
+  return id;
+}
+
+uint32_t
+minimalist_graph_vertex_id(struct minimalist_graph *graph,
+                           const void *vertex) {
+  uintptr_t id = (uintptr_t)minimalist_hash_map_get(graph->ids, vertex);
+  return id ? (uint32_t)(id - 1) : MINIMALIST_GRAPH_INVALID;
+}
+
+void *
+minimalist_graph_vertex(struct minimalist_graph *graph, uint32_t id) {
+  return id < graph->num_vertices ? graph->vertices[id] : NULL;
+}
+
+uint32_t
+minimalist_graph_num_vertices(struct minimalist_graph *graph) {
+  return graph->num_vertices;
+}
+
+static int
+list_add(struct minimalist_graph *graph,
+         struct adjacency_list *list,
+         uint32_t b) {
+  if (list->num_neighbors == list->capacity &&
+      !list_resize(graph, list, list->capacity * 2)) {
+    return 0;
+  }
+  list_neighbors(list)[list->num_neighbors++] = b;
+  if (list_hashed(graph, list)) {
+    index_insert(list, list->num_neighbors - 1);
+  }
+  return 1;
+}
+
+/* Undoes the last list_add */
+static void
+list_pop(struct minimalist_graph *graph, struct adjacency_list *list) {
+  list_remove(graph, list, list->num_neighbors - 1);
+}
+
+static int
+link_edge(struct minimalist_graph *graph, uint32_t a, uint32_t b) {
+  if (!list_add(graph, &graph->lists[a], b)) {
+    return 0;
   }
+  if (!graph->directed && !list_add(graph, &graph->lists[b], a)) {
+    list_pop(graph, &graph->lists[a]);
+    return 0;
+  }
+  if (graph->tracking && !tracking_add_edge(graph, a, b)) {
+    if (!graph->directed) {
+      list_pop(graph, &graph->lists[b]);
+    }
+    list_pop(graph, &graph->lists[a]);
+    return 0;
+  }
+  return 1;
+}
+
+void
+minimalist_graph_add_edge_id(struct minimalist_graph *graph,
+                             uint32_t a,
+                             uint32_t b) {
+  if (a >= graph->num_vertices || b >= graph->num_vertices) {
+    return;
+  }
+  if (graph->unique && minimalist_graph_has_edge_id(graph, a, b)) {
+    return;
+  }
+  /* An unchecked edge may close a cycle and leave no topological order */
+  if (graph->tracking && graph->directed && graph->order_valid &&
+      !reorder(graph, a, b)) {
+    graph->order_valid = 0;
+  }
+  link_edge(graph, a, b);
 }
 
 void
 minimalist_graph_add_edge(struct minimalist_graph *graph, void *a, void *b) {
-  add_neighbor(graph, a, b);
+  uint32_t id_a = minimalist_graph_add_vertex(graph, a);
+  uint32_t id_b = minimalist_graph_add_vertex(graph, b);
+  minimalist_graph_add_edge_id(graph, id_a, id_b);
+}
+
+void
+minimalist_graph_set_unique_edges(struct minimalist_graph *graph,
+                                  int unique) {
+  graph->unique = unique;
+}
+
+int
+minimalist_graph_has_edge_id(struct minimalist_graph *graph,
+                             uint32_t a,
+                             uint32_t b) {
+  if (a >= graph->num_vertices || b >= graph->num_vertices) {
+    return 0;
+  }
+  /* Undirected edges are in both lists, so search the shorter one */
+  if (!graph->directed &&
+      graph->lists[b].num_neighbors < graph->lists[a].num_neighbors) {
+    return list_find(graph, &graph->lists[b], a) != MINIMALIST_GRAPH_INVALID;
+  }
+  return list_find(graph, &graph->lists[a], b) != MINIMALIST_GRAPH_INVALID;
+}
+
+int
+minimalist_graph_has_edge(struct minimalist_graph *graph,
+                          const void *a,
+                          const void *b) {
+  return minimalist_graph_has_edge_id(graph,
+                                      minimalist_graph_vertex_id(graph, a),
+                                      minimalist_graph_vertex_id(graph, b));
+}
+
+int
+minimalist_graph_remove_edge_id(struct minimalist_graph *graph,
+                                uint32_t a,
+                                uint32_t b) {
+  struct adjacency_list *list_a = NULL, *list_b = NULL;
+  uint32_t position = 0;
+
+  if (a >= graph->num_vertices || b >= graph->num_vertices) {
+    return 0;
+  }
+  list_a = &graph->lists[a];
+  list_b = &graph->lists[b];
+  position = list_find(graph, list_a, b);
+  if (position == MINIMALIST_GRAPH_INVALID) {
+    return 0;
+  }
+  /* Lists leave the shared edges before anything is removed */
+  if ((list_shared(graph, list_a) &&
+       !list_resize(graph, list_a, list_a->capacity)) ||
+      (!graph->directed && list_shared(graph, list_b) &&
+       !list_resize(graph, list_b, list_b->capacity))) {
+    return -1;
+  }
+  list_remove(graph, list_a, position);
   if (!graph->directed) {
-    add_neighbor(graph, b, a);
+    /* A loop is in its list twice */
+    position = list_find(graph, list_b, a);
+    if (position != MINIMALIST_GRAPH_INVALID) {
+      list_remove(graph, list_b, position);
+    }
+  }
+  if (graph->tracking && graph->directed) {
+    /* The topological order stays valid without the edge */
+    list_b = &graph->predecessors[b];
+    list_remove(graph, list_b, list_find(graph, list_b, a));
+  } else if (graph->tracking) {
+    /* The union-find can't split, so it's set up again when next needed */
+    tracking_free(graph);
   }
+  return 1;
+}
+
+int
+minimalist_graph_remove_edge(struct minimalist_graph *graph,
+                             const void *a,
+                             const void *b) {
+  return minimalist_graph_remove_edge_id(
+      graph,
+      minimalist_graph_vertex_id(graph, a),
+      minimalist_graph_vertex_id(graph, b));
+}
+
+uint32_t
+minimalist_graph_get_neighbor_ids(struct minimalist_graph *graph,
+                                  uint32_t id,
+                                  const uint32_t **neighbors) {
+  if (id >= graph->num_vertices) {
+    *neighbors = NULL;
+    return 0;
+  }
+  *neighbors = list_neighbors(&graph->lists[id]);
+  return graph->lists[id].num_neighbors;
+}
+
+minimalist_graph_neighbor_list_t
+minimalist_graph_get_neighbors(struct minimalist_graph *graph, void *node) {
+  uint32_t id = minimalist_graph_vertex_id(graph, node);
+  const uint32_t *ids = NULL;
+  uint32_t num_neighbors = 0;
+  void **neighbors = NULL;
+
+  if (id == MINIMALIST_GRAPH_INVALID) {
+    return NULL;
+  }
+  num_neighbors = minimalist_graph_get_neighbor_ids(graph, id, &ids);
+  neighbors = malloc(sizeof(void *) * (num_neighbors + (size_t)1));
+  if (neighbors) {
+    for (uint32_t i = 0; i < num_neighbors; i++) {
+      neighbors[i] = graph->vertices[ids[i]];
+    }
+    neighbors[num_neighbors] = NULL;
+  }
+  return neighbors;
 }
 
 static int
-dfs(struct minimalist_map *adjacency_lists,
-    struct minimalist_set *visited,
-    const void *current,
-    const void *parent) {
+dfs(struct minimalist_graph *graph,
+    unsigned char *visited,
+    uint32_t current,
+    uint32_t parent) {
 
-  struct adjacency_list *list = NULL;
-  minimalist_set_add(visited, current);
-  list = minimalist_map_get(adjacency_lists, current);
-  if (list) {
-    for (int i = 0; i < list->num_neighbors; i++) {
-      if (list->neighbors[i] != parent) {
-        if (minimalist_set_exists(visited, list->neighbors[i])) {
+  struct adjacency_list *list = &graph->lists[current];
+  uint32_t *neighbors = list_neighbors(list);
+  int skipped = 0;
+  visited[current] = 1;
+  for (uint32_t i = 0; i < list->num_neighbors; i++) {
+    /* Only the edge taken from parent is skipped, so parallel edges count */
+    if (neighbors[i] == parent && !skipped) {
+      skipped = 1;
+    } else {
+      if (visited[neighbors[i]]) {
+        return 1;
+      } else {
+        if (dfs(graph, visited, neighbors[i], current) == 1) {
           return 1;
-        } else {
-          if (dfs(adjacency_lists, visited, list->neighbors[i], current) == 1) {
-            return 1;
-          }
         }
       }
     }
@@ -102,23 +536,352 @@ dfs(struct minimalist_map *adjacency_lists,
 
 int
 minimalist_graph_cyclic(struct minimalist_graph *graph) {
-  struct minimalist_set *visited = minimalist_set_new(NULL);
+  unsigned char *visited = calloc(graph->num_vertices + (size_t)1, 1);
+  int cyclic = 0;
 
   if (visited) {
-    minimalist_map_keys_t nodes = NULL;
-    int num_nodes = minimalist_map_keys(graph->adjacency_lists, &nodes);
+    for (uint32_t i = 0; i < graph->num_vertices && !cyclic; i++) {
+      if (!visited[i]) {
+        cyclic = dfs(graph, visited, i, MINIMALIST_GRAPH_INVALID);
+      }
+    }
+    free(visited);
+  }
+  return cyclic;
+}
 
-    for (int i = 0; i < num_nodes; i++) {
-      if (!minimalist_set_exists(visited, nodes[i])) {
-        if (dfs(graph->adjacency_lists, visited, nodes[i], NULL)) {
-          return 1;
-        }
+/*
+ * Online cycle detection keeps, for undirected graphs, a union-find over the
+ * vertices: an edge closes a cycle if its ends are already connected. For
+ * directed graphs it keeps a topological order, updated on each edge with
+ * the Pearce-Kelly algorithm: an edge a -> b with a after b only disturbs the
+ * vertices ordered between them, so only those are searched and reordered.
+ */
+static void
+tracking_free(struct minimalist_graph *graph) {
+  if (graph->tracking && graph->predecessors) {
+    for (uint32_t i = 0; i < graph->num_vertices; i++) {
+      if (graph->predecessors[i].capacity > INLINE_NEIGHBORS) {
+        free(graph->predecessors[i].neighbors);
       }
     }
-    if (nodes != NULL) {
-      free(nodes);
+  }
+  free(graph->parents);
+  free(graph->ranks);
+  free(graph->order);
+  free(graph->predecessors);
+  free(graph->marks);
+  free(graph->stack);
+  free(graph->affected);
+  graph->parents = NULL;
+  graph->ranks = NULL;
+  graph->order = NULL;
+  graph->predecessors = NULL;
+  graph->marks = NULL;
+  graph->stack = NULL;
+  graph->affected = NULL;
+  graph->tracking = 0;
+}
+
+#define RESERVE(array, capacity)                                              \
+  do {                                                                        \
+    void *resized = realloc((array), sizeof(*(array)) * (capacity));          \
+    if (resized == NULL) {                                                    \
+      return 0;                                                               \
+    }                                                                         \
+    (array) = resized;                                                        \
+  } while (0)
+
+static int
+tracking_reserve(struct minimalist_graph *graph, uint32_t capacity) {
+  if (graph->directed) {
+    RESERVE(graph->order, capacity);
+    RESERVE(graph->predecessors, capacity);
+    RESERVE(graph->marks, capacity);
+    RESERVE(graph->stack, capacity);
+    RESERVE(graph->affected, capacity);
+  } else {
+    RESERVE(graph->parents, capacity);
+    RESERVE(graph->ranks, capacity);
+  }
+  return 1;
+}
+
+static void
+tracking_add_vertex(struct minimalist_graph *graph, uint32_t id) {
+  if (graph->directed) {
+    /* Orders are a permutation of the IDs, so the new vertex goes last */
+    graph->order[id] = id;
+    graph->predecessors[id].num_neighbors = 0;
+    graph->predecessors[id].capacity = INLINE_NEIGHBORS;
+    graph->marks[id] = 0;
+  } else {
+    graph->parents[id] = id;
+    graph->ranks[id] = 0;
+  }
+}
+
+static uint32_t
+find_root(struct minimalist_graph *graph, uint32_t v) {
+  while (graph->parents[v] != v) {
+    graph->parents[v] = graph->parents[graph->parents[v]];
+    v = graph->parents[v];
+  }
+  return v;
+}
+
+static void
+unite(struct minimalist_graph *graph, uint32_t a, uint32_t b) {
+  a = find_root(graph, a);
+  b = find_root(graph, b);
+  if (a == b) {
+    return;
+  }
+  if (graph->ranks[a] < graph->ranks[b]) {
+    graph->parents[a] = b;
+  } else {
+    graph->parents[b] = a;
+    if (graph->ranks[a] == graph->ranks[b]) {
+      graph->ranks[a]++;
+    }
+  }
+}
+
+static int
+tracking_add_edge(struct minimalist_graph *graph, uint32_t a, uint32_t b) {
+  if (graph->directed) {
+    return list_add(graph, &graph->predecessors[b], a);
+  }
+  unite(graph, a, b);
+  return 1;
+}
+
+/* Returns 1 if an order was found, 0 if the graph is cyclic, -1 on failure */
+static int
+rebuild_order(struct minimalist_graph *graph) {
+  uint32_t *in_degrees =
+      malloc(sizeof(uint32_t) * ((size_t)graph->num_vertices + 1));
+  uint32_t head = 0, tail = 0, v = 0;
+  const uint32_t *neighbors = NULL;
+
+  if (in_degrees == NULL) {
+    return -1;
+  }
+  /* Kahn's algorithm, using the stack as a queue */
+  for (v = 0; v < graph->num_vertices; v++) {
+    in_degrees[v] = graph->predecessors[v].num_neighbors;
+    if (in_degrees[v] == 0) {
+      graph->stack[tail++] = v;
     }
-    minimalist_set_free(visited);
   }
-  return 0;
+  while (head < tail) {
+    v = graph->stack[head];
+    graph->order[v] = head++;
+    neighbors = list_neighbors(&graph->lists[v]);
+    for (uint32_t i = 0; i < graph->lists[v].num_neighbors; i++) {
+      if (--in_degrees[neighbors[i]] == 0) {
+        graph->stack[tail++] = neighbors[i];
+      }
+    }
+  }
+  free(in_degrees);
+  graph->order_valid = head == graph->num_vertices;
+  return graph->order_valid;
+}
+
+static int
+tracking_start(struct minimalist_graph *graph) {
+  const uint32_t *neighbors = NULL;
+
+  if (!tracking_reserve(graph, graph->capacity)) {
+    tracking_free(graph);
+    return 0;
+  }
+  for (uint32_t v = 0; v < graph->num_vertices; v++) {
+    tracking_add_vertex(graph, v);
+  }
+  graph->tracking = 1;
+  for (uint32_t v = 0; v < graph->num_vertices; v++) {
+    neighbors = list_neighbors(&graph->lists[v]);
+    for (uint32_t i = 0; i < graph->lists[v].num_neighbors; i++) {
+      if (!graph->directed) {
+        unite(graph, v, neighbors[i]);
+      } else if (!list_add(graph, &graph->predecessors[neighbors[i]], v)) {
+        tracking_free(graph);
+        return 0;
+      }
+    }
+  }
+  if (graph->directed && rebuild_order(graph) < 0) {
+    tracking_free(graph);
+    return 0;
+  }
+  return 1;
+}
+
+static int
+compare_affected(const void *a, const void *b) {
+  const uint64_t *u64_a = a, *u64_b = b;
+  return (*u64_a > *u64_b) - (*u64_a < *u64_b);
+}
+
+/* Marks start and searches from it, recording the vertices in affected */
+static uint32_t
+search(struct minimalist_graph *graph,
+       uint32_t start,
+       int forward,
+       uint32_t bound,
+       uint32_t target,
+       uint64_t *affected,
+       int *found) {
+  struct adjacency_list *list = NULL;
+  const uint32_t *neighbors = NULL;
+  uint32_t top = 0, count = 0, v = 0, w = 0;
+
+  graph->marks[start] = 1;
+  graph->stack[top++] = start;
+  while (top > 0) {
+    v = graph->stack[--top];
+    affected[count++] = (uint64_t)graph->order[v] << 32 | v;
+    list = forward ? &graph->lists[v] : &graph->predecessors[v];
+    neighbors = list_neighbors(list);
+    for (uint32_t i = 0; i < list->num_neighbors; i++) {
+      w = neighbors[i];
+      if (w == target) {
+        *found = 1;
+      } else if (!graph->marks[w] &&
+                 (forward ? graph->order[w] < bound
+                          : graph->order[w] > bound)) {
+        graph->marks[w] = 1;
+        graph->stack[top++] = w;
+      }
+    }
+    if (*found) {
+      /* Also unmark what was still waiting on the stack */
+      while (top > 0) {
+        graph->marks[graph->stack[--top]] = 0;
+      }
+    }
+  }
+  return count;
+}
+
+/*
+ * Makes room for the edge a -> b in the topological order. Returns 0, leaving
+ * the order unchanged, if b reaches a so the edge would close a cycle.
+ */
+static int
+reorder(struct minimalist_graph *graph, uint32_t a, uint32_t b) {
+  uint32_t lower = graph->order[b], upper = graph->order[a];
+  uint64_t *affected = graph->affected;
+  uint32_t num_forward = 0, num_backward = 0, total = 0;
+  uint32_t i = 0, j = 0, k = 0;
+  int found = 0;
+
+  if (a == b) {
+    return 0;
+  }
+  if (upper < lower) {
+    return 1;
+  }
+  num_forward = search(graph, b, 1, upper, a, affected, &found);
+  if (!found) {
+    num_backward =
+        search(graph, a, 0, lower, b, affected + num_forward, &found);
+  }
+  total = num_forward + num_backward;
+  for (i = 0; i < total; i++) {
+    graph->marks[(uint32_t)affected[i]] = 0;
+  }
+  if (found) {
+    return 0;
+  }
+
+  /*
+   * Hand the orders held by the affected vertices back out, ancestors of a
+   * first, then descendants of b, each keeping their relative order.
+   */
+  qsort(affected, num_forward, sizeof(uint64_t), compare_affected);
+  qsort(affected + num_forward,
+        num_backward,
+        sizeof(uint64_t),
+        compare_affected);
+  for (i = 0, j = num_forward, k = 0; k < total; k++) {
+    if (j == total || (i < num_forward && affected[i] < affected[j])) {
+      graph->stack[k] = (uint32_t)(affected[i++] >> 32);
+    } else {
+      graph->stack[k] = (uint32_t)(affected[j++] >> 32);
+    }
+  }
+  k = 0;
+  for (j = num_forward; j < total; j++) {
+    graph->order[(uint32_t)affected[j]] = graph->stack[k++];
+  }
+  for (i = 0; i < num_forward; i++) {
+    graph->order[(uint32_t)affected[i]] = graph->stack[k++];
+  }
+  return 1;
+}
+
+/* Whether start reaches target, ignoring the topological order */
+static int
+reaches(struct minimalist_graph *graph, uint32_t start, uint32_t target) {
+  uint32_t count = 0;
+  int found = start == target;
+
+  if (!found) {
+    count = search(graph,
+                   start,
+                   1,
+                   MINIMALIST_GRAPH_INVALID,
+                   target,
+                   graph->affected,
+                   &found);
+    for (uint32_t i = 0; i < count; i++) {
+      graph->marks[(uint32_t)graph->affected[i]] = 0;
+    }
+  }
+  return found;
+}
+
+int
+minimalist_graph_try_add_edge_id(struct minimalist_graph *graph,
+                                 uint32_t a,
+                                 uint32_t b) {
+  int result = 0;
+
+  if (a >= graph->num_vertices || b >= graph->num_vertices) {
+    return -1;
+  }
+  if (graph->unique && minimalist_graph_has_edge_id(graph, a, b)) {
+    return 0;
+  }
+  if (!graph->tracking && !tracking_start(graph)) {
+    return -1;
+  }
+  if (!graph->directed) {
+    if (find_root(graph, a) == find_root(graph, b)) {
+      return 0;
+    }
+  } else if (graph->order_valid ||
+             (result = rebuild_order(graph)) > 0) {
+    if (!reorder(graph, a, b)) {
+      return 0;
+    }
+  } else if (result < 0) {
+    return -1;
+  } else if (reaches(graph, b, a)) {
+    /* The graph already has a cycle, so fall back to a full search */
+    return 0;
+  }
+  return link_edge(graph, a, b) ? 1 : -1;
+}
+
+int
+minimalist_graph_try_add_edge(struct minimalist_graph *graph,
+                              void *a,
+                              void *b) {
+  uint32_t id_a = minimalist_graph_add_vertex(graph, a);
+  uint32_t id_b = minimalist_graph_add_vertex(graph, b);
+  return minimalist_graph_try_add_edge_id(graph, id_a, id_b);
 }
@@ -0,0 +1,63 @@
+#ifndef __MINIMALIST_GRAPH_INTERNAL_H__
+#define __MINIMALIST_GRAPH_INTERNAL_H__
+/*
+ * The graph layout, shared by the files that build and read graphs.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Neighbors stored in the list itself before spilling to the heap */
+#define INLINE_NEIGHBORS 4
+
+/*
+ * Lists with more than INLINE_NEIGHBORS neighbors point either to their own
+ * allocation or, in a loaded graph, into the edges array shared by all lists.
+ * Large enough allocations of their own also hold an index of the neighbors,
+ * kept by graph.c.
+ */
+struct adjacency_list {
+  uint32_t num_neighbors;
+  uint32_t capacity;
+  union {
+    uint32_t inline_neighbors[INLINE_NEIGHBORS];
+    uint32_t *neighbors;
+  };
+};
+
+/* Hash map compare callback for vertex pointers, 0 when they're equal */
+static inline int
+address_equal(const void *a, const void *b) {
+  return a != b;
+}
+
+/*
+ * Vertex pointers map to ID + 1 in the hash map, since a NULL value would
+ * remove the entry. The hash map has a fixed number of buckets, so it is
+ * rebuilt with twice as many whenever the vertices outgrow it.
+ */
+struct minimalist_graph {
+  int directed;
+  struct minimalist_hash_map *ids;
+  size_t num_buckets;
+  uint32_t num_vertices;
+  uint32_t capacity;
+  void **vertices;
+  struct adjacency_list *lists;
+  uint32_t *edges;
+  size_t num_edges;
+  /* Whether edges already in the graph are skipped when added again */
+  int unique;
+  /* Online cycle detection, set up by the first try_add_edge */
+  int tracking;
+  int order_valid;
+  uint32_t *parents;
+  unsigned char *ranks;
+  uint32_t *order;
+  struct adjacency_list *predecessors;
+  unsigned char *marks;
+  uint32_t *stack;
+  uint64_t *affected;
+};
+
+#endif /* __MINIMALIST_GRAPH_INTERNAL_H__ */
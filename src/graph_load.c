@@ -0,0 +1,463 @@
+#include "minimalist/graph.h"
+
+#include "graph_internal.h"
+#include "minimalist/hash.h"
+#include "minimalist/hash_map.h"
+#include "thread_pool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Fewest bytes of the file worth handing to a thread */
+#define MIN_CHUNK_BYTES (1 << 20)
+
+/* Edges a text chunk makes room for at first */
+#define INITIAL_PAIRS 1024
+
+/*
+ * Loading runs in four passes, each split into one share per chunk and run
+ * on a thread pool:
+ *   1. parse each thread's chunk of the file into (a, b) pairs;
+ *   2. count the neighbors of every vertex;
+ *   3. once the counts are turned into offsets, fill every vertex's
+ *      neighbors into one shared edges array;
+ *   4. sort each vertex's neighbors, so the result doesn't depend on the
+ *      threads, and point its adjacency list at them.
+ * The counts and offsets live in cursors, which end up holding the end of
+ * each vertex's neighbors.
+ */
+struct load_chunk {
+  const char *begin;
+  const char *end;
+  uint32_t *pairs;
+  int owns_pairs;
+  size_t num_pairs;
+  size_t capacity;
+  uint64_t max_id;
+  int error;
+};
+
+struct load_state {
+  enum minimalist_graph_format format;
+  struct minimalist_graph *graph;
+  struct minimalist_thread_pool *pool;
+  unsigned int num_threads;
+  struct load_chunk *chunks;
+  atomic_size_t *cursors;
+  /* The pass being run */
+  void (*pass)(struct load_state *state, unsigned int thread);
+};
+
+/* Returns 0, or an errno value if the pair can't be added */
+static int
+push_pair(struct load_chunk *chunk, uint64_t a, uint64_t b) {
+  size_t capacity = chunk->capacity ? chunk->capacity * 2 : INITIAL_PAIRS;
+  uint32_t *pairs = NULL;
+
+  if (a >= MINIMALIST_GRAPH_INVALID || b >= MINIMALIST_GRAPH_INVALID) {
+    return EINVAL;
+  }
+  if (chunk->num_pairs == chunk->capacity) {
+    pairs = realloc(chunk->pairs, sizeof(uint32_t) * 2 * capacity);
+    if (pairs == NULL) {
+      return ENOMEM;
+    }
+    chunk->pairs = pairs;
+    chunk->capacity = capacity;
+  }
+  chunk->pairs[chunk->num_pairs * 2] = (uint32_t)a;
+  chunk->pairs[chunk->num_pairs * 2 + 1] = (uint32_t)b;
+  chunk->num_pairs++;
+  if (a > chunk->max_id) {
+    chunk->max_id = a;
+  }
+  if (b > chunk->max_id) {
+    chunk->max_id = b;
+  }
+  return 0;
+}
+
+/* Parses an ID at *p, saturating at MINIMALIST_GRAPH_INVALID */
+static int
+parse_id(const char **p, const char *end, uint64_t *id) {
+  const char *c = *p;
+
+  if (c == end || *c < '0' || *c > '9') {
+    return 0;
+  }
+  *id = 0;
+  while (c < end && *c >= '0' && *c <= '9') {
+    *id = *id * 10 + (uint64_t)(*c++ - '0');
+    if (*id > MINIMALIST_GRAPH_INVALID) {
+      *id = MINIMALIST_GRAPH_INVALID;
+    }
+  }
+  *p = c;
+  return 1;
+}
+
+/*
+ * Lines hold two IDs and anything after them, or a # or % comment. Returns
+ * 0, or an errno value if the chunk isn't a valid edge list.
+ */
+static int
+parse_text(struct load_chunk *chunk) {
+  const char *p = chunk->begin, *end = chunk->end;
+  uint64_t a = 0, b = 0;
+  int error = 0;
+
+  chunk->owns_pairs = 1;
+  while (p < end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+      p++;
+    }
+    if (p == end) {
+      break;
+    }
+    if (*p != '#' && *p != '%') {
+      if (!parse_id(&p, end, &a)) {
+        return EINVAL;
+      }
+      while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+      }
+      if (!parse_id(&p, end, &b)) {
+        return EINVAL;
+      }
+      if ((error = push_pair(chunk, a, b)) != 0) {
+        return error;
+      }
+    }
+    while (p < end && *p != '\n') {
+      p++;
+    }
+  }
+  return 0;
+}
+
+static int
+parse_binary(struct load_chunk *chunk, enum minimalist_graph_format format) {
+  size_t n = (size_t)(chunk->end - chunk->begin);
+  uint64_t pair[2];
+  int error = 0;
+
+  if (format == MINIMALIST_GRAPH_U32) {
+    // The mapping is page aligned, so the pairs can be used in place
+    chunk->pairs = (uint32_t *)chunk->begin;
+    chunk->num_pairs = n / (2 * sizeof(uint32_t));
+    for (size_t i = 0; i < chunk->num_pairs * 2; i++) {
+      if (chunk->pairs[i] == MINIMALIST_GRAPH_INVALID) {
+        return EINVAL;
+      }
+      if (chunk->pairs[i] > chunk->max_id) {
+        chunk->max_id = chunk->pairs[i];
+      }
+    }
+    return 0;
+  }
+  chunk->owns_pairs = 1;
+  for (size_t i = 0; i < n; i += sizeof(pair)) {
+    memcpy(pair, chunk->begin + i, sizeof(pair));
+    if ((error = push_pair(chunk, pair[0], pair[1])) != 0) {
+      return error;
+    }
+  }
+  return 0;
+}
+
+static void
+load_parse(struct load_state *state, unsigned int thread) {
+  struct load_chunk *chunk = &state->chunks[thread];
+
+  if (state->format == MINIMALIST_GRAPH_TEXT) {
+    chunk->error = parse_text(chunk);
+  } else {
+    chunk->error = parse_binary(chunk, state->format);
+  }
+}
+
+static void
+load_count(struct load_state *state, unsigned int thread) {
+  const struct load_chunk *chunk = &state->chunks[thread];
+  const uint32_t *pairs = chunk->pairs;
+
+  for (size_t i = 0; i < chunk->num_pairs; i++) {
+    atomic_fetch_add_explicit(
+        &state->cursors[pairs[i * 2]], 1, memory_order_relaxed);
+    if (!state->graph->directed) {
+      atomic_fetch_add_explicit(
+          &state->cursors[pairs[i * 2 + 1]], 1, memory_order_relaxed);
+    }
+  }
+}
+
+static void
+load_fill(struct load_state *state, unsigned int thread) {
+  const struct load_chunk *chunk = &state->chunks[thread];
+  const uint32_t *pairs = chunk->pairs;
+  uint32_t *edges = state->graph->edges;
+  uint32_t a = 0, b = 0;
+
+  for (size_t i = 0; i < chunk->num_pairs; i++) {
+    a = pairs[i * 2];
+    b = pairs[i * 2 + 1];
+    edges[atomic_fetch_add_explicit(
+        &state->cursors[a], 1, memory_order_relaxed)] = b;
+    if (!state->graph->directed) {
+      edges[atomic_fetch_add_explicit(
+          &state->cursors[b], 1, memory_order_relaxed)] = a;
+    }
+  }
+}
+
+static int
+compare_ids(const void *a, const void *b) {
+  const uint32_t *id_a = a, *id_b = b;
+  return (*id_a > *id_b) - (*id_a < *id_b);
+}
+
+static void
+load_finish(struct load_state *state, unsigned int thread) {
+  struct minimalist_graph *graph = state->graph;
+  uint32_t first = (uint32_t)((uint64_t)graph->num_vertices * thread /
+                              state->num_threads);
+  uint32_t last = (uint32_t)((uint64_t)graph->num_vertices * (thread + 1) /
+                             state->num_threads);
+  struct adjacency_list *list = NULL;
+  size_t start = 0, end = 0;
+
+  for (uint32_t v = first; v < last; v++) {
+    start = v ? atomic_load_explicit(&state->cursors[v - 1],
+                                     memory_order_relaxed)
+              : 0;
+    end = atomic_load_explicit(&state->cursors[v], memory_order_relaxed);
+    qsort(graph->edges + start, end - start, sizeof(uint32_t), compare_ids);
+    list = &graph->lists[v];
+    list->num_neighbors = (uint32_t)(end - start);
+    if (list->num_neighbors <= INLINE_NEIGHBORS) {
+      list->capacity = INLINE_NEIGHBORS;
+      memcpy(list->inline_neighbors,
+             graph->edges + start,
+             sizeof(uint32_t) * list->num_neighbors);
+    } else {
+      list->capacity = list->num_neighbors;
+      list->neighbors = graph->edges + start;
+    }
+    graph->vertices[v] = (void *)((uintptr_t)v + 1);
+  }
+}
+
+static void
+load_run(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct load_state *state = context;
+  for (size_t t = begin; t < end; t++) {
+    state->pass(state, (unsigned int)t);
+  }
+}
+
+/* Runs pass once for each thread's share, on the pool */
+static void
+load_pass(struct load_state *state,
+          void (*pass)(struct load_state *state, unsigned int thread)) {
+  state->pass = pass;
+  minimalist_thread_pool_for(
+      state->pool, state->num_threads, 1, load_run, state);
+}
+
+/* Splits the file so that every chunk starts a line or a pair */
+static void
+split(struct load_state *state, const char *data, size_t size) {
+  size_t pair_size = state->format == MINIMALIST_GRAPH_U64
+                         ? 2 * sizeof(uint64_t)
+                         : 2 * sizeof(uint32_t);
+  size_t boundary = 0, previous = 0;
+
+  for (unsigned int t = 1; t <= state->num_threads; t++) {
+    boundary = (size_t)((uint64_t)size * t / state->num_threads);
+    if (t == state->num_threads) {
+      boundary = size;
+    } else if (state->format == MINIMALIST_GRAPH_TEXT) {
+      while (boundary < size && boundary > 0 && data[boundary - 1] != '\n') {
+        boundary++;
+      }
+    } else {
+      boundary -= boundary % pair_size;
+    }
+    if (boundary < previous) {
+      boundary = previous;
+    }
+    state->chunks[t - 1].begin = data + previous;
+    state->chunks[t - 1].end = data + boundary;
+    previous = boundary;
+  }
+}
+
+/* Sizes the graph for the parsed IDs and builds the vertex IDs */
+static int
+load_vertices(struct load_state *state) {
+  struct minimalist_graph *graph = state->graph;
+  uint64_t num_vertices = 0;
+
+  for (unsigned int t = 0; t < state->num_threads; t++) {
+    if (state->chunks[t].num_pairs > 0 &&
+        state->chunks[t].max_id + 1 > num_vertices) {
+      num_vertices = state->chunks[t].max_id + 1;
+    }
+  }
+  if (num_vertices == 0) {
+    return 1;
+  }
+  graph->vertices = malloc(sizeof(void *) * num_vertices);
+  graph->lists = malloc(sizeof(struct adjacency_list) * num_vertices);
+  state->cursors = calloc(num_vertices, sizeof(atomic_size_t));
+  if (graph->vertices == NULL || graph->lists == NULL ||
+      state->cursors == NULL) {
+    return 0;
+  }
+  graph->num_vertices = (uint32_t)num_vertices;
+  graph->capacity = (uint32_t)num_vertices;
+  return 1;
+}
+
+static int
+load_edges(struct load_state *state) {
+  struct minimalist_graph *graph = state->graph;
+  struct minimalist_hash_map *ids = NULL;
+  size_t total = 0, count = 0;
+
+  load_pass(state, load_count);
+  for (uint32_t v = 0; v < graph->num_vertices; v++) {
+    count = atomic_load_explicit(&state->cursors[v], memory_order_relaxed);
+    atomic_store_explicit(&state->cursors[v], total, memory_order_relaxed);
+    total += count;
+  }
+  graph->edges = malloc(sizeof(uint32_t) * (total + 1));
+  if (graph->edges == NULL) {
+    return 0;
+  }
+  graph->num_edges = total;
+  load_pass(state, load_fill);
+  load_pass(state, load_finish);
+
+  /* The vertex pointers double as their ID + 1 */
+  ids = minimalist_hash_map_build_parallel(
+      graph->num_vertices,
+      minimalist_hash_pointer,
+      address_equal,
+      (const void *const *)graph->vertices,
+      graph->vertices,
+      graph->num_vertices,
+      state->num_threads);
+  if (ids == NULL) {
+    return 0;
+  }
+  minimalist_hash_map_free(graph->ids);
+  graph->ids = ids;
+  graph->num_buckets = graph->num_vertices;
+  return 1;
+}
+
+struct minimalist_graph *
+minimalist_graph_load(const char *path,
+                      enum minimalist_graph_format format,
+                      int directed,
+                      unsigned int threads) {
+  struct minimalist_graph *graph = NULL;
+  struct load_state state = {0};
+  struct stat st;
+  void *base = MAP_FAILED;
+  size_t pair_size = 0;
+  int fd = -1, loaded = 0;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    goto out;
+  }
+  pair_size = format == MINIMALIST_GRAPH_U64 ? 2 * sizeof(uint64_t)
+                                             : 2 * sizeof(uint32_t);
+  if (format != MINIMALIST_GRAPH_TEXT && st.st_size % pair_size != 0) {
+    errno = EINVAL;
+    goto out;
+  }
+  if (st.st_size > 0) {
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+      goto out;
+    }
+  }
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (unsigned int)online : 1;
+  }
+#endif
+  if (threads == 0) {
+    threads = 1;
+  }
+  if ((uint64_t)threads * MIN_CHUNK_BYTES > (uint64_t)st.st_size) {
+    threads = st.st_size > MIN_CHUNK_BYTES
+                  ? (unsigned int)(st.st_size / MIN_CHUNK_BYTES)
+                  : 1;
+  }
+
+  graph = minimalist_graph_new(directed);
+  state.chunks = calloc(threads, sizeof(struct load_chunk));
+  state.pool = minimalist_thread_pool_new(threads);
+  if (graph == NULL || state.chunks == NULL || state.pool == NULL) {
+    goto out;
+  }
+  state.format = format;
+  state.graph = graph;
+  state.num_threads = threads;
+  if (base != MAP_FAILED) {
+    split(&state, base, st.st_size);
+  }
+
+  load_pass(&state, load_parse);
+  for (unsigned int t = 0; t < threads; t++) {
+    if (state.chunks[t].error != 0) {
+      errno = state.chunks[t].error;
+      goto out;
+    }
+  }
+  if (!load_vertices(&state)) {
+    goto out;
+  }
+  if (graph->num_vertices > 0 &&
+      !load_edges(&state)) {
+    goto out;
+  }
+  loaded = 1;
+
+out:
+  if (state.chunks != NULL) {
+    for (unsigned int t = 0; t < threads; t++) {
+      if (state.chunks[t].owns_pairs) {
+        free(state.chunks[t].pairs);
+      }
+    }
+  }
+  if (!loaded && graph != NULL) {
+    /* No list owns its neighbors yet, and some may not be set up */
+    graph->num_vertices = 0;
+    minimalist_graph_free(graph);
+    graph = NULL;
+  }
+  free(state.chunks);
+  free(state.cursors);
+  minimalist_thread_pool_free(state.pool);
+  if (base != MAP_FAILED) {
+    munmap(base, st.st_size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  return graph;
+}
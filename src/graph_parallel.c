@@ -0,0 +1,527 @@
+#include "minimalist/graph.h"
+
+#include "graph_internal.h"
+#include "thread_pool.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Vertices per loop piece, and bitmap words per bottom-up piece */
+#define VERTEX_GRAIN 1024
+#define WORD_GRAIN 16
+
+/*
+ * Direction-optimizing BFS, after Beamer et al.: switch to bottom-up once
+ * the frontier's edges exceed 1/ALPHA of the unexplored edges, and back to
+ * top-down once the frontier holds under 1/BETA of the vertices.
+ */
+#define ALPHA 14
+#define BETA 24
+
+struct frontier_buffer {
+  uint32_t *ids;
+  size_t count;
+  size_t capacity;
+  uint64_t edges;
+  int failed;
+};
+
+/*
+ * The frontier is a list of IDs. Bottom-up steps also get it as a bitmap,
+ * and scan the in-neighbors of unvisited vertices, which for directed graphs
+ * come from a transposed copy of the adjacency built on first use.
+ */
+struct bfs_state {
+  struct minimalist_graph *graph;
+  uint32_t num_vertices;
+  struct minimalist_thread_pool *pool;
+  _Atomic uint64_t *visited;
+  _Atomic uint64_t *frontier_bits;
+  uint32_t *frontier;
+  size_t frontier_size;
+  struct frontier_buffer *buffers;
+  uint32_t *distances;
+  uint32_t level;
+  size_t *in_starts;
+  uint32_t *in_edges;
+  atomic_size_t *in_cursors;
+};
+
+static size_t
+num_words(uint32_t num_vertices) {
+  return ((size_t)num_vertices + 63) / 64;
+}
+
+/* Marks v visited, returning whether this call did */
+static int
+visit(_Atomic uint64_t *visited, uint32_t v) {
+  uint64_t bit = (uint64_t)1 << (v % 64);
+  if (atomic_load_explicit(&visited[v / 64], memory_order_relaxed) & bit) {
+    return 0;
+  }
+  return !(atomic_fetch_or_explicit(
+               &visited[v / 64], bit, memory_order_relaxed) &
+           bit);
+}
+
+static void
+buffer_add(struct frontier_buffer *buffer, uint32_t v, uint32_t degree) {
+  uint32_t *ids = NULL;
+  if (buffer->count == buffer->capacity) {
+    ids = realloc(buffer->ids,
+                  sizeof(uint32_t) *
+                      (buffer->capacity ? buffer->capacity * 2 : 256));
+    if (ids == NULL) {
+      buffer->failed = 1;
+      return;
+    }
+    buffer->ids = ids;
+    buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+  }
+  buffer->ids[buffer->count++] = v;
+  buffer->edges += degree;
+}
+
+static void
+found(struct bfs_state *state, unsigned int worker, uint32_t v) {
+  const uint32_t *neighbors = NULL;
+  uint32_t degree =
+      minimalist_graph_get_neighbor_ids(state->graph, v, &neighbors);
+  if (state->distances) {
+    state->distances[v] = state->level + 1;
+  }
+  buffer_add(&state->buffers[worker], v, degree);
+}
+
+static void
+top_down(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct bfs_state *state = context;
+  const uint32_t *neighbors = NULL;
+  uint32_t count = 0;
+
+  for (size_t i = begin; i < end; i++) {
+    count = minimalist_graph_get_neighbor_ids(
+        state->graph, state->frontier[i], &neighbors);
+    for (uint32_t j = 0; j < count; j++) {
+      if (visit(state->visited, neighbors[j])) {
+        found(state, worker, neighbors[j]);
+      }
+    }
+  }
+}
+
+/* Each piece owns whole words of visited, so it writes each word once */
+static void
+bottom_up(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct bfs_state *state = context;
+  const uint32_t *neighbors = NULL;
+  uint32_t count = 0, v = 0, u = 0;
+  uint64_t visited = 0;
+
+  for (size_t word = begin; word < end; word++) {
+    visited = atomic_load_explicit(&state->visited[word],
+                                   memory_order_relaxed);
+    for (unsigned int bit = 0; bit < 64 && visited != UINT64_MAX; bit++) {
+      v = (uint32_t)(word * 64 + bit);
+      if (v >= state->num_vertices) {
+        break;
+      }
+      if (visited & ((uint64_t)1 << bit)) {
+        continue;
+      }
+      if (state->in_starts) {
+        neighbors = state->in_edges + state->in_starts[v];
+        count = (uint32_t)(state->in_starts[v + 1] - state->in_starts[v]);
+      } else {
+        count = minimalist_graph_get_neighbor_ids(state->graph, v, &neighbors);
+      }
+      for (uint32_t j = 0; j < count; j++) {
+        u = neighbors[j];
+        if (atomic_load_explicit(&state->frontier_bits[u / 64],
+                                 memory_order_relaxed) &
+            ((uint64_t)1 << (u % 64))) {
+          visited |= (uint64_t)1 << bit;
+          found(state, worker, v);
+          break;
+        }
+      }
+    }
+    atomic_store_explicit(&state->visited[word], visited,
+                          memory_order_relaxed);
+  }
+}
+
+static void
+clear_bits(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct bfs_state *state = context;
+  (void)worker;
+  for (size_t word = begin; word < end; word++) {
+    atomic_store_explicit(&state->frontier_bits[word], 0, memory_order_relaxed);
+  }
+}
+
+/* Pieces of the frontier share bitmap words, so bits are set atomically */
+static void
+set_bits(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct bfs_state *state = context;
+  uint32_t v = 0;
+  (void)worker;
+  for (size_t i = begin; i < end; i++) {
+    v = state->frontier[i];
+    atomic_fetch_or_explicit(&state->frontier_bits[v / 64],
+                             (uint64_t)1 << (v % 64),
+                             memory_order_relaxed);
+  }
+}
+
+static void
+count_in_edges(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct bfs_state *state = context;
+  const uint32_t *neighbors = NULL;
+  uint32_t count = 0;
+  (void)worker;
+  for (size_t v = begin; v < end; v++) {
+    count = minimalist_graph_get_neighbor_ids(
+        state->graph, (uint32_t)v, &neighbors);
+    for (uint32_t j = 0; j < count; j++) {
+      atomic_fetch_add_explicit(
+          &state->in_cursors[neighbors[j]], 1, memory_order_relaxed);
+    }
+  }
+}
+
+static void
+fill_in_edges(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct bfs_state *state = context;
+  const uint32_t *neighbors = NULL;
+  uint32_t count = 0;
+  (void)worker;
+  for (size_t v = begin; v < end; v++) {
+    count = minimalist_graph_get_neighbor_ids(
+        state->graph, (uint32_t)v, &neighbors);
+    for (uint32_t j = 0; j < count; j++) {
+      state->in_edges[atomic_fetch_add_explicit(
+          &state->in_cursors[neighbors[j]], 1, memory_order_relaxed)] =
+          (uint32_t)v;
+    }
+  }
+}
+
+static int
+transpose(struct bfs_state *state) {
+  uint32_t n = state->num_vertices;
+  size_t total = 0, count = 0;
+
+  state->in_starts = malloc(sizeof(size_t) * ((size_t)n + 1));
+  state->in_cursors = calloc(n, sizeof(atomic_size_t));
+  if (state->in_starts == NULL || state->in_cursors == NULL) {
+    return 0;
+  }
+  minimalist_thread_pool_for(
+      state->pool, n, VERTEX_GRAIN, count_in_edges, state);
+  for (uint32_t v = 0; v < n; v++) {
+    count = atomic_load_explicit(&state->in_cursors[v], memory_order_relaxed);
+    state->in_starts[v] = total;
+    atomic_store_explicit(&state->in_cursors[v], total, memory_order_relaxed);
+    total += count;
+  }
+  state->in_starts[n] = total;
+  state->in_edges = malloc(sizeof(uint32_t) * (total + 1));
+  if (state->in_edges == NULL) {
+    return 0;
+  }
+  minimalist_thread_pool_for(
+      state->pool, n, VERTEX_GRAIN, fill_in_edges, state);
+  return 1;
+}
+
+/* Gathers the vertices found by the workers into the next frontier */
+static int
+next_frontier(struct bfs_state *state, uint64_t *edges) {
+  unsigned int workers = minimalist_thread_pool_size(state->pool);
+  size_t size = 0;
+
+  *edges = 0;
+  for (unsigned int w = 0; w < workers; w++) {
+    if (state->buffers[w].failed) {
+      return 0;
+    }
+    if (state->buffers[w].count > 0) {
+      memcpy(state->frontier + size,
+             state->buffers[w].ids,
+             sizeof(uint32_t) * state->buffers[w].count);
+      size += state->buffers[w].count;
+    }
+    *edges += state->buffers[w].edges;
+    state->buffers[w].count = 0;
+    state->buffers[w].edges = 0;
+  }
+  state->frontier_size = size;
+  return 1;
+}
+
+/*
+ * Runs a BFS from sources until no new vertex is found. Returns the number
+ * of vertices visited, or MINIMALIST_GRAPH_INVALID on allocation failure.
+ */
+static uint32_t
+bfs(struct bfs_state *state, const uint32_t *sources, size_t num_sources) {
+  uint32_t n = state->num_vertices;
+  size_t words = num_words(n), reached = 0;
+  uint64_t frontier_edges = 0, unexplored_edges = 0;
+  const uint32_t *neighbors = NULL;
+  int bottom = 0;
+
+  for (uint32_t v = 0; v < n; v++) {
+    unexplored_edges +=
+        minimalist_graph_get_neighbor_ids(state->graph, v, &neighbors);
+  }
+  state->frontier_size = 0;
+  for (size_t i = 0; i < num_sources; i++) {
+    if (sources[i] < n && visit(state->visited, sources[i])) {
+      state->frontier[state->frontier_size++] = sources[i];
+      frontier_edges += minimalist_graph_get_neighbor_ids(
+          state->graph, sources[i], &neighbors);
+      if (state->distances) {
+        state->distances[sources[i]] = 0;
+      }
+    }
+  }
+
+  while (state->frontier_size > 0) {
+    reached += state->frontier_size;
+    unexplored_edges -= frontier_edges;
+    if (!bottom && frontier_edges > unexplored_edges / ALPHA) {
+      if (state->graph->directed && state->in_starts == NULL &&
+          !transpose(state)) {
+        return MINIMALIST_GRAPH_INVALID;
+      }
+      bottom = 1;
+    } else if (bottom && state->frontier_size < n / BETA) {
+      bottom = 0;
+    }
+    if (bottom) {
+      minimalist_thread_pool_for(
+          state->pool, words, WORD_GRAIN * 64, clear_bits, state);
+      minimalist_thread_pool_for(state->pool,
+                                 state->frontier_size,
+                                 VERTEX_GRAIN,
+                                 set_bits,
+                                 state);
+      minimalist_thread_pool_for(
+          state->pool, words, WORD_GRAIN, bottom_up, state);
+    } else {
+      minimalist_thread_pool_for(state->pool,
+                                 state->frontier_size,
+                                 VERTEX_GRAIN / 16,
+                                 top_down,
+                                 state);
+    }
+    if (!next_frontier(state, &frontier_edges)) {
+      return MINIMALIST_GRAPH_INVALID;
+    }
+    state->level++;
+  }
+  return (uint32_t)reached;
+}
+
+static uint32_t
+run_bfs(struct minimalist_graph *graph,
+        const uint32_t *sources,
+        size_t num_sources,
+        uint32_t *distances,
+        unsigned char *reached,
+        unsigned int threads) {
+  struct bfs_state state = {0};
+  uint32_t n = graph->num_vertices, count = MINIMALIST_GRAPH_INVALID;
+  unsigned int workers = 0;
+  uint64_t word = 0;
+
+  state.graph = graph;
+  state.num_vertices = n;
+  state.distances = distances;
+  state.pool = minimalist_thread_pool_new(threads);
+  if (state.pool == NULL) {
+    return MINIMALIST_GRAPH_INVALID;
+  }
+  workers = minimalist_thread_pool_size(state.pool);
+  state.visited = calloc(num_words(n) + 1, sizeof(uint64_t));
+  state.frontier_bits = calloc(num_words(n) + 1, sizeof(uint64_t));
+  state.frontier = malloc(sizeof(uint32_t) * ((size_t)n + 1));
+  state.buffers = calloc(workers, sizeof(struct frontier_buffer));
+  if (state.visited == NULL || state.frontier_bits == NULL ||
+      state.frontier == NULL || state.buffers == NULL) {
+    goto out;
+  }
+  if (distances) {
+    for (uint32_t v = 0; v < n; v++) {
+      distances[v] = MINIMALIST_GRAPH_INVALID;
+    }
+  }
+  count = bfs(&state, sources, num_sources);
+  if (reached && count != MINIMALIST_GRAPH_INVALID) {
+    for (uint32_t v = 0; v < n; v++) {
+      if (v % 64 == 0) {
+        word = atomic_load(&state.visited[v / 64]);
+      }
+      reached[v] = (word >> (v % 64)) & 1;
+    }
+  }
+
+out:
+  if (state.buffers) {
+    for (unsigned int w = 0; w < workers; w++) {
+      free(state.buffers[w].ids);
+    }
+  }
+  free(state.buffers);
+  free(state.visited);
+  free(state.frontier_bits);
+  free(state.frontier);
+  free(state.in_starts);
+  free(state.in_cursors);
+  free(state.in_edges);
+  minimalist_thread_pool_free(state.pool);
+  return count;
+}
+
+int
+minimalist_graph_bfs(struct minimalist_graph *graph,
+                     uint32_t source,
+                     uint32_t *distances,
+                     unsigned int threads) {
+  if (source >= graph->num_vertices) {
+    return -1;
+  }
+  return run_bfs(graph, &source, 1, distances, NULL, threads) ==
+                 MINIMALIST_GRAPH_INVALID
+             ? -1
+             : 0;
+}
+
+uint32_t
+minimalist_graph_reachable(struct minimalist_graph *graph,
+                           const uint32_t *sources,
+                           size_t num_sources,
+                           unsigned char *reached,
+                           unsigned int threads) {
+  return run_bfs(graph, sources, num_sources, NULL, reached, threads);
+}
+
+/*
+ * Components are found with a concurrent union-find that always links the
+ * root with the higher ID under the lower one, so every root ends up the
+ * lowest ID of its component whatever the order of the unions.
+ */
+struct components_state {
+  struct minimalist_graph *graph;
+  _Atomic uint32_t *parents;
+  uint32_t *labels;
+};
+
+static uint32_t
+find_root(_Atomic uint32_t *parents, uint32_t v) {
+  uint32_t parent = atomic_load_explicit(&parents[v], memory_order_relaxed);
+  uint32_t grandparent = 0;
+
+  while (parent != v) {
+    /* Path halving, which only ever points v further up */
+    grandparent = atomic_load_explicit(&parents[parent], memory_order_relaxed);
+    atomic_compare_exchange_weak_explicit(&parents[v],
+                                          &parent,
+                                          grandparent,
+                                          memory_order_relaxed,
+                                          memory_order_relaxed);
+    v = grandparent;
+    parent = atomic_load_explicit(&parents[v], memory_order_relaxed);
+  }
+  return v;
+}
+
+static void
+unite(_Atomic uint32_t *parents, uint32_t a, uint32_t b) {
+  uint32_t root = 0;
+
+  for (;;) {
+    a = find_root(parents, a);
+    b = find_root(parents, b);
+    if (a == b) {
+      return;
+    }
+    if (a < b) {
+      root = a;
+      a = b;
+      b = root;
+    }
+    root = a;
+    if (atomic_compare_exchange_strong_explicit(&parents[a],
+                                                &root,
+                                                b,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+static void
+init_components(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct components_state *state = context;
+  (void)worker;
+  for (size_t v = begin; v < end; v++) {
+    atomic_init(&state->parents[v], (uint32_t)v);
+  }
+}
+
+static void
+link_components(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct components_state *state = context;
+  const uint32_t *neighbors = NULL;
+  uint32_t count = 0;
+  (void)worker;
+  for (size_t v = begin; v < end; v++) {
+    count = minimalist_graph_get_neighbor_ids(
+        state->graph, (uint32_t)v, &neighbors);
+    for (uint32_t j = 0; j < count; j++) {
+      unite(state->parents, (uint32_t)v, neighbors[j]);
+    }
+  }
+}
+
+static void
+label_components(void *context, unsigned int worker, size_t begin, size_t end) {
+  struct components_state *state = context;
+  (void)worker;
+  for (size_t v = begin; v < end; v++) {
+    state->labels[v] = find_root(state->parents, (uint32_t)v);
+  }
+}
+
+uint32_t
+minimalist_graph_components(struct minimalist_graph *graph,
+                            uint32_t *labels,
+                            unsigned int threads) {
+  struct components_state state = {graph, NULL, labels};
+  struct minimalist_thread_pool *pool = NULL;
+  uint32_t n = graph->num_vertices, count = 0;
+
+  pool = minimalist_thread_pool_new(threads);
+  state.parents = malloc(sizeof(_Atomic uint32_t) * ((size_t)n + 1));
+  if (pool == NULL || state.parents == NULL) {
+    minimalist_thread_pool_free(pool);
+    free(state.parents);
+    return MINIMALIST_GRAPH_INVALID;
+  }
+  minimalist_thread_pool_for(pool, n, VERTEX_GRAIN, init_components, &state);
+  minimalist_thread_pool_for(
+      pool, n, VERTEX_GRAIN / 16, link_components, &state);
+  minimalist_thread_pool_for(pool, n, VERTEX_GRAIN, label_components, &state);
+  for (uint32_t v = 0; v < n; v++) {
+    count += labels[v] == v;
+  }
+  minimalist_thread_pool_free(pool);
+  free(state.parents);
+  return count;
+}
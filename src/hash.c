@@ -0,0 +1,214 @@
+#include "minimalist/hash.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const uint64_t secret[4] = {0x2d358dccaa6c78a5ull,
+                                   0x8bb84b93962eacc9ull,
+                                   0x4b33a62ed433d4a3ull,
+                                   0x4d5a2da51de1aa47ull};
+
+/* Per-lane key material for the long input path */
+static const uint64_t lane_secret[8] = {0xbe4ba423396cfeb8ull,
+                                        0x1cad21f72c81017cull,
+                                        0xdb979083e96dd4deull,
+                                        0x1f67b3b7a4a44072ull,
+                                        0x78e5c0cc4ee679cbull,
+                                        0x2172ffcc7dd05a82ull,
+                                        0x8e2443f7744608b8ull,
+                                        0x4c263a81e69035e0ull};
+
+#define LONG_INPUT 256
+#define STRIPE 64
+#define STRIPES_PER_BLOCK 16
+
+static uint64_t
+read64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t
+read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t
+read_small(const uint8_t *p, size_t len) {
+  return (((uint64_t)p[0]) << 16) | (((uint64_t)p[len >> 1]) << 8) |
+         p[len - 1];
+}
+
+static void
+mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = *a;
+  r *= *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32;
+  uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static uint64_t
+mix(uint64_t a, uint64_t b) {
+  mum(&a, &b);
+  return a ^ b;
+}
+
+uint32_t
+minimalist_hash_u32(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  x ^= x >> 16;
+  return x;
+}
+
+uint64_t
+minimalist_hash_u64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+/*
+ * Accumulates one 64 byte stripe into eight independent lanes. Each lane
+ * multiplies the low and high halves of the keyed input, which maps directly
+ * onto pmuludq, and also folds the raw input into its neighbour so that no
+ * input bits are lost when a product is zero.
+ */
+static void
+accumulate_stripe(uint64_t *acc, const uint8_t *p) {
+#ifdef __SSE2__
+  for (int i = 0; i < 8; i += 2) {
+    __m128i data = _mm_loadu_si128((const __m128i *)(p + i * 8));
+    __m128i key = _mm_loadu_si128((const __m128i *)(lane_secret + i));
+    __m128i keyed = _mm_xor_si128(data, key);
+    __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+    __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i sum = _mm_add_epi64(product, swapped);
+    __m128i current = _mm_loadu_si128((const __m128i *)(acc + i));
+    _mm_storeu_si128((__m128i *)(acc + i), _mm_add_epi64(current, sum));
+  }
+#else
+  for (int i = 0; i < 8; i++) {
+    uint64_t data = read64(p + i * 8);
+    uint64_t keyed = data ^ lane_secret[i];
+    acc[i ^ 1] += data;
+    acc[i] += (keyed & 0xffffffffu) * (keyed >> 32);
+  }
+#endif
+}
+
+static void
+scramble(uint64_t *acc) {
+  for (int i = 0; i < 8; i++) {
+    acc[i] ^= acc[i] >> 47;
+    acc[i] ^= lane_secret[7 - i];
+    acc[i] *= 0x9e3779b1u;
+  }
+}
+
+static uint64_t
+hash_long(const uint8_t *p, size_t len, uint64_t seed) {
+  uint64_t acc[8];
+  size_t i = len;
+  int stripes = 0;
+
+  for (int j = 0; j < 8; j++) {
+    acc[j] = lane_secret[j] ^ (j & 1 ? seed : ~seed);
+  }
+  while (i >= STRIPE) {
+    accumulate_stripe(acc, p);
+    p += STRIPE;
+    i -= STRIPE;
+    if (++stripes == STRIPES_PER_BLOCK) {
+      scramble(acc);
+      stripes = 0;
+    }
+  }
+  if (i > 0) {
+    /* Re-read the final full stripe so the tail needs no padding */
+    accumulate_stripe(acc, p + i - STRIPE);
+  }
+
+  seed ^= len * secret[0];
+  for (int j = 0; j < 8; j += 2) {
+    seed = mix(acc[j] ^ secret[1], acc[j + 1] ^ seed);
+  }
+  return seed;
+}
+
+uint64_t
+minimalist_hash_bytes(const void *data, size_t len, uint64_t seed) {
+  const uint8_t *p = data;
+  uint64_t a = 0, b = 0;
+
+  if (len > LONG_INPUT) {
+    seed = hash_long(p, len, seed);
+    return mix(seed ^ secret[2], len ^ secret[3]);
+  }
+
+  seed ^= mix(seed ^ secret[0], secret[1]);
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+      b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = read_small(p, len);
+    }
+  } else {
+    size_t i = len;
+    if (i >= 48) {
+      uint64_t seed1 = seed, seed2 = seed;
+      do {
+        seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+        seed1 = mix(read64(p + 16) ^ secret[2], read64(p + 24) ^ seed1);
+        seed2 = mix(read64(p + 32) ^ secret[3], read64(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (i > 16) {
+      seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = read64(p + i - 16);
+    b = read64(p + i - 8);
+  }
+  a ^= secret[1];
+  b ^= seed;
+  mum(&a, &b);
+  return mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+size_t
+minimalist_hash_pointer(const void *ptr) {
+  return (size_t)minimalist_hash_u64((uint64_t)(uintptr_t)ptr);
+}
+
+size_t
+minimalist_hash_string(const void *str) {
+  return (size_t)minimalist_hash_bytes(str, strlen(str), 0);
+}
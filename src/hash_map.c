@@ -1,7 +1,30 @@
 #include "minimalist/hash_map.h"
 
+#include "minimalist/bloom_filter.h"
+
 #include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+/* 2^64 divided by the golden ratio, used for Fibonacci hashing */
+#define FIBONACCI_MULTIPLIER 0x9e3779b97f4a7c15ull
+
+/* Number of keys whose lookups are overlapped by get_many */
+#define GET_MANY_GROUP 64
+
+/* Fewest entries worth handing to a build thread */
+#define MIN_BUILD_ENTRIES 4096
+
+/* Bucket ranges per build thread, to even out uneven ranges */
+#define PARTITIONS_PER_THREAD 4
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void)(address))
+#endif
 
 struct bucket {
   const void *key;
@@ -12,10 +35,25 @@ struct bucket {
 struct minimalist_hash_map {
   minimalist_hash_map_hash_fn hash;
   minimalist_hash_map_compare_fn compare;
-  int num_buckets;
+  size_t num_buckets;
+  unsigned int shift;
   struct bucket **buckets;
+  struct minimalist_bloom_filter *filter;
+  /* Entries allocated at once by build_parallel, freed with the map */
+  struct bucket *slab;
+  size_t slab_size;
 };
 
+/*
+ * The bucket count is always a power of two. Multiplying by the Fibonacci
+ * constant and keeping the high bits replaces the division by num_buckets and
+ * also spreads out weak hashes whose entropy sits in the high bits only.
+ */
+static size_t
+bucket_index(const struct minimalist_hash_map *map, size_t hash) {
+  return (size_t)(((uint64_t)hash * FIBONACCI_MULTIPLIER) >> map->shift);
+}
+
 struct minimalist_hash_map *
 minimalist_hash_map_new(size_t buckets,
                         minimalist_hash_map_hash_fn hash,
@@ -25,16 +63,32 @@ minimalist_hash_map_new(size_t buckets,
     map = malloc(sizeof(struct minimalist_hash_map));
     map->hash = hash;
     map->compare = compare;
-    map->num_buckets = buckets;
-    map->buckets = calloc(buckets, sizeof(struct bucket *));
+    map->num_buckets = 2;
+    map->shift = 63;
+    while (map->num_buckets < buckets) {
+      map->num_buckets <<= 1;
+      map->shift--;
+    }
+    map->buckets = calloc(map->num_buckets, sizeof(struct bucket *));
     assert(map->buckets != NULL);
+    map->filter = NULL;
+    map->slab = NULL;
+    map->slab_size = 0;
   }
   return map;
 }
 
+static void
+bucket_free(struct minimalist_hash_map *map, struct bucket *bucket) {
+  uintptr_t address = (uintptr_t)bucket, slab = (uintptr_t)map->slab;
+  if (address - slab >= map->slab_size * sizeof(struct bucket)) {
+    free(bucket);
+  }
+}
+
 void
 minimalist_hash_map_free(struct minimalist_hash_map *map) {
-  int i = 0;
+  size_t i = 0;
   struct bucket *next = NULL, *tmp = NULL;
 
   if (map != NULL) {
@@ -43,67 +97,413 @@ minimalist_hash_map_free(struct minimalist_hash_map *map) {
         next = map->buckets[i];
         while (next != NULL) {
           tmp = next->next;
-          free(next);
+          bucket_free(map, next);
           next = tmp;
         }
       }
       free(map->buckets);
     }
+    free(map->slab);
+    free(map);
+  }
+}
+
+void **
+minimalist_hash_map_upsert(struct minimalist_hash_map *map,
+                           const void *key,
+                           int *inserted) {
+  size_t hash = map->hash(key);
+  struct bucket **bucket = &map->buckets[bucket_index(map, hash)];
+
+  while (*bucket != NULL) {
+    if (map->compare(key, (*bucket)->key) == 0) {
+      if (inserted) {
+        *inserted = 0;
+      }
+      return &(*bucket)->value;
+    }
+    bucket = &(*bucket)->next;
+  }
+  if (inserted) {
+    *inserted = 0;
+  }
+  *bucket = malloc(sizeof(struct bucket));
+  if (*bucket == NULL) {
+    return NULL;
+  }
+  (*bucket)->key = key;
+  (*bucket)->value = NULL;
+  (*bucket)->next = NULL;
+  if (map->filter) {
+    minimalist_bloom_filter_add_hash(map->filter, hash);
+  }
+  if (inserted) {
+    *inserted = 1;
+  }
+  return &(*bucket)->value;
+}
+
+int
+minimalist_hash_map_remove(struct minimalist_hash_map *map,
+                           const void *key,
+                           const void **old_key,
+                           void **old_value) {
+  struct bucket **bucket = &map->buckets[bucket_index(map, map->hash(key))];
+  struct bucket *tmp = NULL;
+
+  while (*bucket != NULL) {
+    if (map->compare(key, (*bucket)->key) == 0) {
+      tmp = *bucket;
+      if (old_key) {
+        *old_key = tmp->key;
+      }
+      if (old_value) {
+        *old_value = tmp->value;
+      }
+      *bucket = tmp->next;
+      bucket_free(map, tmp);
+      return 1;
+    }
+    bucket = &(*bucket)->next;
   }
+  return 0;
 }
 
 void
 minimalist_hash_map_set(struct minimalist_hash_map *map,
                         const void *key,
                         void *value) {
+  void **slot = NULL;
 
-  size_t hash = 0;
-  struct bucket **bucket = NULL;
-  struct bucket *tmp = NULL;
-  int delete = value == NULL ? 1 : 0;
-  int found = 0;
+  if (value == NULL) {
+    minimalist_hash_map_remove(map, key, NULL, NULL);
+  } else if ((slot = minimalist_hash_map_upsert(map, key, NULL)) != NULL) {
+    *slot = value;
+  }
+}
 
-  hash = map->hash(key) % map->num_buckets;
-  bucket = &map->buckets[hash];
+static struct bucket *
+find(struct minimalist_hash_map *map, const void *key) {
+  size_t hash = map->hash(key);
+  struct bucket *bucket = NULL;
 
-  while ((*bucket) != NULL) {
-    if (map->compare(key, (*bucket)->key) == 0) {
-      if (delete) {
-        tmp = *bucket;
-        *bucket = tmp->next;
-        free(tmp);
-        break;
+  if (map->filter &&
+      !minimalist_bloom_filter_contains_hash(map->filter, hash)) {
+    return NULL;
+  }
+  bucket = map->buckets[bucket_index(map, hash)];
+  while (bucket != NULL && map->compare(key, bucket->key) != 0) {
+    bucket = bucket->next;
+  }
+  return bucket;
+}
+
+void *
+minimalist_hash_map_get(struct minimalist_hash_map *map, const void *key) {
+  struct bucket *bucket = find(map, key);
+  return bucket ? bucket->value : NULL;
+}
+
+int
+minimalist_hash_map_contains(struct minimalist_hash_map *map,
+                             const void *key) {
+  return find(map, key) != NULL;
+}
+
+void
+minimalist_hash_map_get_many(struct minimalist_hash_map *map,
+                             const void *const *keys,
+                             size_t n,
+                             void **values) {
+  size_t hashes[GET_MANY_GROUP];
+  size_t indices[GET_MANY_GROUP];
+  struct bucket *heads[GET_MANY_GROUP];
+  struct bucket *bucket = NULL;
+  size_t group = 0, i = 0;
+
+  for (size_t start = 0; start < n; start += group) {
+    group = n - start < GET_MANY_GROUP ? n - start : GET_MANY_GROUP;
+
+    for (i = 0; i < group; i++) {
+      hashes[i] = map->hash(keys[start + i]);
+      indices[i] = bucket_index(map, hashes[i]);
+      PREFETCH(&map->buckets[indices[i]]);
+      if (map->filter) {
+        minimalist_bloom_filter_prefetch(map->filter, hashes[i]);
+      }
+    }
+    for (i = 0; i < group; i++) {
+      if (map->filter &&
+          !minimalist_bloom_filter_contains_hash(map->filter, hashes[i])) {
+        heads[i] = NULL;
       } else {
-        (*bucket)->value = value;
-        break;
+        heads[i] = map->buckets[indices[i]];
+      }
+      if (heads[i] != NULL) {
+        PREFETCH(heads[i]);
+      }
+    }
+    for (i = 0; i < group; i++) {
+      if (heads[i] != NULL) {
+        PREFETCH(heads[i]->key);
+      }
+    }
+    for (i = 0; i < group; i++) {
+      values[start + i] = NULL;
+      for (bucket = heads[i]; bucket != NULL; bucket = bucket->next) {
+        if (map->compare(keys[start + i], bucket->key) == 0) {
+          values[start + i] = bucket->value;
+          break;
+        }
       }
-      break;
     }
-    bucket = &(*bucket)->next;
   }
-  if (!delete &&(*bucket) == NULL) {
-    *bucket = malloc(sizeof(struct bucket));
-    (*bucket)->key = key;
-    (*bucket)->value = value;
-    (*bucket)->next = NULL;
+}
+
+void
+minimalist_hash_map_run(struct minimalist_hash_map *map,
+                        minimalist_hash_map_run_fn run,
+                        void *context) {
+  size_t i = 0;
+  struct bucket *bucket = NULL;
+
+  if (run) {
+    for (i = 0; i < map->num_buckets; i++) {
+      for (bucket = map->buckets[i]; bucket != NULL; bucket = bucket->next) {
+        run(context, bucket->key, bucket->value);
+      }
+    }
   }
 }
 
-void *
-minimalist_hash_map_get(struct minimalist_hash_map *map, const void *key) {
-  size_t hash = 0;
+void
+minimalist_hash_map_attach_filter(struct minimalist_hash_map *map,
+                                  struct minimalist_bloom_filter *filter) {
+  size_t i = 0;
   struct bucket *bucket = NULL;
-  void *value = NULL;
-
-  hash = map->hash(key) % map->num_buckets;
-  bucket = map->buckets[hash];
-  while (bucket != NULL) {
-    if (map->compare(key, bucket->key) == 0) {
-      value = bucket->value;
-      break;
+
+  map->filter = filter;
+  if (filter) {
+    for (i = 0; i < map->num_buckets; i++) {
+      for (bucket = map->buckets[i]; bucket != NULL; bucket = bucket->next) {
+        minimalist_bloom_filter_add_hash(filter, map->hash(bucket->key));
+      }
     }
-    bucket = bucket->next;
   }
+}
+
+/*
+ * build_parallel runs in three passes, each split over the threads:
+ *   1. hash each thread's slice of the input and count its entries per
+ *      partition, a contiguous range of buckets;
+ *   2. scatter the entry positions into partition order, stably, so equal
+ *      keys keep their input order;
+ *   3. link the entries of each partition into its buckets. Partitions cover
+ *      disjoint buckets, so no locks are needed.
+ */
+struct build_state {
+  struct minimalist_hash_map *map;
+  const void *const *keys;
+  void *const *values;
+  size_t n;
+  unsigned int num_threads;
+  unsigned int partition_shift;
+  size_t num_partitions;
+  size_t *indices;
+  size_t *order;
+  size_t *counts;
+};
+
+struct build_worker {
+  struct build_state *state;
+  unsigned int thread;
+  void (*pass)(struct build_state *state, unsigned int thread);
+};
+
+static void
+slice(const struct build_state *state,
+      unsigned int thread,
+      size_t *start,
+      size_t *end) {
+  *start = state->n / state->num_threads * thread;
+  *end = thread + 1 == state->num_threads
+             ? state->n
+             : state->n / state->num_threads * (thread + 1);
+}
+
+static void
+build_count(struct build_state *state, unsigned int thread) {
+  size_t *counts = &state->counts[thread * state->num_partitions];
+  size_t start = 0, end = 0;
+
+  slice(state, thread, &start, &end);
+  for (size_t i = start; i < end; i++) {
+    state->indices[i] =
+        bucket_index(state->map, state->map->hash(state->keys[i]));
+    counts[state->indices[i] >> state->partition_shift]++;
+  }
+}
+
+static void
+build_scatter(struct build_state *state, unsigned int thread) {
+  size_t *offsets = &state->counts[thread * state->num_partitions];
+  size_t start = 0, end = 0;
+
+  slice(state, thread, &start, &end);
+  for (size_t i = start; i < end; i++) {
+    state->order[offsets[state->indices[i] >> state->partition_shift]++] = i;
+  }
+}
 
-  return value;
+static void
+build_link(struct build_state *state, unsigned int thread) {
+  struct minimalist_hash_map *map = state->map;
+  struct bucket **bucket = NULL;
+  size_t start = 0, end = 0, i = 0;
+
+  for (size_t p = thread; p < state->num_partitions;
+       p += state->num_threads) {
+    /* After scattering, the last thread's offsets are the partition ends */
+    start = p ? state->counts[(state->num_threads - 1) * state->num_partitions +
+                              p - 1]
+              : 0;
+    end = state->counts[(state->num_threads - 1) * state->num_partitions + p];
+    for (size_t position = start; position < end; position++) {
+      i = state->order[position];
+      bucket = &map->buckets[state->indices[i]];
+      while (*bucket != NULL &&
+             map->compare(state->keys[i], (*bucket)->key) != 0) {
+        bucket = &(*bucket)->next;
+      }
+      if (*bucket == NULL) {
+        *bucket = &map->slab[position];
+        (*bucket)->key = state->keys[i];
+        (*bucket)->next = NULL;
+      }
+      (*bucket)->value = state->values[i];
+    }
+  }
+}
+
+static void *
+build_run(void *context) {
+  struct build_worker *worker = context;
+  worker->pass(worker->state, worker->thread);
+  return NULL;
+}
+
+static void
+build_pass(struct build_state *state,
+           struct build_worker *workers,
+           pthread_t *threads,
+           void (*pass)(struct build_state *state, unsigned int thread)) {
+  int *started = calloc(state->num_threads, sizeof(int));
+
+  /* Without room to track the threads, run every share here */
+  if (started == NULL) {
+    for (unsigned int t = 0; t < state->num_threads; t++) {
+      pass(state, t);
+    }
+    return;
+  }
+  for (unsigned int t = 1; t < state->num_threads; t++) {
+    workers[t].state = state;
+    workers[t].thread = t;
+    workers[t].pass = pass;
+    started[t] =
+        pthread_create(&threads[t], NULL, build_run, &workers[t]) == 0;
+  }
+  pass(state, 0);
+  for (unsigned int t = 1; t < state->num_threads; t++) {
+    if (started[t]) {
+      pthread_join(threads[t], NULL);
+    } else {
+      /* Couldn't start a thread, so do its share here */
+      pass(state, t);
+    }
+  }
+  free(started);
+}
+
+struct minimalist_hash_map *
+minimalist_hash_map_build_parallel(size_t buckets,
+                                   minimalist_hash_map_hash_fn hash,
+                                   minimalist_hash_map_compare_fn compare,
+                                   const void *const *keys,
+                                   void *const *values,
+                                   size_t n,
+                                   unsigned int threads) {
+  struct minimalist_hash_map *map = NULL;
+  struct build_state state = {0};
+  struct build_worker *workers = NULL;
+  pthread_t *thread_ids = NULL;
+  size_t total = 0, count = 0;
+  unsigned int bucket_bits = 0;
+
+  map = minimalist_hash_map_new(buckets ? buckets : n, hash, compare);
+  if (map == NULL || n == 0) {
+    return map;
+  }
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (unsigned int)online : 1;
+  }
+#endif
+  if (threads == 0) {
+    threads = 1;
+  }
+  if (threads > n / MIN_BUILD_ENTRIES) {
+    threads = n / MIN_BUILD_ENTRIES ? (unsigned int)(n / MIN_BUILD_ENTRIES)
+                                    : 1;
+  }
+
+  bucket_bits = 64 - map->shift;
+  state.map = map;
+  state.keys = keys;
+  state.values = values;
+  state.n = n;
+  state.num_threads = threads;
+  state.num_partitions = 1;
+  state.partition_shift = bucket_bits;
+  while (state.num_partitions < (size_t)threads * PARTITIONS_PER_THREAD &&
+         state.partition_shift > 0) {
+    state.num_partitions <<= 1;
+    state.partition_shift--;
+  }
+
+  map->slab = malloc(sizeof(struct bucket) * n);
+  state.indices = malloc(sizeof(size_t) * n);
+  state.order = malloc(sizeof(size_t) * n);
+  state.counts = calloc((size_t)threads * state.num_partitions, sizeof(size_t));
+  workers = calloc(threads, sizeof(struct build_worker));
+  thread_ids = calloc(threads, sizeof(pthread_t));
+  if (map->slab == NULL || state.indices == NULL || state.order == NULL ||
+      state.counts == NULL || workers == NULL || thread_ids == NULL) {
+    minimalist_hash_map_free(map);
+    map = NULL;
+    goto out;
+  }
+  map->slab_size = n;
+
+  build_pass(&state, workers, thread_ids, build_count);
+  /* Turn the counts into each thread's first position in every partition */
+  for (size_t p = 0; p < state.num_partitions; p++) {
+    for (unsigned int t = 0; t < threads; t++) {
+      count = state.counts[t * state.num_partitions + p];
+      state.counts[t * state.num_partitions + p] = total;
+      total += count;
+    }
+  }
+  build_pass(&state, workers, thread_ids, build_scatter);
+  build_pass(&state, workers, thread_ids, build_link);
+
+out:
+  free(state.indices);
+  free(state.order);
+  free(state.counts);
+  free(workers);
+  free(thread_ids);
+  return map;
 }
@@ -0,0 +1,236 @@
+#include "minimalist/heap.h"
+
+#include <stdlib.h>
+
+#define DEFAULT_ARITY 4
+
+struct heap_item {
+  const void *value;
+  size_t handle;
+};
+
+/*
+ * items is the d-ary heap itself; the children of position p are at
+ * arity * p + 1 through arity * p + arity. positions maps each handle to its
+ * position in items, or MINIMALIST_HEAP_INVALID once the value is popped.
+ */
+struct minimalist_heap {
+  minimalist_const_compare_fn compare;
+  unsigned int arity;
+  struct heap_item *items;
+  size_t size;
+  size_t capacity;
+  size_t *positions;
+  size_t *free_handles;
+  size_t num_free;
+  size_t num_handles;
+};
+
+static int
+address_compare(const void *a, const void *b) {
+  return (a < b) - (a > b);
+}
+
+/*
+ * Follows the map's convention: compare(a, b) > 0 means a comes before b,
+ * so values pop in the order minimalist_map_run would visit them.
+ */
+static int
+before(struct minimalist_heap *heap, const void *a, const void *b) {
+  return heap->compare(a, b) > 0;
+}
+
+struct minimalist_heap *
+minimalist_heap_new(unsigned int arity, minimalist_const_compare_fn compare) {
+  struct minimalist_heap *heap = calloc(1, sizeof(struct minimalist_heap));
+  if (heap) {
+    heap->arity = arity >= 2 ? arity : DEFAULT_ARITY;
+    heap->compare = compare ? compare : address_compare;
+  }
+  return heap;
+}
+
+void
+minimalist_heap_free(struct minimalist_heap *heap) {
+  if (heap) {
+    free(heap->items);
+    free(heap->positions);
+    free(heap->free_handles);
+    free(heap);
+  }
+}
+
+static int
+reserve(struct minimalist_heap *heap, size_t capacity) {
+  struct heap_item *items = NULL;
+  size_t *positions = NULL, *free_handles = NULL;
+
+  if (capacity <= heap->capacity) {
+    return 0;
+  }
+  items = realloc(heap->items, sizeof(struct heap_item) * capacity);
+  if (items == NULL) {
+    return -1;
+  }
+  heap->items = items;
+  positions = realloc(heap->positions, sizeof(size_t) * capacity);
+  if (positions == NULL) {
+    return -1;
+  }
+  heap->positions = positions;
+  free_handles = realloc(heap->free_handles, sizeof(size_t) * capacity);
+  if (free_handles == NULL) {
+    return -1;
+  }
+  heap->free_handles = free_handles;
+  heap->capacity = capacity;
+  return 0;
+}
+
+static void
+place(struct minimalist_heap *heap, size_t position, struct heap_item item) {
+  heap->items[position] = item;
+  heap->positions[item.handle] = position;
+}
+
+static void
+sift_up(struct minimalist_heap *heap, size_t position) {
+  struct heap_item item = heap->items[position];
+  size_t parent = 0;
+
+  while (position > 0) {
+    parent = (position - 1) / heap->arity;
+    if (!before(heap, item.value, heap->items[parent].value)) {
+      break;
+    }
+    place(heap, position, heap->items[parent]);
+    position = parent;
+  }
+  place(heap, position, item);
+}
+
+static void
+sift_down(struct minimalist_heap *heap, size_t position) {
+  struct heap_item item = heap->items[position];
+  size_t first = 0, last = 0, best = 0;
+
+  for (;;) {
+    first = position * heap->arity + 1;
+    if (first >= heap->size) {
+      break;
+    }
+    last = first + heap->arity < heap->size ? first + heap->arity : heap->size;
+    best = first;
+    for (size_t child = first + 1; child < last; child++) {
+      if (before(heap, heap->items[child].value, heap->items[best].value)) {
+        best = child;
+      }
+    }
+    if (!before(heap, heap->items[best].value, item.value)) {
+      break;
+    }
+    place(heap, position, heap->items[best]);
+    position = best;
+  }
+  place(heap, position, item);
+}
+
+struct minimalist_heap *
+minimalist_heap_from_array(unsigned int arity,
+                           minimalist_const_compare_fn compare,
+                           const void *const *values,
+                           size_t n) {
+  struct minimalist_heap *heap = minimalist_heap_new(arity, compare);
+
+  if (heap == NULL) {
+    return NULL;
+  }
+  if (reserve(heap, n) != 0) {
+    minimalist_heap_free(heap);
+    return NULL;
+  }
+  for (size_t i = 0; i < n; i++) {
+    heap->items[i].value = values[i];
+    heap->items[i].handle = i;
+    heap->positions[i] = i;
+  }
+  heap->size = n;
+  heap->num_handles = n;
+  if (n > 1) {
+    for (size_t i = (n - 2) / heap->arity + 1; i-- > 0;) {
+      sift_down(heap, i);
+    }
+  }
+  return heap;
+}
+
+size_t
+minimalist_heap_push(struct minimalist_heap *heap, const void *value) {
+  struct heap_item item = {value, 0};
+
+  if (heap->num_free > 0) {
+    item.handle = heap->free_handles[--heap->num_free];
+  } else {
+    if (heap->num_handles == heap->capacity &&
+        reserve(heap, heap->capacity ? heap->capacity * 2 : 16) != 0) {
+      return MINIMALIST_HEAP_INVALID;
+    }
+    item.handle = heap->num_handles++;
+  }
+  place(heap, heap->size++, item);
+  sift_up(heap, heap->size - 1);
+  return item.handle;
+}
+
+const void *
+minimalist_heap_peek(struct minimalist_heap *heap) {
+  return heap->size ? heap->items[0].value : NULL;
+}
+
+const void *
+minimalist_heap_pop(struct minimalist_heap *heap) {
+  struct heap_item top;
+
+  if (heap->size == 0) {
+    return NULL;
+  }
+  top = heap->items[0];
+  heap->positions[top.handle] = MINIMALIST_HEAP_INVALID;
+  heap->free_handles[heap->num_free++] = top.handle;
+  if (--heap->size > 0) {
+    place(heap, 0, heap->items[heap->size]);
+    sift_down(heap, 0);
+  }
+  return top.value;
+}
+
+void
+minimalist_heap_update(struct minimalist_heap *heap,
+                       size_t handle,
+                       const void *value) {
+  size_t position = 0;
+  const void *old = NULL;
+
+  if (!minimalist_heap_contains(heap, handle)) {
+    return;
+  }
+  position = heap->positions[handle];
+  old = heap->items[position].value;
+  heap->items[position].value = value;
+  if (before(heap, value, old)) {
+    sift_up(heap, position);
+  } else {
+    sift_down(heap, position);
+  }
+}
+
+int
+minimalist_heap_contains(struct minimalist_heap *heap, size_t handle) {
+  return handle < heap->num_handles &&
+         heap->positions[handle] != MINIMALIST_HEAP_INVALID;
+}
+
+size_t
+minimalist_heap_size(struct minimalist_heap *heap) {
+  return heap->size;
+}
@@ -0,0 +1,338 @@
+#include "minimalist/lru_cache.h"
+
+#include "minimalist/hash.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/*
+ * Initial buckets of a shard's hash map. The hash map has a fixed number of
+ * buckets, so it is rebuilt with twice as many whenever the shard's entries
+ * outgrow it.
+ */
+#define INITIAL_SHARD_BUCKETS 16
+
+struct lru_entry {
+  const void *key;
+  void *value;
+  size_t size;
+  int visited;
+  struct lru_entry *prev;
+  struct lru_entry *next;
+};
+
+/*
+ * Entries are kept in a list from most (head) to least (tail) recently
+ * inserted or, for LRU, used. SIEVE leaves entries in place on a hit and
+ * sweeps the hand from the tail towards the head looking for an entry that
+ * was not visited since the last sweep.
+ */
+struct lru_shard {
+  pthread_mutex_t lock;
+  struct minimalist_hash_map *entries;
+  struct lru_entry *head;
+  struct lru_entry *tail;
+  struct lru_entry *hand;
+  size_t num_entries;
+  size_t num_buckets;
+  size_t used;
+  size_t capacity;
+};
+
+struct minimalist_lru_cache {
+  enum minimalist_lru_cache_policy policy;
+  minimalist_hash_map_hash_fn hash;
+  minimalist_hash_map_compare_fn compare;
+  minimalist_lru_cache_evict_fn evict;
+  void *evict_context;
+  minimalist_lru_cache_size_fn size;
+  unsigned int num_shards;
+  struct lru_shard *shards;
+};
+
+struct minimalist_lru_cache *
+minimalist_lru_cache_new(size_t capacity,
+                         unsigned int shards,
+                         enum minimalist_lru_cache_policy policy,
+                         minimalist_hash_map_hash_fn hash,
+                         minimalist_hash_map_compare_fn compare) {
+  struct minimalist_lru_cache *cache = NULL;
+  struct lru_shard *shard = NULL;
+
+  if (hash == NULL || compare == NULL) {
+    return NULL;
+  }
+  /* Every shard gets room for at least one entry */
+  if (shards > capacity) {
+    shards = (unsigned int)capacity;
+  }
+  if (shards == 0) {
+    shards = 1;
+  }
+  cache = calloc(1, sizeof(struct minimalist_lru_cache));
+  if (cache == NULL) {
+    return NULL;
+  }
+  cache->policy = policy;
+  cache->hash = hash;
+  cache->compare = compare;
+  cache->shards = calloc(shards, sizeof(struct lru_shard));
+  if (cache->shards == NULL) {
+    free(cache);
+    return NULL;
+  }
+  for (unsigned int i = 0; i < shards; i++) {
+    shard = &cache->shards[i];
+    shard->capacity = capacity / shards + (i < capacity % shards);
+    shard->num_buckets = INITIAL_SHARD_BUCKETS;
+    shard->entries =
+        minimalist_hash_map_new(shard->num_buckets, hash, compare);
+    if (shard->entries == NULL) {
+      minimalist_lru_cache_free(cache);
+      return NULL;
+    }
+    pthread_mutex_init(&shard->lock, NULL);
+    cache->num_shards++;
+  }
+  return cache;
+}
+
+static void
+evict_entries(struct minimalist_lru_cache *cache, struct lru_entry *entry) {
+  struct lru_entry *next = NULL;
+  while (entry != NULL) {
+    next = entry->next;
+    if (cache->evict) {
+      cache->evict(cache->evict_context, entry->key, entry->value);
+    }
+    free(entry);
+    entry = next;
+  }
+}
+
+void
+minimalist_lru_cache_free(struct minimalist_lru_cache *cache) {
+  struct lru_shard *shard = NULL;
+
+  if (cache == NULL) {
+    return;
+  }
+  for (unsigned int i = 0; i < cache->num_shards; i++) {
+    shard = &cache->shards[i];
+    evict_entries(cache, shard->head);
+    minimalist_hash_map_free(shard->entries);
+    pthread_mutex_destroy(&shard->lock);
+  }
+  free(cache->shards);
+  free(cache);
+}
+
+void
+minimalist_lru_cache_set_evict_fn(struct minimalist_lru_cache *cache,
+                                  minimalist_lru_cache_evict_fn evict,
+                                  void *context) {
+  cache->evict = evict;
+  cache->evict_context = context;
+}
+
+void
+minimalist_lru_cache_set_size_fn(struct minimalist_lru_cache *cache,
+                                 minimalist_lru_cache_size_fn size) {
+  cache->size = size;
+}
+
+static struct lru_shard *
+get_shard(struct minimalist_lru_cache *cache, const void *key) {
+  uint64_t hash = minimalist_hash_u64(cache->hash(key));
+  return &cache->shards[hash % cache->num_shards];
+}
+
+static void
+unlink_entry(struct lru_shard *shard, struct lru_entry *entry) {
+  if (shard->hand == entry) {
+    shard->hand = entry->prev;
+  }
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    shard->head = entry->next;
+  }
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    shard->tail = entry->prev;
+  }
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+static void
+push_front(struct lru_shard *shard, struct lru_entry *entry) {
+  entry->prev = NULL;
+  entry->next = shard->head;
+  if (shard->head) {
+    shard->head->prev = entry;
+  } else {
+    shard->tail = entry;
+  }
+  shard->head = entry;
+}
+
+static void
+touch(struct minimalist_lru_cache *cache,
+      struct lru_shard *shard,
+      struct lru_entry *entry) {
+  if (cache->policy == MINIMALIST_LRU_CACHE_SIEVE) {
+    entry->visited = 1;
+  } else if (shard->head != entry) {
+    unlink_entry(shard, entry);
+    push_front(shard, entry);
+  }
+}
+
+static struct lru_entry *
+pick_victim(struct minimalist_lru_cache *cache, struct lru_shard *shard) {
+  struct lru_entry *entry = shard->tail;
+
+  if (cache->policy == MINIMALIST_LRU_CACHE_SIEVE) {
+    entry = shard->hand ? shard->hand : shard->tail;
+    while (entry->visited) {
+      entry->visited = 0;
+      entry = entry->prev ? entry->prev : shard->tail;
+    }
+    shard->hand = entry->prev;
+  }
+  return entry;
+}
+
+/* Rebuilds the shard's hash map, keeping the old one on allocation failure */
+static void
+grow_entries(struct minimalist_lru_cache *cache, struct lru_shard *shard) {
+  size_t num_buckets = shard->num_buckets * 2;
+  struct minimalist_hash_map *entries =
+      minimalist_hash_map_new(num_buckets, cache->hash, cache->compare);
+  struct lru_entry *entry = NULL;
+  void **slot = NULL;
+
+  if (entries == NULL) {
+    return;
+  }
+  for (entry = shard->head; entry != NULL; entry = entry->next) {
+    slot = minimalist_hash_map_upsert(entries, entry->key, NULL);
+    if (slot == NULL) {
+      minimalist_hash_map_free(entries);
+      return;
+    }
+    *slot = entry;
+  }
+  minimalist_hash_map_free(shard->entries);
+  shard->entries = entries;
+  shard->num_buckets = num_buckets;
+}
+
+/* Removes entry from the shard and pushes it onto the evicted list */
+static void
+remove_entry(struct lru_shard *shard,
+             struct lru_entry *entry,
+             struct lru_entry **evicted) {
+  unlink_entry(shard, entry);
+  minimalist_hash_map_set(shard->entries, entry->key, NULL);
+  shard->num_entries--;
+  shard->used -= entry->size;
+  entry->next = *evicted;
+  *evicted = entry;
+}
+
+void *
+minimalist_lru_cache_get(struct minimalist_lru_cache *cache, const void *key) {
+  struct lru_shard *shard = get_shard(cache, key);
+  struct lru_entry *entry = NULL;
+  void *value = NULL;
+
+  pthread_mutex_lock(&shard->lock);
+  entry = minimalist_hash_map_get(shard->entries, key);
+  if (entry) {
+    touch(cache, shard, entry);
+    value = entry->value;
+  }
+  pthread_mutex_unlock(&shard->lock);
+  return value;
+}
+
+void
+minimalist_lru_cache_put(struct minimalist_lru_cache *cache,
+                         const void *key,
+                         void *value) {
+  struct lru_shard *shard = get_shard(cache, key);
+  struct lru_entry *entry = NULL, *evicted = NULL, *spare = NULL;
+  size_t size = 1;
+
+  if (value != NULL && cache->size) {
+    size = cache->size(key, value);
+  }
+  if (value != NULL) {
+    spare = malloc(sizeof(struct lru_entry));
+    if (spare == NULL) {
+      return;
+    }
+  }
+
+  pthread_mutex_lock(&shard->lock);
+  entry = minimalist_hash_map_get(shard->entries, key);
+  if (value == NULL) {
+    if (entry) {
+      remove_entry(shard, entry, &evicted);
+    }
+  } else if (entry) {
+    /* Hand the old pair to the evict callback in the spare entry */
+    if (entry->key != key || entry->value != value) {
+      spare->key = entry->key;
+      spare->value = entry->value;
+      spare->next = evicted;
+      evicted = spare;
+      spare = NULL;
+    }
+    if (entry->key != key) {
+      /* The hash map keeps the key it was given first */
+      minimalist_hash_map_set(shard->entries, entry->key, NULL);
+      minimalist_hash_map_set(shard->entries, key, entry);
+    }
+    shard->used += size - entry->size;
+    entry->key = key;
+    entry->value = value;
+    entry->size = size;
+    touch(cache, shard, entry);
+  } else {
+    entry = spare;
+    spare = NULL;
+    entry->key = key;
+    entry->value = value;
+    entry->size = size;
+    entry->visited = 0;
+    minimalist_hash_map_set(shard->entries, key, entry);
+    push_front(shard, entry);
+    shard->num_entries++;
+    shard->used += size;
+  }
+  while (shard->used > shard->capacity && shard->tail != NULL) {
+    remove_entry(shard, pick_victim(cache, shard), &evicted);
+  }
+  if (shard->num_entries > shard->num_buckets) {
+    grow_entries(cache, shard);
+  }
+  pthread_mutex_unlock(&shard->lock);
+
+  free(spare);
+  evict_entries(cache, evicted);
+}
+
+size_t
+minimalist_lru_cache_size(struct minimalist_lru_cache *cache) {
+  size_t used = 0;
+  for (unsigned int i = 0; i < cache->num_shards; i++) {
+    pthread_mutex_lock(&cache->shards[i].lock);
+    used += cache->shards[i].used;
+    pthread_mutex_unlock(&cache->shards[i].lock);
+  }
+  return used;
+}
@@ -1,30 +1,42 @@
 #include "minimalist/map.h"
 
-#include <assert.h>
-#include <stdio.h>
-#include <stdlib.h>
+#include "rb_tree.h"
+#include "slab.h"
 
-enum color_t { RED, BLACK };
+#include <stdlib.h>
 
+/*
+ * Nodes come from a slab and have no parent link, so an entry takes four
+ * words and no malloc header.
+ */
 struct map_node {
-  struct map_node *parent;
-  struct map_node *left;
-  struct map_node *right;
-  enum color_t color;
+  struct minimalist_rb_node link;
   const void *key;
   void *value;
 };
 
 static int
 address_compare(const void *a, const void *b) {
-  return b - a;
+  return (a < b) - (a > b);
 }
 
 struct minimalist_map {
-  struct map_node *root;
+  struct minimalist_rb_node *root;
   minimalist_const_compare_fn compare;
+  struct minimalist_slab nodes;
+  int size;
 };
 
+static struct map_node *
+left_of(const struct map_node *node) {
+  return (struct map_node *)minimalist_rb_left(&node->link);
+}
+
+static struct map_node *
+right_of(const struct map_node *node) {
+  return (struct map_node *)minimalist_rb_right(&node->link);
+}
+
 struct minimalist_map *
 minimalist_map_new(minimalist_const_compare_fn compare) {
 
@@ -42,174 +54,141 @@ minimalist_map_new(minimalist_const_compare_fn compare) {
     map->compare = address_compare;
   }
   map->root = NULL;
+  map->size = 0;
+  minimalist_slab_init(&map->nodes, sizeof(struct map_node));
 err:
   return map;
 }
 
-static void
-free_node(struct map_node *node) {
-  if (node->right != NULL) {
-    free_node(node->right);
-  } else if (node->left != NULL) {
-    free_node(node->left);
-  }
-  free(node);
-}
-
 void
 minimalist_map_free(struct minimalist_map *map) {
   if (map) {
-    if (map->root) {
-      free_node(map->root);
-    }
+    minimalist_slab_destroy(&map->nodes);
     free(map);
   }
 }
 
+/*
+ * Descends towards key, recording the nodes passed in path. Returns the node
+ * holding key, which ends the path, or NULL with left telling on which side
+ * of the last node on the path it would be added.
+ */
 static struct map_node *
-get_sibling(struct map_node *node) {
-  if (node->parent == NULL) {
-    return NULL;
-  }
-
-  if (node == node->parent->left) {
-    return node->parent->right;
-  } else {
-    return node->parent->left;
+descend(struct minimalist_map *map,
+        const void *key,
+        struct minimalist_rb_node **path,
+        int *depth,
+        int *left) {
+  struct map_node *node = (struct map_node *)map->root;
+  int comparison = 0;
+
+  *depth = 0;
+  while (node != NULL) {
+    path[(*depth)++] = &node->link;
+    comparison = map->compare(node->key, key);
+    if (comparison == 0) {
+      return node;
+    }
+    *left = comparison < 0;
+    node = *left ? left_of(node) : right_of(node);
   }
+  return NULL;
 }
 
-static struct map_node *
-get_parent(struct map_node *node) {
-  return node == NULL ? NULL : node->parent;
-}
-
-static struct map_node *
-get_grand_parent(struct map_node *node) {
-  return get_parent(get_parent(node));
-}
-
-static struct map_node *
-get_uncle(struct map_node *node) {
-  struct map_node *parent = get_parent(node);
-  return get_sibling(parent);
-}
+void **
+minimalist_map_upsert(struct minimalist_map *map,
+                      const void *key,
+                      int *inserted) {
+  struct minimalist_rb_node *path[MINIMALIST_RB_MAX_HEIGHT];
+  struct map_node *node = NULL;
+  int depth = 0, left = 0;
 
-static void
-rotate_left(struct map_node *node) {
-  struct map_node *new_node = node->right;
-  struct map_node *parent = get_parent(node);
-  assert(new_node != NULL);
-
-  node->right = new_node->left;
-  new_node->left = node;
-  if (node->right != NULL) {
-    node->right->parent = node;
-  }
-
-  if (parent != NULL) {
-    if (node == parent->left) {
-      parent->left = new_node;
-    } else if (node == parent->right) {
-      parent->right = new_node;
+  node = descend(map, key, path, &depth, &left);
+  if (inserted) {
+    *inserted = node == NULL;
+  }
+  if (node != NULL) {
+    return &node->value;
+  }
+  node = minimalist_slab_alloc(&map->nodes);
+  if (node == NULL) {
+    if (inserted) {
+      *inserted = 0;
     }
+    return NULL;
   }
+  node->key = key;
+  node->value = NULL;
+  minimalist_rb_insert(&map->root, path, depth, &node->link, left);
+  map->size++;
+  return &node->value;
 }
 
-static void
-repair(struct map_node *node) {
-  if (get_parent(node) == NULL) {
-    node->color = BLACK;
-  } else if (get_parent(node)->color == BLACK) {
-    // Do nothing
-  } else if (get_uncle(node) != NULL && get_uncle(node)->color == RED) {
-    get_parent(node)->color = BLACK;
-    get_uncle(node)->color = BLACK;
-    get_grand_parent(node)->color = RED;
-    repair(get_grand_parent(node));
-  } else {
-    // TODO: Balance map
+void
+minimalist_map_set(struct minimalist_map *map, const void *key, void *value) {
+  void **slot = minimalist_map_upsert(map, key, NULL);
+  if (slot != NULL) {
+    *slot = value;
   }
 }
 
-static void
-add(struct map_node *root,
-    struct map_node *node,
-    minimalist_const_compare_fn compare) {
-  int comparison = compare(root->key, node->key);
-  if (root != NULL) {
-    if (comparison > 0) {
-      if (root->right != NULL) {
-        add(root->right, node, compare);
-      } else {
-        node->parent = root;
-        root->right = node;
-      }
-    } else if (comparison < 0) {
-      if (root->left != NULL) {
-        add(root->left, node, compare);
-      } else {
-        node->parent = root;
-        root->left = node;
-      }
-    } else {
-      root->value = node->value;
-      free(node);
-    }
+int
+minimalist_map_remove(struct minimalist_map *map,
+                      const void *key,
+                      const void **old_key,
+                      void **old_value) {
+  struct minimalist_rb_node *path[MINIMALIST_RB_MAX_HEIGHT];
+  struct map_node *node = NULL;
+  int depth = 0, left = 0;
+
+  node = descend(map, key, path, &depth, &left);
+  if (node == NULL) {
+    return 0;
+  }
+  if (old_key) {
+    *old_key = node->key;
   }
+  if (old_value) {
+    *old_value = node->value;
+  }
+  minimalist_rb_remove(&map->root, path, depth);
+  minimalist_slab_release(&map->nodes, node);
+  map->size--;
+  return 1;
 }
 
-void
-minimalist_map_set(struct minimalist_map *map, const void *key, void *value) {
-  struct map_node *new_node = malloc(sizeof(struct map_node));
-  if (new_node != NULL) {
-    new_node->parent = NULL;
-    new_node->left = NULL;
-    new_node->right = NULL;
-    new_node->key = key;
-    new_node->value = value;
-    new_node->color = RED;
-    if (map->root != NULL) {
-      add(map->root, new_node, map->compare);
-    } else {
-      map->root = new_node;
-    }
-    repair(new_node);
-  }
-}
-
-static void *
-find(struct map_node *node,
-     const void *key,
-     minimalist_const_compare_fn compare) {
-  if (node) {
-    int comparison = compare(node->key, key);
-    if (comparison > 0) {
-      return find(node->right, key, compare);
-    } else if (comparison < 0) {
-      return find(node->left, key, compare);
-    } else {
-      return node->value;
-    }
-  } else {
-    return NULL;
+static struct map_node *
+find(struct minimalist_map *map, const void *key) {
+  struct map_node *node = (struct map_node *)map->root;
+  int comparison = 0;
+
+  while (node != NULL &&
+         (comparison = map->compare(node->key, key)) != 0) {
+    node = comparison < 0 ? left_of(node) : right_of(node);
   }
+  return node;
 }
 
 void *
 minimalist_map_get(struct minimalist_map *map, const void *key) {
-  return find(map->root, key, map->compare);
+  struct map_node *node = find(map, key);
+  return node ? node->value : NULL;
+}
+
+int
+minimalist_map_contains(struct minimalist_map *map, const void *key) {
+  return find(map, key) != NULL;
 }
 
 static void
 map_node_run(struct map_node *node, minimalist_map_run_fn run, void *context) {
   // Run left-to-right
-  if (node->left != NULL) {
-    map_node_run(node->left, run, context);
+  if (left_of(node) != NULL) {
+    map_node_run(left_of(node), run, context);
   }
   run(context, node->key, node->value);
-  if (node->right != NULL) {
-    map_node_run(node->right, run, context);
+  if (right_of(node) != NULL) {
+    map_node_run(right_of(node), run, context);
   }
 }
 
@@ -218,20 +197,18 @@ minimalist_map_run(struct minimalist_map *map,
                    minimalist_map_run_fn run,
                    void *context) {
   if (run && map->root) {
-    map_node_run(map->root, run, context);
+    map_node_run((struct map_node *)map->root, run, context);
   }
 }
 
 static void
-get_keys(struct map_node *node, const void ***keys, int *num_keys) {
-  if (node->left) {
-    get_keys(node->left, keys, num_keys);
+get_keys(struct map_node *node, const void **keys, int *num_keys) {
+  if (left_of(node)) {
+    get_keys(left_of(node), keys, num_keys);
   }
-  (*num_keys)++;
-  *keys = realloc(*keys, sizeof(void *) * (*num_keys));
-  (*keys)[(*num_keys) - 1] = node->key;
-  if (node->right) {
-    get_keys(node->right, keys, num_keys);
+  keys[(*num_keys)++] = node->key;
+  if (right_of(node)) {
+    get_keys(right_of(node), keys, num_keys);
   }
 }
 
@@ -240,7 +217,10 @@ minimalist_map_keys(struct minimalist_map *map, const void ***keys) {
   *keys = NULL;
   int num_keys = 0;
   if (map->root) {
-    get_keys(map->root, keys, &num_keys);
+    *keys = malloc(sizeof(void *) * map->size);
+    if (*keys != NULL) {
+      get_keys((struct map_node *)map->root, *keys, &num_keys);
+    }
   }
   return num_keys;
 }
@@ -0,0 +1,369 @@
+#include "minimalist/persistent_map.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/*
+ * Nodes are never modified once they are reachable from a version. An update
+ * copies the nodes along the path to the changed key and rebalances them as an
+ * AVL tree, taking new references to every subtree it keeps.
+ */
+struct persistent_node {
+  atomic_size_t references;
+  struct persistent_node *left;
+  struct persistent_node *right;
+  const void *key;
+  void *value;
+  int height;
+};
+
+struct minimalist_persistent_map {
+  atomic_size_t references;
+  minimalist_const_compare_fn compare;
+  struct persistent_node *root;
+  size_t size;
+};
+
+static int
+address_compare(const void *a, const void *b) {
+  return (a < b) - (a > b);
+}
+
+static struct persistent_node *
+node_retain(struct persistent_node *node) {
+  if (node) {
+    atomic_fetch_add_explicit(&node->references, 1, memory_order_relaxed);
+  }
+  return node;
+}
+
+static void
+node_release(struct persistent_node *node) {
+  if (node &&
+      atomic_fetch_sub_explicit(&node->references, 1, memory_order_acq_rel) ==
+          1) {
+    node_release(node->left);
+    node_release(node->right);
+    free(node);
+  }
+}
+
+static int
+height(struct persistent_node *node) {
+  return node ? node->height : 0;
+}
+
+/* Takes ownership of the references to left and right */
+static struct persistent_node *
+node_new(struct persistent_node *left,
+         const void *key,
+         void *value,
+         struct persistent_node *right,
+         int *failed) {
+  struct persistent_node *node = malloc(sizeof(struct persistent_node));
+  if (node == NULL) {
+    node_release(left);
+    node_release(right);
+    *failed = 1;
+    return NULL;
+  }
+  atomic_init(&node->references, 1);
+  node->left = left;
+  node->right = right;
+  node->key = key;
+  node->value = value;
+  node->height = 1 + (height(left) > height(right) ? height(left)
+                                                    : height(right));
+  return node;
+}
+
+/* Takes ownership of the references to left and right */
+static struct persistent_node *
+balance(struct persistent_node *left,
+        const void *key,
+        void *value,
+        struct persistent_node *right,
+        int *failed) {
+  struct persistent_node *result = NULL;
+  struct persistent_node *child = NULL, *inner = NULL;
+
+  if (height(left) > height(right) + 1) {
+    child = left;
+    if (height(child->left) >= height(child->right)) {
+      result = node_new(node_retain(child->left),
+                        child->key,
+                        child->value,
+                        node_new(node_retain(child->right),
+                                 key,
+                                 value,
+                                 right,
+                                 failed),
+                        failed);
+    } else {
+      inner = child->right;
+      result = node_new(node_new(node_retain(child->left),
+                                 child->key,
+                                 child->value,
+                                 node_retain(inner->left),
+                                 failed),
+                        inner->key,
+                        inner->value,
+                        node_new(node_retain(inner->right),
+                                 key,
+                                 value,
+                                 right,
+                                 failed),
+                        failed);
+    }
+    node_release(child);
+  } else if (height(right) > height(left) + 1) {
+    child = right;
+    if (height(child->right) >= height(child->left)) {
+      result = node_new(node_new(left,
+                                 key,
+                                 value,
+                                 node_retain(child->left),
+                                 failed),
+                        child->key,
+                        child->value,
+                        node_retain(child->right),
+                        failed);
+    } else {
+      inner = child->left;
+      result = node_new(node_new(left,
+                                 key,
+                                 value,
+                                 node_retain(inner->left),
+                                 failed),
+                        inner->key,
+                        inner->value,
+                        node_new(node_retain(inner->right),
+                                 child->key,
+                                 child->value,
+                                 node_retain(child->right),
+                                 failed),
+                        failed);
+    }
+    node_release(child);
+  } else {
+    result = node_new(left, key, value, right, failed);
+  }
+  return result;
+}
+
+static struct persistent_node *
+insert(struct persistent_node *node,
+       const void *key,
+       void *value,
+       minimalist_const_compare_fn compare,
+       int *added,
+       int *failed) {
+  int comparison = 0;
+
+  if (node == NULL) {
+    *added = 1;
+    return node_new(NULL, key, value, NULL, failed);
+  }
+
+  comparison = compare(node->key, key);
+  if (comparison > 0) {
+    return balance(node_retain(node->left),
+                   node->key,
+                   node->value,
+                   insert(node->right, key, value, compare, added, failed),
+                   failed);
+  } else if (comparison < 0) {
+    return balance(insert(node->left, key, value, compare, added, failed),
+                   node->key,
+                   node->value,
+                   node_retain(node->right),
+                   failed);
+  } else {
+    return node_new(node_retain(node->left),
+                    node->key,
+                    value,
+                    node_retain(node->right),
+                    failed);
+  }
+}
+
+static struct persistent_node *
+remove_min(struct persistent_node *node,
+           const void **key,
+           void **value,
+           int *failed) {
+  if (node->left == NULL) {
+    *key = node->key;
+    *value = node->value;
+    return node_retain(node->right);
+  }
+  return balance(remove_min(node->left, key, value, failed),
+                 node->key,
+                 node->value,
+                 node_retain(node->right),
+                 failed);
+}
+
+/* Expects key to be present in the tree */
+static struct persistent_node *
+remove_key(struct persistent_node *node,
+           const void *key,
+           minimalist_const_compare_fn compare,
+           int *failed) {
+  const void *min_key = NULL;
+  void *min_value = NULL;
+  struct persistent_node *right = NULL;
+  int comparison = compare(node->key, key);
+
+  if (comparison > 0) {
+    return balance(node_retain(node->left),
+                   node->key,
+                   node->value,
+                   remove_key(node->right, key, compare, failed),
+                   failed);
+  } else if (comparison < 0) {
+    return balance(remove_key(node->left, key, compare, failed),
+                   node->key,
+                   node->value,
+                   node_retain(node->right),
+                   failed);
+  } else if (node->right == NULL) {
+    return node_retain(node->left);
+  } else if (node->left == NULL) {
+    return node_retain(node->right);
+  } else {
+    right = remove_min(node->right, &min_key, &min_value, failed);
+    return balance(
+        node_retain(node->left), min_key, min_value, right, failed);
+  }
+}
+
+static struct persistent_node *
+find(struct persistent_node *node,
+     const void *key,
+     minimalist_const_compare_fn compare) {
+  while (node) {
+    int comparison = compare(node->key, key);
+    if (comparison > 0) {
+      node = node->right;
+    } else if (comparison < 0) {
+      node = node->left;
+    } else {
+      break;
+    }
+  }
+  return node;
+}
+
+static struct minimalist_persistent_map *
+version_new(minimalist_const_compare_fn compare,
+            struct persistent_node *root,
+            size_t size) {
+  struct minimalist_persistent_map *map =
+      malloc(sizeof(struct minimalist_persistent_map));
+  if (map == NULL) {
+    node_release(root);
+    return NULL;
+  }
+  atomic_init(&map->references, 1);
+  map->compare = compare;
+  map->root = root;
+  map->size = size;
+  return map;
+}
+
+struct minimalist_persistent_map *
+minimalist_persistent_map_new(minimalist_const_compare_fn compare) {
+  return version_new(compare ? compare : address_compare, NULL, 0);
+}
+
+struct minimalist_persistent_map *
+minimalist_persistent_map_retain(struct minimalist_persistent_map *map) {
+  if (map) {
+    atomic_fetch_add_explicit(&map->references, 1, memory_order_relaxed);
+  }
+  return map;
+}
+
+void
+minimalist_persistent_map_free(struct minimalist_persistent_map *map) {
+  if (map &&
+      atomic_fetch_sub_explicit(&map->references, 1, memory_order_acq_rel) ==
+          1) {
+    node_release(map->root);
+    free(map);
+  }
+}
+
+struct minimalist_persistent_map *
+minimalist_persistent_map_set(struct minimalist_persistent_map *map,
+                              const void *key,
+                              void *value) {
+  int added = 0, failed = 0;
+  struct persistent_node *root =
+      insert(map->root, key, value, map->compare, &added, &failed);
+
+  if (failed) {
+    node_release(root);
+    return NULL;
+  }
+  return version_new(map->compare, root, map->size + added);
+}
+
+struct minimalist_persistent_map *
+minimalist_persistent_map_remove(struct minimalist_persistent_map *map,
+                                 const void *key) {
+  struct persistent_node *root = NULL;
+  int failed = 0;
+
+  if (find(map->root, key, map->compare) == NULL) {
+    return minimalist_persistent_map_retain(map);
+  }
+  root = remove_key(map->root, key, map->compare, &failed);
+  if (failed) {
+    node_release(root);
+    return NULL;
+  }
+  return version_new(map->compare, root, map->size - 1);
+}
+
+void *
+minimalist_persistent_map_get(struct minimalist_persistent_map *map,
+                              const void *key) {
+  struct persistent_node *node = find(map->root, key, map->compare);
+  return node ? node->value : NULL;
+}
+
+int
+minimalist_persistent_map_contains(struct minimalist_persistent_map *map,
+                                   const void *key) {
+  return find(map->root, key, map->compare) != NULL;
+}
+
+size_t
+minimalist_persistent_map_size(struct minimalist_persistent_map *map) {
+  return map->size;
+}
+
+static void
+node_run(struct persistent_node *node,
+         minimalist_persistent_map_run_fn run,
+         void *context) {
+  // Run left-to-right
+  if (node->left != NULL) {
+    node_run(node->left, run, context);
+  }
+  run(context, node->key, node->value);
+  if (node->right != NULL) {
+    node_run(node->right, run, context);
+  }
+}
+
+void
+minimalist_persistent_map_run(struct minimalist_persistent_map *map,
+                              minimalist_persistent_map_run_fn run,
+                              void *context) {
+  if (run && map->root) {
+    node_run(map->root, run, context);
+  }
+}
@@ -0,0 +1,239 @@
+#include "rb_tree.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+static int
+is_red(const struct minimalist_rb_node *node) {
+  return node != NULL && (node->left_red & 1);
+}
+
+static void
+set_red(struct minimalist_rb_node *node, int red) {
+  node->left_red = (node->left_red & ~(uintptr_t)1) | (red ? 1 : 0);
+}
+
+static void
+set_left(struct minimalist_rb_node *node, struct minimalist_rb_node *left) {
+  node->left_red = (uintptr_t)left | (node->left_red & 1);
+}
+
+static void
+replace_child(struct minimalist_rb_node **root,
+              struct minimalist_rb_node *parent,
+              struct minimalist_rb_node *old_child,
+              struct minimalist_rb_node *new_child) {
+  if (parent == NULL) {
+    *root = new_child;
+  } else if (minimalist_rb_left(parent) == old_child) {
+    set_left(parent, new_child);
+  } else {
+    parent->right = new_child;
+  }
+}
+
+static void
+rotate_left(struct minimalist_rb_node **root,
+            struct minimalist_rb_node *parent,
+            struct minimalist_rb_node *node) {
+  struct minimalist_rb_node *new_node = node->right;
+  assert(new_node != NULL);
+
+  node->right = minimalist_rb_left(new_node);
+  set_left(new_node, node);
+  replace_child(root, parent, node, new_node);
+}
+
+static void
+rotate_right(struct minimalist_rb_node **root,
+             struct minimalist_rb_node *parent,
+             struct minimalist_rb_node *node) {
+  struct minimalist_rb_node *new_node = minimalist_rb_left(node);
+  assert(new_node != NULL);
+
+  set_left(node, new_node->right);
+  new_node->right = node;
+  replace_child(root, parent, node, new_node);
+}
+
+void
+minimalist_rb_insert(struct minimalist_rb_node **root,
+                     struct minimalist_rb_node **path,
+                     int depth,
+                     struct minimalist_rb_node *node,
+                     int left) {
+  struct minimalist_rb_node *parent = NULL, *grand_parent = NULL;
+  struct minimalist_rb_node *uncle = NULL, *above = NULL;
+  int d = depth - 1;
+
+  node->left_red = 1;
+  node->right = NULL;
+  if (depth == 0) {
+    *root = node;
+  } else if (left) {
+    set_left(path[d], node);
+  } else {
+    path[d]->right = node;
+  }
+
+  while (d >= 0 && is_red(path[d])) {
+    // A red parent is never the root
+    parent = path[d];
+    grand_parent = path[d - 1];
+    above = d >= 2 ? path[d - 2] : NULL;
+    if (parent == minimalist_rb_left(grand_parent)) {
+      uncle = grand_parent->right;
+    } else {
+      uncle = minimalist_rb_left(grand_parent);
+    }
+    if (is_red(uncle)) {
+      set_red(parent, 0);
+      set_red(uncle, 0);
+      set_red(grand_parent, 1);
+      node = grand_parent;
+      d -= 2;
+      continue;
+    }
+    if (parent == minimalist_rb_left(grand_parent)) {
+      if (node == parent->right) {
+        rotate_left(root, grand_parent, parent);
+        parent = node;
+      }
+      rotate_right(root, above, grand_parent);
+    } else {
+      if (node == minimalist_rb_left(parent)) {
+        rotate_right(root, grand_parent, parent);
+        parent = node;
+      }
+      rotate_left(root, above, grand_parent);
+    }
+    set_red(parent, 0);
+    set_red(grand_parent, 1);
+    break;
+  }
+  set_red(*root, 0);
+}
+
+/*
+ * Restores the black heights after a black node was unlinked from the left
+ * or right of path[d], leaving node, which may be NULL, in its place.
+ */
+static void
+repair_removal(struct minimalist_rb_node **root,
+               struct minimalist_rb_node **path,
+               int d,
+               struct minimalist_rb_node *node,
+               int left) {
+  struct minimalist_rb_node *parent = NULL, *sibling = NULL, *above = NULL;
+
+  while (d >= 0 && !is_red(node)) {
+    parent = path[d];
+    above = d >= 1 ? path[d - 1] : NULL;
+    if (left) {
+      sibling = parent->right;
+      if (is_red(sibling)) {
+        set_red(sibling, 0);
+        set_red(parent, 1);
+        rotate_left(root, above, parent);
+        // The sibling now sits between parent and above
+        path[d] = sibling;
+        path[++d] = parent;
+        above = sibling;
+        sibling = parent->right;
+      }
+      if (!is_red(minimalist_rb_left(sibling)) && !is_red(sibling->right)) {
+        set_red(sibling, 1);
+        node = parent;
+        left = d >= 1 && minimalist_rb_left(path[d - 1]) == parent;
+        d--;
+        continue;
+      }
+      if (!is_red(sibling->right)) {
+        set_red(minimalist_rb_left(sibling), 0);
+        set_red(sibling, 1);
+        rotate_right(root, parent, sibling);
+        sibling = parent->right;
+      }
+      set_red(sibling, is_red(parent));
+      set_red(parent, 0);
+      set_red(sibling->right, 0);
+      rotate_left(root, above, parent);
+    } else {
+      sibling = minimalist_rb_left(parent);
+      if (is_red(sibling)) {
+        set_red(sibling, 0);
+        set_red(parent, 1);
+        rotate_right(root, above, parent);
+        path[d] = sibling;
+        path[++d] = parent;
+        above = sibling;
+        sibling = minimalist_rb_left(parent);
+      }
+      if (!is_red(minimalist_rb_left(sibling)) && !is_red(sibling->right)) {
+        set_red(sibling, 1);
+        node = parent;
+        left = d >= 1 && minimalist_rb_left(path[d - 1]) == parent;
+        d--;
+        continue;
+      }
+      if (!is_red(minimalist_rb_left(sibling))) {
+        set_red(sibling->right, 0);
+        set_red(sibling, 1);
+        rotate_left(root, parent, sibling);
+        sibling = minimalist_rb_left(parent);
+      }
+      set_red(sibling, is_red(parent));
+      set_red(parent, 0);
+      set_red(minimalist_rb_left(sibling), 0);
+      rotate_right(root, above, parent);
+    }
+    return;
+  }
+  if (node != NULL) {
+    set_red(node, 0);
+  }
+}
+
+void
+minimalist_rb_remove(struct minimalist_rb_node **root,
+                     struct minimalist_rb_node **path,
+                     int depth) {
+  struct minimalist_rb_node *node = path[depth - 1], *child = NULL;
+  struct minimalist_rb_node *replacement = NULL, *parent = NULL;
+  int index = depth - 1, left = 0, red = 0;
+
+  if (minimalist_rb_left(node) != NULL && node->right != NULL) {
+    // Move the node run just before it into its place, then unlink the
+    // position that node vacated
+    replacement = minimalist_rb_left(node);
+    path[depth++] = replacement;
+    while (replacement->right != NULL) {
+      replacement = replacement->right;
+      path[depth++] = replacement;
+    }
+    child = minimalist_rb_left(replacement);
+    red = is_red(replacement);
+    parent = path[depth - 2];
+    if (parent == node) {
+      left = 1;
+    } else {
+      parent->right = child;
+      set_left(replacement, minimalist_rb_left(node));
+      left = 0;
+    }
+    replacement->right = node->right;
+    set_red(replacement, is_red(node));
+    replace_child(root, index > 0 ? path[index - 1] : NULL, node, replacement);
+    path[index] = replacement;
+  } else {
+    child = minimalist_rb_left(node) != NULL ? minimalist_rb_left(node)
+                                              : node->right;
+    red = is_red(node);
+    parent = index > 0 ? path[index - 1] : NULL;
+    left = parent != NULL && minimalist_rb_left(parent) == node;
+    replace_child(root, parent, node, child);
+  }
+  if (!red) {
+    repair_removal(root, path, depth - 2, child, left);
+  }
+}
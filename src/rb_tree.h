@@ -0,0 +1,50 @@
+#ifndef __MINIMALIST_RB_TREE_H__
+#define __MINIMALIST_RB_TREE_H__
+/*
+ * An intrusive red-black tree shared by map and set. Nodes have no parent
+ * link and keep their color in the low bit of the left link, so a node costs
+ * two words on top of its payload. Callers descend from the root themselves,
+ * recording the nodes they pass in a path, which then stands in for the
+ * parent links while rebalancing.
+ */
+
+#include <stdint.h>
+
+/* Longest path in a red-black tree of up to 2^64 nodes */
+#define MINIMALIST_RB_MAX_HEIGHT 128
+
+struct minimalist_rb_node {
+  uintptr_t left_red;
+  struct minimalist_rb_node *right;
+};
+
+static inline struct minimalist_rb_node *
+minimalist_rb_left(const struct minimalist_rb_node *node) {
+  return (struct minimalist_rb_node *)(node->left_red & ~(uintptr_t)1);
+}
+
+static inline struct minimalist_rb_node *
+minimalist_rb_right(const struct minimalist_rb_node *node) {
+  return node->right;
+}
+
+/*
+ * Links node, red and without children, as the left or right child of
+ * path[depth - 1], or as the root if depth is 0, and rebalances. path holds
+ * the nodes from the root down to the new parent.
+ */
+void minimalist_rb_insert(struct minimalist_rb_node **root,
+                          struct minimalist_rb_node **path,
+                          int depth,
+                          struct minimalist_rb_node *node,
+                          int left);
+
+/*
+ * Unlinks path[depth - 1] and rebalances. path holds the nodes from the root
+ * down to the node and must have room for MINIMALIST_RB_MAX_HEIGHT nodes.
+ */
+void minimalist_rb_remove(struct minimalist_rb_node **root,
+                          struct minimalist_rb_node **path,
+                          int depth);
+
+#endif /* __MINIMALIST_RB_TREE_H__ */
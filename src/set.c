@@ -1,28 +1,53 @@
 #include "minimalist/set.h"
 
+#include "minimalist/bloom_filter.h"
+
+#include "rb_tree.h"
+#include "slab.h"
+
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
-enum color_t { RED, BLACK };
-
+/* Nodes come from a slab and have no parent link, three words in all */
 struct set_node {
-  struct set_node *parent;
-  struct set_node *left;
-  struct set_node *right;
-  enum color_t color;
+  struct minimalist_rb_node link;
   const void *value;
 };
 
 static int
 address_compare(const void *a, const void *b) {
-  return b - a;
+  return (a < b) - (a > b);
 }
 
+/* Values stored in the set itself before spilling to the tree */
+#define INLINE_VALUES 4
+
+/*
+ * Small sets keep their values in inline_values, ordered the same way the
+ * tree is run. Once more than INLINE_VALUES values are added, all of them move
+ * to the tree and num_inline stays zero.
+ */
 struct minimalist_set {
-  struct set_node *root;
+  struct minimalist_rb_node *root;
   minimalist_const_compare_fn compare;
+  int num_inline;
+  const void *inline_values[INLINE_VALUES];
+  struct minimalist_bloom_filter *filter;
+  minimalist_hash_fn hash;
+  struct minimalist_slab nodes;
 };
 
+static struct set_node *
+left_of(const struct set_node *node) {
+  return (struct set_node *)minimalist_rb_left(&node->link);
+}
+
+static struct set_node *
+right_of(const struct set_node *node) {
+  return (struct set_node *)minimalist_rb_right(&node->link);
+}
+
 struct minimalist_set *
 minimalist_set_new(minimalist_const_compare_fn compare) {
 
@@ -38,174 +63,166 @@ minimalist_set_new(minimalist_const_compare_fn compare) {
       set->compare = address_compare;
     }
     set->root = NULL;
+    set->num_inline = 0;
+    set->filter = NULL;
+    set->hash = NULL;
+    minimalist_slab_init(&set->nodes, sizeof(struct set_node));
   }
 
   return set;
 }
 
-static void
-free_node(struct set_node *node) {
-  if (node->right != NULL) {
-    free_node(node->right);
-  } else if (node->left != NULL) {
-    free_node(node->left);
-  }
-  free(node);
-}
-
 void
 minimalist_set_free(struct minimalist_set *set) {
   if (set) {
-    if (set->root) {
-      free_node(set->root);
-    }
+    minimalist_slab_destroy(&set->nodes);
     free(set);
   }
 }
 
+/*
+ * Descends towards value, recording the nodes passed in path. Returns the
+ * node holding value, which ends the path, or NULL with left telling on which
+ * side of the last node on the path it would be added.
+ */
 static struct set_node *
-get_sibling(struct set_node *node) {
-  if (node->parent == NULL) {
-    return NULL;
-  }
-
-  if (node == node->parent->left) {
-    return node->parent->right;
-  } else {
-    return node->parent->left;
-  }
-}
-
-static struct set_node *
-get_parent(struct set_node *node) {
-  return node == NULL ? NULL : node->parent;
-}
+descend(struct minimalist_set *set,
+        const void *value,
+        struct minimalist_rb_node **path,
+        int *depth,
+        int *left) {
+  struct set_node *node = (struct set_node *)set->root;
+  int comparison = 0;
 
-static struct set_node *
-get_grand_parent(struct set_node *node) {
-  return get_parent(get_parent(node));
-}
-
-static struct set_node *
-get_uncle(struct set_node *node) {
-  struct set_node *parent = get_parent(node);
-  return get_sibling(parent);
-}
-
-static void
-rotate_left(struct set_node *node) {
-  struct set_node *new_node = node->right;
-  struct set_node *parent = get_parent(node);
-  assert(new_node != NULL);
-
-  node->right = new_node->left;
-  new_node->left = node;
-  if (node->right != NULL) {
-    node->right->parent = node;
-  }
-
-  if (parent != NULL) {
-    if (node == parent->left) {
-      parent->left = new_node;
-    } else if (node == parent->right) {
-      parent->right = new_node;
+  *depth = 0;
+  while (node != NULL) {
+    path[(*depth)++] = &node->link;
+    comparison = set->compare(node->value, value);
+    if (comparison == 0) {
+      return node;
     }
+    *left = comparison < 0;
+    node = *left ? left_of(node) : right_of(node);
   }
+  return NULL;
 }
 
 static void
-repair(struct set_node *node) {
-  if (get_parent(node) == NULL) {
-    node->color = BLACK;
-  } else if (get_parent(node)->color == BLACK) {
-    // Do nothing
-  } else if (get_uncle(node) != NULL && get_uncle(node)->color == RED) {
-    get_parent(node)->color = BLACK;
-    get_uncle(node)->color = BLACK;
-    get_grand_parent(node)->color = RED;
-    repair(get_grand_parent(node));
-  } else {
-    // TODO: Balance set
+tree_add(struct minimalist_set *set, const void *value) {
+  struct minimalist_rb_node *path[MINIMALIST_RB_MAX_HEIGHT];
+  struct set_node *node = NULL;
+  int depth = 0, left = 0;
+
+  node = descend(set, value, path, &depth, &left);
+  if (node != NULL) {
+    node->value = value;
+    return;
+  }
+  node = minimalist_slab_alloc(&set->nodes);
+  if (node != NULL) {
+    node->value = value;
+    minimalist_rb_insert(&set->root, path, depth, &node->link, left);
   }
 }
 
-static void
-add(struct set_node *root,
-    struct set_node *node,
-    minimalist_const_compare_fn compare) {
-  int comparison = compare(root->value, node->value);
-  if (root != NULL) {
-    if (comparison > 0) {
-      if (root->right != NULL) {
-        add(root->right, node, compare);
-      } else {
-        node->parent = root;
-        root->right = node;
-      }
+static int
+inline_add(struct minimalist_set *set, const void *value) {
+  int i = 0, comparison = 0;
+
+  for (i = 0; i < set->num_inline; i++) {
+    comparison = set->compare(set->inline_values[i], value);
+    if (comparison == 0) {
+      set->inline_values[i] = value;
+      return 1;
     } else if (comparison < 0) {
-      if (root->left != NULL) {
-        add(root->left, node, compare);
-      } else {
-        node->parent = root;
-        root->left = node;
-      }
-    } else {
-      root->value = node->value;
-      free(node);
+      break;
     }
   }
+  if (set->num_inline == INLINE_VALUES) {
+    return 0;
+  }
+  memmove(&set->inline_values[i + 1],
+          &set->inline_values[i],
+          sizeof(void *) * (set->num_inline - i));
+  set->inline_values[i] = value;
+  set->num_inline++;
+  return 1;
 }
 
 void
 minimalist_set_add(struct minimalist_set *set, const void *value) {
-  struct set_node *new_node = malloc(sizeof(struct set_node));
-  if (new_node != NULL) {
-    new_node->parent = NULL;
-    new_node->left = NULL;
-    new_node->right = NULL;
-    new_node->value = value;
-    new_node->color = RED;
-    if (set->root != NULL) {
-      add(set->root, new_node, set->compare);
-    } else {
-      set->root = new_node;
+  if (set->filter) {
+    minimalist_bloom_filter_add_hash(set->filter, set->hash(value));
+  }
+  if (set->root == NULL) {
+    if (inline_add(set, value)) {
+      return;
+    }
+    for (int i = 0; i < set->num_inline; i++) {
+      tree_add(set, set->inline_values[i]);
     }
-    repair(new_node);
+    set->num_inline = 0;
   }
+  tree_add(set, value);
 }
 
 static int
-exists(struct set_node *node,
-       const void *value,
-       minimalist_const_compare_fn compare) {
-  if (node) {
-    int comparison = compare(node->value, value);
-    if (comparison > 0) {
-      return exists(node->right, value, compare);
-    } else if (comparison < 0) {
-      return exists(node->left, value, compare);
-    } else {
-      return 1;
-    }
-  } else {
-    return 0;
+exists(struct minimalist_set *set, const void *value) {
+  struct set_node *node = (struct set_node *)set->root;
+  int comparison = 0;
+
+  while (node != NULL &&
+         (comparison = set->compare(node->value, value)) != 0) {
+    node = comparison < 0 ? left_of(node) : right_of(node);
   }
+  return node != NULL;
 }
 
 int
 minimalist_set_exists(struct minimalist_set *set, const void *value) {
-  return exists(set->root, value, set->compare);
+  if (set->filter &&
+      !minimalist_bloom_filter_contains_hash(set->filter, set->hash(value))) {
+    return 0;
+  }
+  for (int i = 0; i < set->num_inline; i++) {
+    if (set->compare(set->inline_values[i], value) == 0) {
+      return 1;
+    }
+  }
+  return exists(set, value);
+}
+
+void
+minimalist_set_remove(struct minimalist_set *set, const void *value) {
+  struct minimalist_rb_node *path[MINIMALIST_RB_MAX_HEIGHT];
+  struct set_node *node = NULL;
+  int depth = 0, left = 0;
+
+  for (int i = 0; i < set->num_inline; i++) {
+    if (set->compare(set->inline_values[i], value) == 0) {
+      memmove(&set->inline_values[i],
+              &set->inline_values[i + 1],
+              sizeof(void *) * (set->num_inline - i - 1));
+      set->num_inline--;
+      return;
+    }
+  }
+  node = descend(set, value, path, &depth, &left);
+  if (node != NULL) {
+    minimalist_rb_remove(&set->root, path, depth);
+    minimalist_slab_release(&set->nodes, node);
+  }
 }
 
 static void
 set_node_run(struct set_node *node, minimalist_set_run_fn run, void *context) {
   // Run left-to-right
-  if (node->left != NULL) {
-    set_node_run(node->left, run, context);
+  if (left_of(node) != NULL) {
+    set_node_run(left_of(node), run, context);
   }
   run(context, node->value);
-  if (node->right != NULL) {
-    set_node_run(node->right, run, context);
+  if (right_of(node) != NULL) {
+    set_node_run(right_of(node), run, context);
   }
 }
 
@@ -214,5 +231,27 @@ minimalist_set_run(struct minimalist_set *set,
                    minimalist_set_run_fn run,
                    void *context) {
   assert(run);
-  set_node_run(set->root, run, context);
+  for (int i = 0; i < set->num_inline; i++) {
+    run(context, set->inline_values[i]);
+  }
+  if (set->root) {
+    set_node_run((struct set_node *)set->root, run, context);
+  }
+}
+
+static void
+run_add_filter(void *context, const void *value) {
+  struct minimalist_set *set = context;
+  minimalist_bloom_filter_add_hash(set->filter, set->hash(value));
+}
+
+void
+minimalist_set_attach_filter(struct minimalist_set *set,
+                             struct minimalist_bloom_filter *filter,
+                             minimalist_hash_fn hash) {
+  set->filter = hash ? filter : NULL;
+  set->hash = hash;
+  if (set->filter) {
+    minimalist_set_run(set, run_add_filter, set);
+  }
 }
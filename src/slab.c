@@ -0,0 +1,73 @@
+#include "slab.h"
+
+#include <stdlib.h>
+
+/* Objects in the first chunk, doubling up to the maximum */
+#define MIN_CHUNK_OBJECTS 32
+#define MAX_CHUNK_OBJECTS 4096
+
+/* Each chunk starts with a link to the previous chunk */
+struct chunk {
+  struct chunk *previous;
+};
+
+void
+minimalist_slab_init(struct minimalist_slab *slab, size_t object_size) {
+  if (object_size < sizeof(void *)) {
+    object_size = sizeof(void *);
+  }
+  slab->object_size =
+      (object_size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+  slab->chunk_objects = MIN_CHUNK_OBJECTS;
+  slab->chunks = NULL;
+  slab->next = NULL;
+  slab->remaining = 0;
+  slab->released = NULL;
+}
+
+void
+minimalist_slab_destroy(struct minimalist_slab *slab) {
+  struct chunk *chunk = slab->chunks, *previous = NULL;
+  while (chunk != NULL) {
+    previous = chunk->previous;
+    free(chunk);
+    chunk = previous;
+  }
+  minimalist_slab_init(slab, slab->object_size);
+}
+
+void *
+minimalist_slab_alloc(struct minimalist_slab *slab) {
+  struct chunk *chunk = NULL;
+  void *object = NULL;
+
+  if (slab->released != NULL) {
+    object = slab->released;
+    slab->released = *(void **)object;
+    return object;
+  }
+  if (slab->remaining == 0) {
+    chunk =
+        malloc(sizeof(struct chunk) + slab->object_size * slab->chunk_objects);
+    if (chunk == NULL) {
+      return NULL;
+    }
+    chunk->previous = slab->chunks;
+    slab->chunks = chunk;
+    slab->next = (char *)(chunk + 1);
+    slab->remaining = slab->chunk_objects;
+    if (slab->chunk_objects < MAX_CHUNK_OBJECTS) {
+      slab->chunk_objects *= 2;
+    }
+  }
+  object = slab->next;
+  slab->next += slab->object_size;
+  slab->remaining--;
+  return object;
+}
+
+void
+minimalist_slab_release(struct minimalist_slab *slab, void *object) {
+  *(void **)object = slab->released;
+  slab->released = object;
+}
@@ -0,0 +1,28 @@
+#ifndef __MINIMALIST_SLAB_H__
+#define __MINIMALIST_SLAB_H__
+/*
+ * A pool of fixed-size objects carved out of large chunks, so objects carry
+ * no malloc header. Released objects are reused before new ones are carved.
+ * Objects are aligned to a pointer and live until the slab is destroyed.
+ */
+
+#include <stddef.h>
+
+struct minimalist_slab {
+  size_t object_size;
+  size_t chunk_objects;
+  void *chunks;
+  char *next;
+  size_t remaining;
+  void *released;
+};
+
+void minimalist_slab_init(struct minimalist_slab *slab, size_t object_size);
+
+void minimalist_slab_destroy(struct minimalist_slab *slab);
+
+void *minimalist_slab_alloc(struct minimalist_slab *slab);
+
+void minimalist_slab_release(struct minimalist_slab *slab, void *object);
+
+#endif /* __MINIMALIST_SLAB_H__ */
@@ -0,0 +1,493 @@
+#include "minimalist/snapshot.h"
+
+#include "minimalist/hash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "MINSNAP1"
+
+enum snapshot_kind { SNAPSHOT_HASHED = 1, SNAPSHOT_SORTED = 2 };
+
+/*
+ * File layout, with absolute offsets:
+ *
+ *   header | records[count] | slots[num_slots] | key and value bytes
+ *
+ * Hashed snapshots index records through an open-addressing table of slots
+ * using linear probing. Sorted snapshots have no slots and keep records in
+ * key byte order for binary search.
+ */
+struct snapshot_header {
+  char magic[8];
+  uint32_t kind;
+  uint32_t reserved;
+  uint64_t count;
+  uint64_t num_slots;
+  uint64_t records_offset;
+  uint64_t slots_offset;
+  uint64_t data_offset;
+  uint64_t file_size;
+};
+
+struct snapshot_record {
+  uint64_t key_offset;
+  uint64_t key_len;
+  uint64_t value_offset;
+  uint64_t value_len;
+};
+
+struct snapshot_slot {
+  uint32_t tag;
+  uint32_t record; /* Record index plus one, zero when empty */
+};
+
+struct minimalist_snapshot {
+  const unsigned char *base;
+  size_t size;
+  enum snapshot_kind kind;
+  size_t count;
+  size_t num_slots;
+  unsigned int shift;
+  const struct snapshot_record *records;
+  const struct snapshot_slot *slots;
+};
+
+struct entry {
+  const void *key;
+  size_t key_len;
+  const void *value;
+  size_t value_len;
+};
+
+struct collect_context {
+  struct entry *entries;
+  size_t count;
+  size_t capacity;
+  minimalist_snapshot_size_fn key_size;
+  minimalist_snapshot_size_fn value_size;
+  int failed;
+};
+
+static void
+collect(struct collect_context *context, const void *key, const void *value) {
+  struct entry *entries = NULL;
+
+  if (context->failed) {
+    return;
+  }
+  if (context->count == context->capacity) {
+    context->capacity = context->capacity ? context->capacity * 2 : 64;
+    entries =
+        realloc(context->entries, sizeof(struct entry) * context->capacity);
+    if (entries == NULL) {
+      context->failed = 1;
+      return;
+    }
+    context->entries = entries;
+  }
+  entries = &context->entries[context->count++];
+  entries->key = key;
+  entries->key_len = context->key_size(key);
+  /* NULL values are stored like empty ones */
+  entries->value = value;
+  entries->value_len = value ? context->value_size(value) : 0;
+}
+
+static void
+run_collect(void *context, const void *key, void *value) {
+  collect(context, key, value);
+}
+
+static int
+compare_bytes(const void *a, size_t a_len, const void *b, size_t b_len) {
+  int comparison = memcmp(a, b, a_len < b_len ? a_len : b_len);
+  if (comparison == 0 && a_len != b_len) {
+    comparison = a_len < b_len ? -1 : 1;
+  }
+  return comparison;
+}
+
+static int
+compare_entries(const void *a, const void *b) {
+  const struct entry *entry_a = a, *entry_b = b;
+  return compare_bytes(
+      entry_a->key, entry_a->key_len, entry_b->key, entry_b->key_len);
+}
+
+static unsigned int
+slot_shift(size_t num_slots) {
+  unsigned int shift = 64;
+  while (num_slots > 1) {
+    num_slots >>= 1;
+    shift--;
+  }
+  return shift;
+}
+
+static size_t
+slot_index(unsigned int shift, uint64_t hash) {
+  return shift == 64 ? 0 : (size_t)(hash >> shift);
+}
+
+static int
+write_all(FILE *file, const void *data, size_t size) {
+  return size == 0 || fwrite(data, size, 1, file) == 1 ? 0 : -1;
+}
+
+static int
+write_snapshot(const char *path,
+               enum snapshot_kind kind,
+               struct entry *entries,
+               size_t count) {
+  struct snapshot_header header;
+  struct snapshot_record record;
+  struct snapshot_slot *slots = NULL;
+  static const char padding[8];
+  uint64_t offset = 0, data_size = 0;
+  size_t num_slots = 0;
+  unsigned int shift = 64;
+  FILE *file = NULL;
+  int ret = -1;
+
+  if (kind == SNAPSHOT_HASHED) {
+    num_slots = 2;
+    while (num_slots < count * 2) {
+      num_slots <<= 1;
+    }
+    shift = slot_shift(num_slots);
+    slots = calloc(num_slots, sizeof(struct snapshot_slot));
+    if (slots == NULL) {
+      goto err;
+    }
+    for (size_t i = 0; i < count; i++) {
+      uint64_t hash =
+          minimalist_hash_bytes(entries[i].key, entries[i].key_len, 0);
+      size_t index = slot_index(shift, hash);
+      while (slots[index].record != 0) {
+        index = (index + 1) & (num_slots - 1);
+      }
+      slots[index].tag = (uint32_t)hash;
+      slots[index].record = (uint32_t)(i + 1);
+    }
+  } else {
+    qsort(entries, count, sizeof(struct entry), compare_entries);
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.kind = kind;
+  header.count = count;
+  header.num_slots = num_slots;
+  header.records_offset = sizeof(header);
+  header.slots_offset =
+      header.records_offset + count * sizeof(struct snapshot_record);
+  header.data_offset =
+      header.slots_offset + num_slots * sizeof(struct snapshot_slot);
+  data_size = 0;
+  for (size_t i = 0; i < count; i++) {
+    data_size += entries[i].key_len + entries[i].value_len;
+  }
+  /* Keep the mapping a whole number of words long */
+  header.file_size = (header.data_offset + data_size + 7) & ~(uint64_t)7;
+
+  file = fopen(path, "wb");
+  if (file == NULL) {
+    goto err;
+  }
+  if (write_all(file, &header, sizeof(header)) != 0) {
+    goto err;
+  }
+  offset = header.data_offset;
+  for (size_t i = 0; i < count; i++) {
+    record.key_offset = offset;
+    record.key_len = entries[i].key_len;
+    offset += entries[i].key_len;
+    record.value_offset = offset;
+    record.value_len = entries[i].value_len;
+    offset += entries[i].value_len;
+    if (write_all(file, &record, sizeof(record)) != 0) {
+      goto err;
+    }
+  }
+  if (write_all(file, slots, num_slots * sizeof(struct snapshot_slot)) != 0) {
+    goto err;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (write_all(file, entries[i].key, entries[i].key_len) != 0 ||
+        write_all(file, entries[i].value, entries[i].value_len) != 0) {
+      goto err;
+    }
+  }
+  if (write_all(file,
+                padding,
+                header.file_size - header.data_offset - data_size) != 0) {
+    goto err;
+  }
+  ret = 0;
+err:
+  if (file != NULL && fclose(file) != 0) {
+    ret = -1;
+  }
+  free(slots);
+  return ret;
+}
+
+int
+minimalist_hash_map_save(struct minimalist_hash_map *map,
+                         const char *path,
+                         minimalist_snapshot_size_fn key_size,
+                         minimalist_snapshot_size_fn value_size) {
+  struct collect_context context = {NULL, 0, 0, key_size, value_size, 0};
+  int ret = -1;
+
+  minimalist_hash_map_run(map, run_collect, &context);
+  if (context.failed) {
+    errno = ENOMEM;
+  } else if (context.count >= UINT32_MAX) {
+    errno = EFBIG;
+  } else {
+    ret = write_snapshot(
+        path, SNAPSHOT_HASHED, context.entries, context.count);
+  }
+  free(context.entries);
+  return ret;
+}
+
+int
+minimalist_map_save(struct minimalist_map *map,
+                    const char *path,
+                    minimalist_snapshot_size_fn key_size,
+                    minimalist_snapshot_size_fn value_size) {
+  struct collect_context context = {NULL, 0, 0, key_size, value_size, 0};
+  int ret = -1;
+
+  minimalist_map_run(map, run_collect, &context);
+  if (context.failed) {
+    errno = ENOMEM;
+  } else {
+    ret = write_snapshot(
+        path, SNAPSHOT_SORTED, context.entries, context.count);
+  }
+  free(context.entries);
+  return ret;
+}
+
+/* Checks the sections tile the file exactly before sizing any of them */
+static int
+header_valid(const struct snapshot_header *header,
+             uint64_t size,
+             enum snapshot_kind kind) {
+  uint64_t records_size = 0, slots_size = 0;
+
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->kind != kind || header->file_size != size ||
+      header->records_offset != sizeof(struct snapshot_header) ||
+      header->slots_offset < header->records_offset ||
+      header->data_offset < header->slots_offset ||
+      header->file_size < header->data_offset) {
+    return 0;
+  }
+  records_size = header->slots_offset - header->records_offset;
+  slots_size = header->data_offset - header->slots_offset;
+  if (header->count != records_size / sizeof(struct snapshot_record) ||
+      records_size % sizeof(struct snapshot_record) != 0 ||
+      header->num_slots != slots_size / sizeof(struct snapshot_slot) ||
+      slots_size % sizeof(struct snapshot_slot) != 0) {
+    return 0;
+  }
+  if (kind == SNAPSHOT_HASHED) {
+    return header->num_slots > header->count &&
+           (header->num_slots & (header->num_slots - 1)) == 0;
+  }
+  return header->num_slots == 0;
+}
+
+static struct minimalist_snapshot *
+open_snapshot(const char *path, enum snapshot_kind kind) {
+  struct minimalist_snapshot *snapshot = NULL;
+  struct snapshot_header header;
+  struct stat st;
+  void *base = MAP_FAILED;
+  int fd = -1;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    goto err;
+  }
+  if ((uint64_t)st.st_size < sizeof(header)) {
+    errno = EINVAL;
+    goto err;
+  }
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (base == MAP_FAILED) {
+    goto err;
+  }
+  memcpy(&header, base, sizeof(header));
+  if (!header_valid(&header, st.st_size, kind)) {
+    errno = EINVAL;
+    goto err;
+  }
+
+  snapshot = malloc(sizeof(struct minimalist_snapshot));
+  if (snapshot == NULL) {
+    goto err;
+  }
+  snapshot->base = base;
+  snapshot->size = st.st_size;
+  snapshot->kind = kind;
+  snapshot->count = header.count;
+  snapshot->num_slots = header.num_slots;
+  snapshot->shift = slot_shift(header.num_slots);
+  snapshot->records =
+      (const struct snapshot_record *)(snapshot->base + header.records_offset);
+  snapshot->slots =
+      (const struct snapshot_slot *)(snapshot->base + header.slots_offset);
+  close(fd);
+  return snapshot;
+err:
+  if (base != MAP_FAILED) {
+    munmap(base, st.st_size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  return NULL;
+}
+
+struct minimalist_snapshot *
+minimalist_hash_map_open_mmap(const char *path) {
+  return open_snapshot(path, SNAPSHOT_HASHED);
+}
+
+struct minimalist_snapshot *
+minimalist_map_open_mmap(const char *path) {
+  return open_snapshot(path, SNAPSHOT_SORTED);
+}
+
+void
+minimalist_snapshot_close(struct minimalist_snapshot *snapshot) {
+  if (snapshot) {
+    munmap((void *)snapshot->base, snapshot->size);
+    free(snapshot);
+  }
+}
+
+/*
+ * Records are validated when they are touched rather than when the file is
+ * opened, so opening a snapshot never faults in the whole file.
+ */
+static int
+record_valid(struct minimalist_snapshot *snapshot,
+             const struct snapshot_record *record) {
+  return record->key_offset <= snapshot->size &&
+         record->key_len <= snapshot->size - record->key_offset &&
+         record->value_offset <= snapshot->size &&
+         record->value_len <= snapshot->size - record->value_offset;
+}
+
+static const void *
+record_value(struct minimalist_snapshot *snapshot,
+             const struct snapshot_record *record,
+             size_t *value_len) {
+  if (value_len) {
+    *value_len = record->value_len;
+  }
+  return snapshot->base + record->value_offset;
+}
+
+static const void *
+get_hashed(struct minimalist_snapshot *snapshot,
+           const void *key,
+           size_t key_len,
+           size_t *value_len) {
+  uint64_t hash = minimalist_hash_bytes(key, key_len, 0);
+  size_t mask = snapshot->num_slots - 1;
+  size_t index = slot_index(snapshot->shift, hash);
+
+  for (size_t probes = 0; probes < snapshot->num_slots; probes++) {
+    const struct snapshot_slot *slot = &snapshot->slots[index];
+    if (slot->record == 0 || slot->record > snapshot->count) {
+      break;
+    }
+    if (slot->tag == (uint32_t)hash) {
+      const struct snapshot_record *record =
+          &snapshot->records[slot->record - 1];
+      if (record_valid(snapshot, record) && record->key_len == key_len &&
+          memcmp(snapshot->base + record->key_offset, key, key_len) == 0) {
+        return record_value(snapshot, record, value_len);
+      }
+    }
+    index = (index + 1) & mask;
+  }
+  return NULL;
+}
+
+static const void *
+get_sorted(struct minimalist_snapshot *snapshot,
+           const void *key,
+           size_t key_len,
+           size_t *value_len) {
+  size_t low = 0, high = snapshot->count;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    const struct snapshot_record *record = &snapshot->records[middle];
+    int comparison = 0;
+    if (!record_valid(snapshot, record)) {
+      break;
+    }
+    comparison = compare_bytes(
+        snapshot->base + record->key_offset, record->key_len, key, key_len);
+    if (comparison < 0) {
+      low = middle + 1;
+    } else if (comparison > 0) {
+      high = middle;
+    } else {
+      return record_value(snapshot, record, value_len);
+    }
+  }
+  return NULL;
+}
+
+const void *
+minimalist_snapshot_get(struct minimalist_snapshot *snapshot,
+                        const void *key,
+                        size_t key_len,
+                        size_t *value_len) {
+  if (snapshot->kind == SNAPSHOT_HASHED) {
+    return get_hashed(snapshot, key, key_len, value_len);
+  } else {
+    return get_sorted(snapshot, key, key_len, value_len);
+  }
+}
+
+size_t
+minimalist_snapshot_count(struct minimalist_snapshot *snapshot) {
+  return snapshot->count;
+}
+
+void
+minimalist_snapshot_run(struct minimalist_snapshot *snapshot,
+                        minimalist_snapshot_run_fn run,
+                        void *context) {
+  if (run) {
+    for (size_t i = 0; i < snapshot->count; i++) {
+      const struct snapshot_record *record = &snapshot->records[i];
+      if (record_valid(snapshot, record)) {
+        run(context,
+            snapshot->base + record->key_offset,
+            record->key_len,
+            snapshot->base + record->value_offset,
+            record->value_len);
+      }
+    }
+  }
+}
@@ -0,0 +1,430 @@
+#include "minimalist/static_map.h"
+
+#include "minimalist/hash.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STATIC_MAP_MAGIC "MINSMAP1"
+
+/* Average keys per bucket, trading pilot space for build time */
+#define BUCKET_SIZE 4
+
+/* Seeds tried before giving up on keys whose hashes collide */
+#define MAX_SEEDS 16
+
+/*
+ * Blob layout, with offsets from the start of the blob:
+ *
+ *   header and pilots[num_buckets] | slots[num_entries] | key and value bytes
+ *
+ * A slot's value bytes follow its key bytes. The blob size is a multiple of
+ * 8 bytes.
+ */
+struct minimalist_static_map {
+  char magic[8];
+  uint64_t seed;
+  uint64_t num_entries;
+  uint64_t num_buckets;
+  uint64_t slots_offset;
+  uint64_t data_offset;
+  uint64_t size;
+  uint32_t pilots[];
+};
+
+struct static_slot {
+  uint64_t offset;
+  uint32_t key_len;
+  uint32_t value_len;
+};
+
+struct build_key {
+  uint64_t hash;
+  size_t index;
+};
+
+/* Maps x onto [0, n) by the high half of x * n, with no division */
+static uint64_t
+reduce(uint64_t x, uint64_t n) {
+#ifdef __SIZEOF_INT128__
+  return (uint64_t)(((unsigned __int128)x * n) >> 64);
+#else
+  uint64_t x_lo = (uint32_t)x, x_hi = x >> 32;
+  uint64_t n_lo = (uint32_t)n, n_hi = n >> 32;
+  uint64_t lo_lo = x_lo * n_lo, hi_lo = x_hi * n_lo;
+  uint64_t lo_hi = x_lo * n_hi, hi_hi = x_hi * n_hi;
+  uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+  return hi_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+/*
+ * Keys of a bucket share the high bits of their hash, so the slot comes
+ * from mixing the hash again, offset by the pilot.
+ */
+static uint64_t
+slot_of(uint64_t hash, uint32_t pilot, uint64_t num_entries) {
+  return reduce(minimalist_hash_u64(hash + pilot), num_entries);
+}
+
+static const struct static_slot *
+slots_of(const struct minimalist_static_map *map) {
+  return (const struct static_slot *)((const char *)map + map->slots_offset);
+}
+
+static int
+compare_build_keys(const void *a, const void *b) {
+  const struct build_key *key_a = a, *key_b = b;
+  return (key_a->hash > key_b->hash) - (key_a->hash < key_b->hash);
+}
+
+/*
+ * Finds a pilot for every bucket, largest buckets first while most slots are
+ * free. keys are sorted by hash, so each bucket is a run of them. Returns 0
+ * if some bucket has two keys of the same hash or no pilot fits, or -1 on
+ * allocation failure.
+ */
+static int
+find_pilots(struct minimalist_static_map *map,
+            const struct build_key *keys,
+            size_t *starts,
+            size_t *order,
+            unsigned char *taken,
+            uint64_t *positions) {
+  size_t n = map->num_entries, buckets = map->num_buckets;
+  size_t max_size = 0, size = 0, at = 0, *counts = NULL;
+  uint64_t hash = 0, position = 0;
+  size_t bucket = 0, placed = 0;
+
+  for (size_t i = 0, b = 0; b <= buckets; b++) {
+    while (i < n && reduce(keys[i].hash, buckets) < b) {
+      i++;
+    }
+    starts[b] = i;
+  }
+  for (size_t b = 0; b < buckets; b++) {
+    size = starts[b + 1] - starts[b];
+    if (size > max_size) {
+      max_size = size;
+    }
+    for (size_t i = starts[b] + 1; i < starts[b + 1]; i++) {
+      if (keys[i].hash == keys[i - 1].hash) {
+        return 0;
+      }
+    }
+  }
+
+  /* Counting sort of the buckets by decreasing size */
+  counts = calloc(max_size + 2, sizeof(size_t));
+  if (counts == NULL) {
+    return -1;
+  }
+  for (size_t b = 0; b < buckets; b++) {
+    counts[max_size - (starts[b + 1] - starts[b]) + 1]++;
+  }
+  for (size_t s = 1; s <= max_size + 1; s++) {
+    counts[s] += counts[s - 1];
+  }
+  for (size_t b = 0; b < buckets; b++) {
+    order[counts[max_size - (starts[b + 1] - starts[b])]++] = b;
+  }
+  free(counts);
+
+  memset(taken, 0, n);
+  for (size_t o = 0; o < buckets; o++) {
+    bucket = order[o];
+    size = starts[bucket + 1] - starts[bucket];
+    map->pilots[bucket] = 0;
+    for (uint32_t pilot = 0; size > 0; pilot++) {
+      if (pilot == UINT32_MAX) {
+        return 0;
+      }
+      for (placed = 0; placed < size; placed++) {
+        hash = keys[starts[bucket] + placed].hash;
+        position = slot_of(hash, pilot, n);
+        if (taken[position]) {
+          break;
+        }
+        taken[position] = 1;
+        positions[placed] = position;
+      }
+      if (placed == size) {
+        map->pilots[bucket] = pilot;
+        break;
+      }
+      for (at = 0; at < placed; at++) {
+        taken[positions[at]] = 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/* Tells keys with the same hash apart, which a new seed may separate */
+static int
+has_duplicates(const struct build_key *keys,
+               size_t n,
+               const void *const *key_data,
+               minimalist_static_map_size_fn key_size) {
+  size_t len = 0;
+  for (size_t i = 1; i < n; i++) {
+    if (keys[i].hash == keys[i - 1].hash) {
+      len = key_size(key_data[keys[i].index]);
+      if (len == key_size(key_data[keys[i - 1].index]) &&
+          memcmp(key_data[keys[i].index],
+                 key_data[keys[i - 1].index],
+                 len) == 0) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+struct minimalist_static_map *
+minimalist_static_map_new(const void *const *keys,
+                          const void *const *values,
+                          size_t n,
+                          minimalist_static_map_size_fn key_size,
+                          minimalist_static_map_size_fn value_size) {
+  struct minimalist_static_map *map = NULL;
+  struct static_slot *slots = NULL;
+  struct build_key *build_keys = NULL;
+  size_t buckets = n / BUCKET_SIZE + 1, data_size = 0, pilots_end = 0;
+  size_t key_len = 0, value_len = 0, *starts = NULL, *order = NULL;
+  size_t slots_offset = 0, data_offset = 0, size = 0, offset = 0;
+  unsigned char *taken = NULL;
+  uint64_t *positions = NULL, slot = 0;
+  int found = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    key_len = key_size(keys[i]);
+    value_len = value_size(values[i]);
+    if (key_len > UINT32_MAX || value_len > UINT32_MAX) {
+      errno = EFBIG;
+      return NULL;
+    }
+    data_size += key_len + value_len;
+  }
+  pilots_end =
+      sizeof(struct minimalist_static_map) + sizeof(uint32_t) * buckets;
+  slots_offset = (pilots_end + 7) & ~(size_t)7;
+  data_offset = slots_offset + sizeof(struct static_slot) * n;
+  size = (data_offset + data_size + 7) & ~(size_t)7;
+
+  map = calloc(1, size);
+  build_keys = malloc(sizeof(struct build_key) * (n + 1));
+  starts = malloc(sizeof(size_t) * (buckets + 1));
+  order = malloc(sizeof(size_t) * buckets);
+  taken = malloc(n + 1);
+  positions = malloc(sizeof(uint64_t) * (n + 1));
+  if (map == NULL || build_keys == NULL || starts == NULL || order == NULL ||
+      taken == NULL || positions == NULL) {
+    errno = ENOMEM;
+    goto err;
+  }
+  memcpy(map->magic, STATIC_MAP_MAGIC, sizeof(map->magic));
+  map->num_entries = n;
+  map->num_buckets = buckets;
+  map->slots_offset = slots_offset;
+  map->data_offset = data_offset;
+  map->size = size;
+
+  for (uint64_t attempt = 0; attempt < MAX_SEEDS && !found; attempt++) {
+    map->seed = minimalist_hash_u64(attempt);
+    for (size_t i = 0; i < n; i++) {
+      build_keys[i].hash =
+          minimalist_hash_bytes(keys[i], key_size(keys[i]), map->seed);
+      build_keys[i].index = i;
+    }
+    qsort(build_keys, n, sizeof(struct build_key), compare_build_keys);
+    if (has_duplicates(build_keys, n, keys, key_size)) {
+      errno = EINVAL;
+      goto err;
+    }
+    found = find_pilots(map, build_keys, starts, order, taken, positions);
+    if (found < 0) {
+      errno = ENOMEM;
+      goto err;
+    }
+  }
+  if (!found) {
+    /* Distinct keys that still collide under every seed */
+    errno = ERANGE;
+    goto err;
+  }
+
+  /* Copy each entry into the slot its hash leads to */
+  slots = (struct static_slot *)((char *)map + slots_offset);
+  offset = data_offset;
+  for (size_t i = 0; i < n; i++) {
+    slot = slot_of(build_keys[i].hash,
+                   map->pilots[reduce(build_keys[i].hash, buckets)],
+                   n);
+    key_len = key_size(keys[build_keys[i].index]);
+    value_len = value_size(values[build_keys[i].index]);
+    slots[slot].offset = offset;
+    slots[slot].key_len = (uint32_t)key_len;
+    slots[slot].value_len = (uint32_t)value_len;
+    memcpy((char *)map + offset, keys[build_keys[i].index], key_len);
+    memcpy((char *)map + offset + key_len,
+           values[build_keys[i].index],
+           value_len);
+    offset += key_len + value_len;
+  }
+  goto out;
+
+err:
+  free(map);
+  map = NULL;
+out:
+  free(build_keys);
+  free(starts);
+  free(order);
+  free(taken);
+  free(positions);
+  return map;
+}
+
+void
+minimalist_static_map_free(struct minimalist_static_map *map) {
+  free(map);
+}
+
+const void *
+minimalist_static_map_get(const struct minimalist_static_map *map,
+                          const void *key,
+                          size_t key_len,
+                          size_t *value_len) {
+  const struct static_slot *slot = NULL;
+  const char *data = NULL;
+  uint64_t hash = 0;
+
+  if (map->num_entries == 0) {
+    return NULL;
+  }
+  hash = minimalist_hash_bytes(key, key_len, map->seed);
+  slot = &slots_of(map)[slot_of(
+      hash, map->pilots[reduce(hash, map->num_buckets)], map->num_entries)];
+  data = (const char *)map + slot->offset;
+  if (slot->key_len != key_len || memcmp(data, key, key_len) != 0) {
+    return NULL;
+  }
+  if (value_len) {
+    *value_len = slot->value_len;
+  }
+  return data + key_len;
+}
+
+size_t
+minimalist_static_map_size(const struct minimalist_static_map *map) {
+  return map->num_entries;
+}
+
+const void *
+minimalist_static_map_blob(const struct minimalist_static_map *map,
+                           size_t *size) {
+  *size = map->size;
+  return map;
+}
+
+const struct minimalist_static_map *
+minimalist_static_map_open(const void *blob, size_t size) {
+  const struct minimalist_static_map *map = blob;
+  const struct static_slot *slots = NULL;
+  uint64_t n = 0, end = 0;
+
+  if ((uintptr_t)blob % 8 != 0 ||
+      size < sizeof(struct minimalist_static_map) ||
+      memcmp(map->magic, STATIC_MAP_MAGIC, sizeof(map->magic)) != 0 ||
+      map->size != size) {
+    goto invalid;
+  }
+  n = map->num_entries;
+  if (map->num_buckets > size / sizeof(uint32_t) ||
+      (n > 0 && map->num_buckets == 0) || map->slots_offset % 8 != 0 ||
+      map->slots_offset < sizeof(struct minimalist_static_map) +
+                              sizeof(uint32_t) * map->num_buckets ||
+      map->slots_offset > size ||
+      n > (size - map->slots_offset) / sizeof(struct static_slot) ||
+      map->data_offset != map->slots_offset + n * sizeof(struct static_slot)) {
+    goto invalid;
+  }
+  slots = slots_of(map);
+  for (uint64_t i = 0; i < n; i++) {
+    end = slots[i].offset + slots[i].key_len + slots[i].value_len;
+    if (slots[i].offset < map->data_offset || slots[i].offset > size ||
+        end > size) {
+      goto invalid;
+    }
+  }
+  return map;
+
+invalid:
+  errno = EINVAL;
+  return NULL;
+}
+
+static int
+valid_identifier(const char *name) {
+  if (!((*name >= 'a' && *name <= 'z') || (*name >= 'A' && *name <= 'Z') ||
+        *name == '_')) {
+    return 0;
+  }
+  for (name++; *name; name++) {
+    if (!((*name >= 'a' && *name <= 'z') || (*name >= 'A' && *name <= 'Z') ||
+          (*name >= '0' && *name <= '9') || *name == '_')) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int
+minimalist_static_map_write_c(const struct minimalist_static_map *map,
+                              const char *path,
+                              const char *name) {
+  const uint64_t *words = (const uint64_t *)map;
+  size_t num_words = map->size / sizeof(uint64_t);
+  FILE *file = NULL;
+  int failed = 0;
+
+  if (!valid_identifier(name)) {
+    errno = EINVAL;
+    return -1;
+  }
+  file = fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+  fprintf(file,
+          "/* Generated by minimalist_static_map_write_c(). Do not edit. */\n"
+          "#include <minimalist/static_map.h>\n"
+          "\n"
+          "#include <stdint.h>\n"
+          "\n"
+          "static const uint64_t %s_blob[%zu] = {",
+          name,
+          num_words);
+  for (size_t i = 0; i < num_words; i++) {
+    fprintf(file,
+            "%s0x%016llxull,",
+            i % 3 == 0 ? "\n    " : " ",
+            (unsigned long long)words[i]);
+  }
+  fprintf(file,
+          "\n};\n"
+          "\n"
+          "const struct minimalist_static_map *const %s =\n"
+          "    (const struct minimalist_static_map *)%s_blob;\n",
+          name,
+          name);
+  failed = ferror(file);
+  if (fclose(file) != 0 || failed) {
+    return -1;
+  }
+  return 0;
+}
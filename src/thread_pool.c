@@ -0,0 +1,257 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Ranges on a deque halve in size from top to bottom, and a worker only
+ * steals into an empty deque, so one range per bit of size_t is enough.
+ */
+#define MAX_RANGES (sizeof(size_t) * 8 + 1)
+
+struct pool_range {
+  size_t begin;
+  size_t end;
+};
+
+struct pool_worker {
+  struct minimalist_thread_pool *pool;
+  unsigned int index;
+  pthread_t thread;
+  uint64_t random;
+  pthread_mutex_t lock;
+  size_t top;
+  size_t bottom;
+  struct pool_range ranges[MAX_RANGES];
+};
+
+struct minimalist_thread_pool {
+  unsigned int num_workers;
+  struct pool_worker *workers;
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  uint64_t generation;
+  unsigned int running;
+  int stopping;
+  /* The loop being run */
+  minimalist_thread_pool_fn fn;
+  void *context;
+  size_t grain;
+  atomic_size_t remaining;
+};
+
+static void
+push(struct pool_worker *worker, size_t begin, size_t end) {
+  pthread_mutex_lock(&worker->lock);
+  if (worker->top == worker->bottom) {
+    worker->top = worker->bottom = 0;
+  }
+  worker->ranges[worker->bottom].begin = begin;
+  worker->ranges[worker->bottom].end = end;
+  worker->bottom++;
+  pthread_mutex_unlock(&worker->lock);
+}
+
+/* Takes the newest range off the bottom of the worker's own deque */
+static int
+pop(struct pool_worker *worker, struct pool_range *range) {
+  int found = 0;
+  pthread_mutex_lock(&worker->lock);
+  if (worker->bottom > worker->top) {
+    *range = worker->ranges[--worker->bottom];
+    found = 1;
+  }
+  pthread_mutex_unlock(&worker->lock);
+  return found;
+}
+
+/* Takes the oldest, and so largest, range off the top of another deque */
+static int
+steal(struct pool_worker *worker, struct pool_range *range) {
+  struct minimalist_thread_pool *pool = worker->pool;
+  struct pool_worker *victim = NULL;
+  unsigned int first = 0;
+  int found = 0;
+
+  worker->random ^= worker->random << 13;
+  worker->random ^= worker->random >> 7;
+  worker->random ^= worker->random << 17;
+  first = (unsigned int)(worker->random % pool->num_workers);
+  for (unsigned int i = 0; i < pool->num_workers && !found; i++) {
+    victim = &pool->workers[(first + i) % pool->num_workers];
+    if (victim == worker) {
+      continue;
+    }
+    pthread_mutex_lock(&victim->lock);
+    if (victim->bottom > victim->top) {
+      *range = victim->ranges[victim->top++];
+      found = 1;
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+  return found;
+}
+
+static void
+run_loop(struct pool_worker *worker) {
+  struct minimalist_thread_pool *pool = worker->pool;
+  struct pool_range range;
+  size_t middle = 0;
+
+  while (atomic_load(&pool->remaining) > 0) {
+    if (!pop(worker, &range) && !steal(worker, &range)) {
+      sched_yield();
+      continue;
+    }
+    while (range.end - range.begin > pool->grain) {
+      middle = range.begin + (range.end - range.begin) / 2;
+      push(worker, middle, range.end);
+      range.end = middle;
+    }
+    pool->fn(pool->context, worker->index, range.begin, range.end);
+    atomic_fetch_sub(&pool->remaining, range.end - range.begin);
+  }
+}
+
+static void *
+worker_main(void *context) {
+  struct pool_worker *worker = context;
+  struct minimalist_thread_pool *pool = worker->pool;
+  uint64_t generation = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stopping && pool->generation == generation) {
+      pthread_cond_wait(&pool->start, &pool->lock);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    generation = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+    run_loop(worker);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->running == 0) {
+      pthread_cond_signal(&pool->done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+struct minimalist_thread_pool *
+minimalist_thread_pool_new(unsigned int threads) {
+  struct minimalist_thread_pool *pool = NULL;
+  struct pool_worker *worker = NULL;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (unsigned int)online : 1;
+  }
+#endif
+  if (threads == 0) {
+    threads = 1;
+  }
+  pool = calloc(1, sizeof(struct minimalist_thread_pool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->workers = calloc(threads, sizeof(struct pool_worker));
+  if (pool->workers == NULL) {
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  atomic_init(&pool->remaining, 0);
+  for (unsigned int i = 0; i < threads; i++) {
+    worker = &pool->workers[i];
+    worker->pool = pool;
+    worker->index = i;
+    worker->random = (i + 1) * 0x9e3779b97f4a7c15ull;
+    pthread_mutex_init(&worker->lock, NULL);
+    /* Run with the threads that could be started */
+    if (i > 0 &&
+        pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+      pthread_mutex_destroy(&worker->lock);
+      break;
+    }
+    pool->num_workers++;
+  }
+  return pool;
+}
+
+void
+minimalist_thread_pool_free(struct minimalist_thread_pool *pool) {
+  if (pool == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+  for (unsigned int i = 0; i < pool->num_workers; i++) {
+    if (i > 0) {
+      pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->workers[i].lock);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->start);
+  pthread_cond_destroy(&pool->done);
+  free(pool->workers);
+  free(pool);
+}
+
+unsigned int
+minimalist_thread_pool_size(struct minimalist_thread_pool *pool) {
+  return pool->num_workers;
+}
+
+void
+minimalist_thread_pool_for(struct minimalist_thread_pool *pool,
+                           size_t n,
+                           size_t grain,
+                           minimalist_thread_pool_fn fn,
+                           void *context) {
+  unsigned int workers = pool->num_workers;
+
+  if (n == 0) {
+    return;
+  }
+  pool->fn = fn;
+  pool->context = context;
+  pool->grain = grain > 0 ? grain : 1;
+  atomic_store(&pool->remaining, n);
+  /* Small loops aren't worth waking the other workers for */
+  if (n <= pool->grain || workers == 1) {
+    workers = 1;
+  }
+  for (unsigned int i = 0; i < workers; i++) {
+    if (n * i / workers < n * (i + 1) / workers) {
+      push(&pool->workers[i], n * i / workers, n * (i + 1) / workers);
+    }
+  }
+  if (workers > 1) {
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pool->running = workers - 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  run_loop(&pool->workers[0]);
+  if (workers > 1) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) {
+      pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
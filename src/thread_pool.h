@@ -0,0 +1,35 @@
+#ifndef __MINIMALIST_THREAD_POOL_H__
+#define __MINIMALIST_THREAD_POOL_H__
+/*
+ * A fork-join pool for loops over index ranges. Each worker splits its range
+ * in halves, keeping the upper halves on its own deque and running the lower
+ * ones, and steals the largest pending range of another worker once its own
+ * deque runs dry. The calling thread is worker 0.
+ */
+
+#include <stddef.h>
+
+struct minimalist_thread_pool;
+
+/* Runs one piece of a loop; worker identifies the thread, from 0 */
+typedef void (*minimalist_thread_pool_fn)(void *context,
+                                          unsigned int worker,
+                                          size_t begin,
+                                          size_t end);
+
+/* threads is 0 for one per online CPU. Returns NULL on allocation failure */
+struct minimalist_thread_pool *minimalist_thread_pool_new(unsigned int threads);
+
+void minimalist_thread_pool_free(struct minimalist_thread_pool *pool);
+
+/* Number of workers, which may be fewer than asked if threads failed */
+unsigned int minimalist_thread_pool_size(struct minimalist_thread_pool *pool);
+
+/* Runs fn over [0, n) in pieces of at most grain indices, and waits */
+void minimalist_thread_pool_for(struct minimalist_thread_pool *pool,
+                                size_t n,
+                                size_t grain,
+                                minimalist_thread_pool_fn fn,
+                                void *context);
+
+#endif /* __MINIMALIST_THREAD_POOL_H__ */
@@ -0,0 +1,140 @@
+#include <minimalist/art.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_KEYS 5000
+
+static char keys[NUM_KEYS][48];
+static int values[NUM_KEYS];
+
+static int run_count = 0;
+static char last_key[48];
+static size_t last_len = 0;
+
+static void run_fn(void *context,
+                   const void *key,
+                   size_t key_len,
+                   void *value) {
+  size_t common = key_len < last_len ? key_len : last_len;
+  int comparison = memcmp(last_key, key, common);
+  assert(run_count == 0 || comparison < 0 ||
+         (comparison == 0 && last_len < key_len));
+  memcpy(last_key, key, key_len);
+  last_len = key_len;
+  run_count++;
+}
+
+static void check(struct minimalist_art *art, int removed_every) {
+  for (int i = 0; i < NUM_KEYS; i++) {
+    int *value = minimalist_art_get(art, keys[i], strlen(keys[i]));
+    int present = removed_every == 0 || i % removed_every != 0;
+    assert(present ? value == &values[i] : value == NULL);
+  }
+}
+
+int main() {
+  struct minimalist_art *art = minimalist_art_new();
+  unsigned char a[8], b[8];
+  assert(art != NULL);
+
+  /*
+   * Keys share long prefixes, are prefixes of each other and fan out widely
+   * enough to reach every node type.
+   */
+  for (int i = 0; i < NUM_KEYS; i++) {
+    switch (i % 4) {
+    case 0:
+      sprintf(keys[i], "%d", i);
+      break;
+    case 1:
+      sprintf(keys[i], "https://example.com/a/very/long/path/%d", i);
+      break;
+    case 2:
+      sprintf(keys[i], "https://example.com/%x", i);
+      break;
+    default:
+      sprintf(keys[i], "%c%d", 'a' + i % 26, i / 3);
+      break;
+    }
+  }
+  for (int i = 0; i < NUM_KEYS; i++) {
+    minimalist_art_set(art, keys[i], strlen(keys[i]), &values[i]);
+  }
+  assert(minimalist_art_size(art) == NUM_KEYS);
+  check(art, 0);
+  assert(minimalist_art_get(art, "https://example.com/", 20) == NULL);
+  assert(minimalist_art_get(art, "", 0) == NULL);
+
+  minimalist_art_set(art, keys[7], strlen(keys[7]), &values[8]);
+  assert(minimalist_art_get(art, keys[7], strlen(keys[7])) == &values[8]);
+  minimalist_art_set(art, keys[7], strlen(keys[7]), &values[7]);
+  assert(minimalist_art_size(art) == NUM_KEYS);
+
+  minimalist_art_run(art, run_fn, NULL);
+  assert(run_count == NUM_KEYS);
+
+  run_count = 0;
+  minimalist_art_run_prefix(
+      art, "https://example.com/a/very/long/", 32, run_fn, NULL);
+  assert(run_count == NUM_KEYS / 4);
+  run_count = 0;
+  minimalist_art_run_prefix(
+      art, "https://example.com/a/very/x", 28, run_fn, NULL);
+  assert(run_count == 0);
+  run_count = 0;
+  minimalist_art_run_prefix(art, "z", 1, run_fn, NULL);
+  assert(run_count > 0);
+
+  for (int i = 0; i < NUM_KEYS; i += 3) {
+    assert(minimalist_art_remove(art, keys[i], strlen(keys[i])) == 1);
+  }
+  check(art, 3);
+  for (int i = 0; i < NUM_KEYS; i++) {
+    assert(minimalist_art_remove(art, keys[i], strlen(keys[i])) ==
+           (i % 3 != 0));
+  }
+  assert(minimalist_art_size(art) == 0);
+  check(art, 1);
+
+  /* Dense integer keys fill Node256 and shrink back as they are removed */
+  for (int i = 0; i < NUM_KEYS; i++) {
+    minimalist_art_key_u64(i, a);
+    minimalist_art_set(art, a, 8, &values[i]);
+  }
+  for (int i = 0; i < NUM_KEYS; i += 2) {
+    minimalist_art_key_u64(i, a);
+    minimalist_art_remove(art, a, 8);
+  }
+  for (int i = 0; i < NUM_KEYS; i++) {
+    minimalist_art_key_u64(i, a);
+    assert(minimalist_art_get(art, a, 8) == (i % 2 ? &values[i] : NULL));
+    assert(minimalist_art_contains(art, a, 8) == i % 2);
+    minimalist_art_remove(art, a, 8);
+  }
+  assert(minimalist_art_size(art) == 0);
+
+  minimalist_art_key_u64(255, a);
+  minimalist_art_key_u64(256, b);
+  assert(memcmp(a, b, 8) < 0);
+  minimalist_art_set(art, a, 8, &values[0]);
+  minimalist_art_set(art, b, 8, &values[1]);
+  assert(minimalist_art_get(art, a, 8) == &values[0]);
+  assert(minimalist_art_get(art, b, 8) == &values[1]);
+
+  /* NULL values are stored, not removed */
+  minimalist_art_set(art, a, 8, NULL);
+  assert(minimalist_art_size(art) == 2);
+  assert(minimalist_art_get(art, a, 8) == NULL);
+  assert(minimalist_art_contains(art, a, 8));
+  assert(minimalist_art_remove(art, a, 8) == 1);
+  assert(!minimalist_art_contains(art, a, 8));
+  assert(minimalist_art_remove(art, a, 8) == 0);
+  minimalist_art_free(art);
+  return 0;
+}
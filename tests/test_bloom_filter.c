@@ -0,0 +1,78 @@
+#include <minimalist/bloom_filter.h>
+#include <minimalist/hash.h>
+#include <minimalist/hash_map.h>
+#include <minimalist/set.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NUM_ELEMENTS 10000
+
+int compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+int main() {
+  struct minimalist_bloom_filter *filter = NULL;
+  int false_positives = 0;
+
+  filter = minimalist_bloom_filter_new(NUM_ELEMENTS, 0.01);
+  assert(filter != NULL);
+  for (uint64_t i = 0; i < NUM_ELEMENTS; i++) {
+    minimalist_bloom_filter_add(filter, &i, sizeof(i));
+  }
+  for (uint64_t i = 0; i < NUM_ELEMENTS; i++) {
+    assert(minimalist_bloom_filter_contains(filter, &i, sizeof(i)));
+  }
+  for (uint64_t i = NUM_ELEMENTS; i < 2 * NUM_ELEMENTS; i++) {
+    false_positives += minimalist_bloom_filter_contains(filter, &i, sizeof(i));
+  }
+  /* Blocking costs a little accuracy over the 1% target */
+  assert(false_positives < NUM_ELEMENTS / 50);
+  minimalist_bloom_filter_clear(filter);
+  assert(!minimalist_bloom_filter_contains_hash(filter, 42));
+
+  /* Attached to a hash map, both before and after entries are added */
+  struct minimalist_hash_map *map = minimalist_hash_map_new(
+      1024, minimalist_hash_pointer, compare_pointers);
+  for (uintptr_t i = 1; i <= 100; i++) {
+    minimalist_hash_map_set(map, (void *)i, (void *)(i * 2));
+  }
+  minimalist_hash_map_attach_filter(map, filter);
+  for (uintptr_t i = 101; i <= 200; i++) {
+    minimalist_hash_map_set(map, (void *)i, (void *)(i * 2));
+  }
+  for (uintptr_t i = 1; i <= 200; i++) {
+    assert(minimalist_hash_map_get(map, (void *)i) == (void *)(i * 2));
+  }
+  assert(minimalist_hash_map_get(map, (void *)1000) == NULL);
+  const void *keys[] = {(void *)1, (void *)150, (void *)1000};
+  void *values[3];
+  minimalist_hash_map_get_many(map, keys, 3, values);
+  assert(values[0] == (void *)2 && values[1] == (void *)300);
+  assert(values[2] == NULL);
+  minimalist_hash_map_free(map);
+
+  /* Attached to a set */
+  minimalist_bloom_filter_clear(filter);
+  struct minimalist_set *set = minimalist_set_new(NULL);
+  for (uintptr_t i = 1; i <= 50; i++) {
+    minimalist_set_add(set, (void *)i);
+  }
+  minimalist_set_attach_filter(set, filter, minimalist_hash_pointer);
+  for (uintptr_t i = 51; i <= 100; i++) {
+    minimalist_set_add(set, (void *)i);
+  }
+  for (uintptr_t i = 1; i <= 100; i++) {
+    assert(minimalist_set_exists(set, (void *)i));
+  }
+  assert(!minimalist_set_exists(set, (void *)1000));
+  minimalist_set_free(set);
+
+  minimalist_bloom_filter_free(filter);
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include <minimalist/concurrent_skiplist.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NUM_KEYS 10000
+#define NUM_THREADS 4
+#define KEYS_PER_THREAD 20000
+
+#define NUM_CHURNED 16
+
+#define KEY(i) ((const void*)(uintptr_t)((i) + 1))
+/* Keys every thread adds and removes, after all the others */
+#define CHURNED(i) KEY(NUM_THREADS * KEYS_PER_THREAD + (i) % NUM_CHURNED)
+
+struct minimalist_concurrent_skiplist* shared = NULL;
+atomic_int writers_done;
+
+static uintptr_t last_key = 0;
+static int run_count = 0;
+
+/* Addresses run from the lowest to the highest */
+static int check_order(void* context, const void* key, void* value) {
+  assert((uintptr_t)key > last_key);
+  assert(value == key);
+  last_key = (uintptr_t)key;
+  run_count++;
+  return context != NULL && run_count == *(int*)context;
+}
+
+void test_entries(void) {
+  struct minimalist_concurrent_skiplist* list =
+      minimalist_concurrent_skiplist_new(NULL);
+  void* old_value = NULL;
+  int stop = 10;
+
+  /* Shuffled inserts */
+  for (int i = 0; i < NUM_KEYS; i++) {
+    uintptr_t k = (uintptr_t)i * 7919 % NUM_KEYS;
+    assert(minimalist_concurrent_skiplist_insert(
+               list, KEY(k), (void*)KEY(k)) == 1);
+  }
+  assert(minimalist_concurrent_skiplist_size(list) == NUM_KEYS);
+  assert(minimalist_concurrent_skiplist_insert(list, KEY(5), NULL) == 0);
+  assert(minimalist_concurrent_skiplist_get(list, KEY(5)) == KEY(5));
+  assert(minimalist_concurrent_skiplist_get(list, KEY(NUM_KEYS)) == NULL);
+  assert(!minimalist_concurrent_skiplist_contains(list, KEY(NUM_KEYS)));
+
+  assert(minimalist_concurrent_skiplist_set(list, KEY(5), NULL) == 0);
+  assert(minimalist_concurrent_skiplist_get(list, KEY(5)) == NULL);
+  assert(minimalist_concurrent_skiplist_contains(list, KEY(5)));
+  assert(minimalist_concurrent_skiplist_remove(list, KEY(5), &old_value));
+  assert(old_value == NULL);
+  assert(!minimalist_concurrent_skiplist_remove(list, KEY(5), NULL));
+  assert(!minimalist_concurrent_skiplist_contains(list, KEY(5)));
+  assert(minimalist_concurrent_skiplist_set(
+             list, KEY(5), (void*)KEY(5)) == 1);
+
+  for (int i = 0; i < NUM_KEYS; i += 2) {
+    assert(minimalist_concurrent_skiplist_remove(list, KEY(i), &old_value));
+    assert(old_value == KEY(i));
+  }
+  assert(minimalist_concurrent_skiplist_size(list) == NUM_KEYS / 2);
+  minimalist_concurrent_skiplist_run(list, NULL, check_order, NULL);
+  assert(run_count == NUM_KEYS / 2);
+
+  /* Runs can start anywhere and stop early */
+  last_key = 0;
+  run_count = 0;
+  minimalist_concurrent_skiplist_run(list, KEY(100), check_order, &stop);
+  assert(run_count == 10);
+  assert(last_key == (uintptr_t)KEY(119));
+  minimalist_concurrent_skiplist_free(list);
+}
+
+static void* write_keys(void* context) {
+  uintptr_t first = (uintptr_t)context * KEYS_PER_THREAD;
+  for (uintptr_t i = first; i < first + KEYS_PER_THREAD; i++) {
+    assert(minimalist_concurrent_skiplist_insert(
+               shared, KEY(i), (void*)KEY(i)) == 1);
+    /* Removes every other key again, while later ones are added */
+    if (i % 2 == 1) {
+      assert(minimalist_concurrent_skiplist_remove(shared, KEY(i - 1), NULL));
+    }
+    minimalist_concurrent_skiplist_set(shared, CHURNED(i), (void*)CHURNED(i));
+    minimalist_concurrent_skiplist_remove(shared, CHURNED(i + 3), NULL);
+  }
+  atomic_fetch_add(&writers_done, 1);
+  return NULL;
+}
+
+static int check_scan(void* context, const void* key, void* value) {
+  uintptr_t* last = context;
+  assert((uintptr_t)key > *last);
+  assert(value == key);
+  *last = (uintptr_t)key;
+  return 0;
+}
+
+static void* scan_keys(void* context) {
+  uintptr_t last = 0;
+  while (atomic_load(&writers_done) < NUM_THREADS) {
+    last = 0;
+    minimalist_concurrent_skiplist_run(shared, NULL, check_scan, &last);
+  }
+  return NULL;
+}
+
+void test_threads(void) {
+  pthread_t writers[NUM_THREADS], scanner;
+  uintptr_t last = 0;
+
+  shared = minimalist_concurrent_skiplist_new(NULL);
+  atomic_init(&writers_done, 0);
+  assert(pthread_create(&scanner, NULL, scan_keys, NULL) == 0);
+  for (uintptr_t t = 0; t < NUM_THREADS; t++) {
+    assert(pthread_create(&writers[t], NULL, write_keys, (void*)t) == 0);
+  }
+  for (int t = 0; t < NUM_THREADS; t++) {
+    pthread_join(writers[t], NULL);
+  }
+  pthread_join(scanner, NULL);
+  for (int i = 0; i < NUM_CHURNED; i++) {
+    minimalist_concurrent_skiplist_remove(shared, CHURNED(i), NULL);
+  }
+
+  assert(minimalist_concurrent_skiplist_size(shared) ==
+         NUM_THREADS * KEYS_PER_THREAD / 2);
+  for (uintptr_t i = 0; i < NUM_THREADS * KEYS_PER_THREAD; i++) {
+    assert(minimalist_concurrent_skiplist_contains(shared, KEY(i)) ==
+           (int)(i % 2));
+  }
+  minimalist_concurrent_skiplist_run(shared, NULL, check_scan, &last);
+  minimalist_concurrent_skiplist_free(shared);
+}
+
+int main() {
+  test_entries();
+  test_threads();
+  return 0;
+}
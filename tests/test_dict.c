@@ -0,0 +1,90 @@
+#include <minimalist/dict.h>
+#include <minimalist/hash.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_KEYS 100000
+
+int compare_strings(const void *a, const void *b) {
+  return strcmp(a, b);
+}
+
+int compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+struct run_state {
+  uintptr_t expected;
+  size_t count;
+};
+
+/* Expects values to increase through the run */
+void check_order(void *context, const void *key, void *value) {
+  struct run_state *state = context;
+  assert((uintptr_t)key == (uintptr_t)value);
+  assert((uintptr_t)value > state->expected);
+  state->expected = (uintptr_t)value;
+  state->count++;
+}
+
+void collect_strings(void *context, const void *key, void *value) {
+  strcat(context, key);
+}
+
+int main() {
+  struct minimalist_dict *dict = NULL;
+  struct run_state state = {0, 0};
+  char order[16] = "";
+  char *value = "value";
+
+  assert(minimalist_dict_new(minimalist_hash_string, NULL) == NULL);
+  dict = minimalist_dict_new(minimalist_hash_string, compare_strings);
+  assert(dict != NULL);
+  minimalist_dict_set(dict, "c", value);
+  minimalist_dict_set(dict, "a", value);
+  minimalist_dict_set(dict, "d", value);
+  minimalist_dict_set(dict, "b", value);
+  assert(minimalist_dict_get(dict, "a") == value);
+  assert(minimalist_dict_get(dict, "e") == NULL);
+  assert(minimalist_dict_size(dict) == 4);
+
+  /* Replacing keeps the position, removing and adding again moves to the end */
+  minimalist_dict_set(dict, "a", "other");
+  assert(strcmp(minimalist_dict_get(dict, "a"), "other") == 0);
+  minimalist_dict_set(dict, "d", NULL);
+  minimalist_dict_set(dict, "e", NULL);
+  minimalist_dict_set(dict, "c", NULL);
+  minimalist_dict_set(dict, "c", value);
+  assert(minimalist_dict_get(dict, "d") == NULL);
+  assert(minimalist_dict_size(dict) == 3);
+  minimalist_dict_run(dict, collect_strings, order);
+  assert(strcmp(order, "abc") == 0);
+  minimalist_dict_free(dict);
+
+  /* Grow through every index width, then remove most keys */
+  dict = minimalist_dict_new(minimalist_hash_pointer, compare_pointers);
+  for (uintptr_t i = 1; i <= NUM_KEYS; i++) {
+    minimalist_dict_set(dict, (void *)i, (void *)i);
+  }
+  assert(minimalist_dict_size(dict) == NUM_KEYS);
+  for (uintptr_t i = 1; i <= NUM_KEYS; i++) {
+    assert(minimalist_dict_get(dict, (void *)i) == (void *)i);
+    if (i % 10 != 0) {
+      minimalist_dict_set(dict, (void *)i, NULL);
+    }
+  }
+  assert(minimalist_dict_size(dict) == NUM_KEYS / 10);
+  for (uintptr_t i = 1; i <= NUM_KEYS; i++) {
+    assert(minimalist_dict_get(dict, (void *)i) ==
+           (i % 10 == 0 ? (void *)i : NULL));
+  }
+  minimalist_dict_run(dict, check_order, &state);
+  assert(state.count == NUM_KEYS / 10);
+  minimalist_dict_free(dict);
+  return 0;
+}
@@ -4,15 +4,371 @@
 #undef NDEBUG
 #endif
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 char* a = "A";
 char* b = "B";
 char* c = "C";
 char* d = "D";
 
+#define NUM_VERTICES 1000
+
+int ids[NUM_VERTICES];
+
+#define NUM_CHECKED 200
+#define NUM_TRIES 3000
+
+/* Reference check: whether start reaches target, by a plain search */
+int reaches(struct minimalist_graph* graph, uint32_t start, uint32_t target) {
+  uint32_t n = minimalist_graph_num_vertices(graph);
+  uint32_t* stack = malloc(sizeof(uint32_t) * n);
+  char* visited = calloc(n, 1);
+  const uint32_t* neighbors = NULL;
+  uint32_t top = 0, count = 0, v = 0;
+  int found = 0;
+
+  stack[top++] = start;
+  visited[start] = 1;
+  while (top > 0 && !found) {
+    v = stack[--top];
+    found = v == target;
+    count = minimalist_graph_get_neighbor_ids(graph, v, &neighbors);
+    for (uint32_t i = 0; i < count; i++) {
+      if (!visited[neighbors[i]]) {
+        visited[neighbors[i]] = 1;
+        stack[top++] = neighbors[i];
+      }
+    }
+  }
+  free(stack);
+  free(visited);
+  return found;
+}
+
+void test_try_add_edge(int directed) {
+  struct minimalist_graph* graph = minimalist_graph_new(directed);
+  uint32_t a = 0, b = 0;
+  int added = 0, num_added = 0;
+  int *first = NULL, *second = NULL;
+
+  for (int i = 0; i < NUM_CHECKED; i++) {
+    minimalist_graph_add_vertex(graph, &ids[i]);
+  }
+  /* Edges added before the first check are picked up by it */
+  minimalist_graph_add_edge_id(graph, 0, 1);
+  srand(directed + 1);
+  for (int i = 0; i < NUM_TRIES; i++) {
+    a = rand() % NUM_CHECKED;
+    b = rand() % NUM_CHECKED;
+    added = reaches(graph, b, a) ? 0 : 1;
+    assert(minimalist_graph_try_add_edge_id(graph, a, b) == added);
+    num_added += added;
+  }
+  assert(num_added > 0);
+  assert(num_added < NUM_TRIES);
+  assert(directed || !minimalist_graph_cyclic(graph));
+
+  /* An unchecked cycle makes checks fall back to a full search */
+  minimalist_graph_add_edge_id(graph, 1, 0);
+  for (int i = 0; i < NUM_TRIES / 10; i++) {
+    a = rand() % NUM_CHECKED;
+    b = rand() % NUM_CHECKED;
+    added = reaches(graph, b, a) ? 0 : 1;
+    assert(minimalist_graph_try_add_edge_id(graph, a, b) == added);
+  }
+
+  /* Vertices added later are tracked too */
+  first = &ids[NUM_CHECKED];
+  second = &ids[NUM_CHECKED + 1];
+  assert(minimalist_graph_try_add_edge(graph, first, second) == 1);
+  assert(minimalist_graph_try_add_edge(graph, second, first) == 0);
+  assert(minimalist_graph_try_add_edge(graph, second, &ids[0]) == 1);
+  assert(minimalist_graph_try_add_edge_id(graph, 0, NUM_CHECKED + 5) == -1);
+  minimalist_graph_free(graph);
+}
+
+/* Copies of each edge, for undirected graphs under the lower ID */
+unsigned char copies[NUM_VERTICES][NUM_VERTICES];
+uint32_t tally[NUM_VERTICES];
+
+#define NUM_CHANGES 50000
+
+void test_remove_edge(int directed) {
+  struct minimalist_graph* graph = minimalist_graph_new(directed);
+  const uint32_t* neighbors = NULL;
+  uint32_t from = 0, to = 0, count = 0, expected = 0;
+  unsigned char* edge = NULL;
+
+  memset(copies, 0, sizeof(copies));
+  for (int i = 0; i < NUM_VERTICES; i++) {
+    minimalist_graph_add_vertex(graph, &ids[i]);
+  }
+  /* Half the changes touch vertex 0, so its list gets indexed */
+  srand(directed + 5);
+  for (int i = 0; i < NUM_CHANGES; i++) {
+    from = rand() % NUM_VERTICES;
+    to = rand() % NUM_VERTICES;
+    if (rand() % 2) {
+      *(rand() % 2 ? &from : &to) = 0;
+    }
+    edge = directed || from <= to ? &copies[from][to] : &copies[to][from];
+    if (rand() % 5 < 3) {
+      minimalist_graph_add_edge_id(graph, from, to);
+      (*edge)++;
+    } else {
+      assert(minimalist_graph_remove_edge_id(graph, from, to) == (*edge > 0));
+      *edge -= *edge > 0;
+    }
+  }
+  for (from = 0; from < NUM_VERTICES; from++) {
+    memset(tally, 0, sizeof(tally));
+    count = minimalist_graph_get_neighbor_ids(graph, from, &neighbors);
+    for (uint32_t i = 0; i < count; i++) {
+      tally[neighbors[i]]++;
+    }
+    for (to = 0; to < NUM_VERTICES; to++) {
+      expected = directed || from <= to ? copies[from][to] : copies[to][from];
+      /* Undirected loops are in their list twice */
+      expected *= !directed && from == to ? 2 : 1;
+      assert(tally[to] == expected);
+      assert(minimalist_graph_has_edge_id(graph, from, to) == (expected > 0));
+    }
+  }
+  assert(minimalist_graph_remove_edge_id(graph, 0, NUM_VERTICES) == 0);
+  assert(!minimalist_graph_has_edge_id(graph, NUM_VERTICES, 0));
+
+  /* Unique edges skip the ones already there */
+  minimalist_graph_set_unique_edges(graph, 1);
+  while (minimalist_graph_remove_edge_id(graph, 0, 1) == 1) {
+  }
+  minimalist_graph_add_edge(graph, &ids[0], &ids[1]);
+  minimalist_graph_add_edge(graph, &ids[0], &ids[1]);
+  assert(minimalist_graph_has_edge(graph, &ids[0], &ids[1]));
+  assert(minimalist_graph_remove_edge(graph, &ids[0], &ids[1]) == 1);
+  assert(!minimalist_graph_has_edge(graph, &ids[0], &ids[1]));
+  minimalist_graph_free(graph);
+
+  /* Removed edges no longer count towards cycles */
+  graph = minimalist_graph_new(directed);
+  minimalist_graph_set_unique_edges(graph, 1);
+  assert(minimalist_graph_try_add_edge(graph, a, b) == 1);
+  assert(minimalist_graph_try_add_edge(graph, b, c) == 1);
+  assert(minimalist_graph_try_add_edge(graph, a, b) == 0);
+  assert(minimalist_graph_try_add_edge(graph, c, a) == 0);
+  assert(minimalist_graph_remove_edge(graph, b, c) == 1);
+  assert(minimalist_graph_try_add_edge(graph, c, a) == 1);
+  assert(minimalist_graph_try_add_edge(graph, b, c) == 0);
+  minimalist_graph_free(graph);
+}
+
+/* Enough edges for a file of a few megabytes, split between threads */
+#define NUM_LOADED 400000
+
+void assert_neighbors(struct minimalist_graph* graph,
+                      uint32_t id,
+                      const uint32_t* expected,
+                      uint32_t count) {
+  const uint32_t* neighbors = NULL;
+  assert(minimalist_graph_get_neighbor_ids(graph, id, &neighbors) == count);
+  assert(count == 0 || memcmp(neighbors, expected, count * 4) == 0);
+}
+
+void test_load() {
+  const char* path = "test_graph.edges";
+  struct minimalist_graph *graph = NULL, *threaded = NULL;
+  const uint32_t *neighbors = NULL, *threaded_neighbors = NULL;
+  uint32_t pairs[] = {0, 5, 0, 1, 0, 4, 0, 3, 0, 2, 2, 1};
+  uint64_t wide[] = {3, 1, 1, 2};
+  uint32_t count = 0;
+  FILE* file = NULL;
+
+  file = fopen(path, "w");
+  fputs("# comment\n% comment\n0 5\n0\t1 extra\n0 4\r\n\n0 3\n0 2\n2 1", file);
+  fclose(file);
+  graph = minimalist_graph_load(path, MINIMALIST_GRAPH_TEXT, 0, 1);
+  assert(graph != NULL);
+  assert(minimalist_graph_num_vertices(graph) == 6);
+  assert(minimalist_graph_vertex(graph, 5) == (void*)6);
+  assert(minimalist_graph_vertex_id(graph, (void*)6) == 5);
+  assert_neighbors(graph, 0, (uint32_t[]){1, 2, 3, 4, 5}, 5);
+  assert_neighbors(graph, 1, (uint32_t[]){0, 2}, 2);
+  assert_neighbors(graph, 5, (uint32_t[]){0}, 1);
+  /* Lists leave the shared edges when they grow */
+  minimalist_graph_add_edge(graph, (void*)1, (void*)100);
+  assert(minimalist_graph_num_vertices(graph) == 7);
+  assert_neighbors(graph, 0, (uint32_t[]){1, 2, 3, 4, 5, 6}, 6);
+  assert_neighbors(graph, 1, (uint32_t[]){0, 2}, 2);
+  assert(minimalist_graph_cyclic(graph));
+  minimalist_graph_free(graph);
+
+  file = fopen(path, "w");
+  fputs("0 1\n1 x\n", file);
+  fclose(file);
+  assert(minimalist_graph_load(path, MINIMALIST_GRAPH_TEXT, 0, 1) == NULL);
+  assert(errno == EINVAL);
+  file = fopen(path, "w");
+  fputs("0 4294967295\n", file);
+  fclose(file);
+  assert(minimalist_graph_load(path, MINIMALIST_GRAPH_TEXT, 0, 1) == NULL);
+  assert(errno == EINVAL);
+
+  file = fopen(path, "wb");
+  fwrite(pairs, sizeof(pairs), 1, file);
+  fclose(file);
+  graph = minimalist_graph_load(path, MINIMALIST_GRAPH_U32, 1, 0);
+  assert(graph != NULL);
+  assert_neighbors(graph, 0, (uint32_t[]){1, 2, 3, 4, 5}, 5);
+  assert_neighbors(graph, 1, NULL, 0);
+  assert_neighbors(graph, 2, (uint32_t[]){1}, 1);
+  assert(minimalist_graph_has_edge_id(graph, 0, 3));
+  assert(minimalist_graph_has_edge_id(graph, 2, 1));
+  assert(!minimalist_graph_has_edge_id(graph, 0, 0));
+  assert(!minimalist_graph_has_edge_id(graph, 1, 2));
+  /* Lists leave the shared edges when an edge is removed */
+  assert(minimalist_graph_remove_edge_id(graph, 0, 3) == 1);
+  assert(minimalist_graph_remove_edge_id(graph, 0, 3) == 0);
+  assert_neighbors(graph, 0, (uint32_t[]){1, 2, 5, 4}, 4);
+  assert(minimalist_graph_has_edge_id(graph, 0, 4));
+  minimalist_graph_free(graph);
+  /* Files must hold whole pairs */
+  assert(minimalist_graph_load(path, MINIMALIST_GRAPH_U64, 1, 0) == NULL);
+  assert(errno == EINVAL);
+
+  file = fopen(path, "wb");
+  fwrite(wide, sizeof(wide), 1, file);
+  fclose(file);
+  graph = minimalist_graph_load(path, MINIMALIST_GRAPH_U64, 1, 0);
+  assert(graph != NULL);
+  assert(minimalist_graph_num_vertices(graph) == 4);
+  assert_neighbors(graph, 0, NULL, 0);
+  assert_neighbors(graph, 3, (uint32_t[]){1}, 1);
+  minimalist_graph_free(graph);
+
+  /* The result is the same however many threads load it */
+  file = fopen(path, "w");
+  srand(7);
+  for (int i = 0; i < NUM_LOADED; i++) {
+    fprintf(file, "%d %d\n", rand() % 50000, rand() % 50000);
+  }
+  fclose(file);
+  graph = minimalist_graph_load(path, MINIMALIST_GRAPH_TEXT, 0, 1);
+  threaded = minimalist_graph_load(path, MINIMALIST_GRAPH_TEXT, 0, 4);
+  assert(graph != NULL && threaded != NULL);
+  assert(minimalist_graph_num_vertices(graph) ==
+         minimalist_graph_num_vertices(threaded));
+  for (uint32_t v = 0; v < minimalist_graph_num_vertices(graph); v++) {
+    count = minimalist_graph_get_neighbor_ids(graph, v, &neighbors);
+    assert(minimalist_graph_get_neighbor_ids(
+               threaded, v, &threaded_neighbors) == count);
+    assert(memcmp(neighbors, threaded_neighbors, count * 4) == 0);
+  }
+  minimalist_graph_free(graph);
+  minimalist_graph_free(threaded);
+  remove(path);
+}
+
+/* Enough vertices and edges for the BFS to go bottom-up */
+#define NUM_PARALLEL 20000
+#define PARALLEL_EDGES 60000
+
+/* Reference distances from a plain queue-based BFS */
+void reference_bfs(struct minimalist_graph* graph,
+                   uint32_t source,
+                   uint32_t* distances) {
+  uint32_t n = minimalist_graph_num_vertices(graph);
+  uint32_t* queue = malloc(sizeof(uint32_t) * n);
+  const uint32_t* neighbors = NULL;
+  uint32_t head = 0, tail = 0, count = 0, v = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    distances[i] = MINIMALIST_GRAPH_INVALID;
+  }
+  distances[source] = 0;
+  queue[tail++] = source;
+  while (head < tail) {
+    v = queue[head++];
+    count = minimalist_graph_get_neighbor_ids(graph, v, &neighbors);
+    for (uint32_t i = 0; i < count; i++) {
+      if (distances[neighbors[i]] == MINIMALIST_GRAPH_INVALID) {
+        distances[neighbors[i]] = distances[v] + 1;
+        queue[tail++] = neighbors[i];
+      }
+    }
+  }
+  free(queue);
+}
+
+void test_parallel(int directed) {
+  struct minimalist_graph* graph = minimalist_graph_new(directed);
+  uint32_t* expected = malloc(sizeof(uint32_t) * NUM_PARALLEL);
+  uint32_t* distances = malloc(sizeof(uint32_t) * NUM_PARALLEL);
+  uint32_t* labels = malloc(sizeof(uint32_t) * NUM_PARALLEL);
+  unsigned char* reached = malloc(NUM_PARALLEL);
+  uint32_t sources[] = {0, 7, 7, NUM_PARALLEL - 1};
+  uint32_t num_components = 0, count = 0;
+  static int vertices[NUM_PARALLEL];
+
+  for (int i = 0; i < NUM_PARALLEL; i++) {
+    minimalist_graph_add_vertex(graph, &vertices[i]);
+  }
+  /* The last tenth of the vertices stay apart from the rest */
+  srand(directed + 3);
+  for (int i = 0; i < PARALLEL_EDGES; i++) {
+    minimalist_graph_add_edge_id(graph,
+                                 rand() % (NUM_PARALLEL * 9 / 10),
+                                 rand() % (NUM_PARALLEL * 9 / 10));
+  }
+  for (int i = NUM_PARALLEL * 9 / 10; i + 1 < NUM_PARALLEL; i += 2) {
+    minimalist_graph_add_edge_id(graph, i + 1, i);
+  }
+
+  reference_bfs(graph, 0, expected);
+  for (unsigned int threads = 1; threads <= 4; threads *= 2) {
+    assert(minimalist_graph_bfs(graph, 0, distances, threads) == 0);
+    assert(memcmp(distances, expected, sizeof(uint32_t) * NUM_PARALLEL) ==
+           0);
+
+    memset(reached, 2, NUM_PARALLEL);
+    count = minimalist_graph_reachable(graph, sources, 4, reached, threads);
+    reference_bfs(graph, NUM_PARALLEL - 1, distances);
+    for (int i = 0; i < NUM_PARALLEL; i++) {
+      assert(reached[i] == (expected[i] != MINIMALIST_GRAPH_INVALID ||
+                            distances[i] != MINIMALIST_GRAPH_INVALID));
+      count -= reached[i];
+    }
+    assert(count == 0);
+
+    num_components = minimalist_graph_components(graph, labels, threads);
+    count = 0;
+    for (int i = 0; i < NUM_PARALLEL; i++) {
+      /* Labels are the lowest ID of the component, so point backwards */
+      assert(labels[i] <= (uint32_t)i && labels[labels[i]] == labels[i]);
+      count += labels[i] == (uint32_t)i;
+      if (i >= NUM_PARALLEL * 9 / 10) {
+        assert(labels[i] == (uint32_t)(i - (i - NUM_PARALLEL * 9 / 10) % 2));
+      } else if (expected[i] != MINIMALIST_GRAPH_INVALID && !directed) {
+        assert(labels[i] == 0);
+      }
+    }
+    assert(count == num_components);
+  }
+  assert(minimalist_graph_bfs(graph, NUM_PARALLEL, distances, 1) == -1);
+
+  free(expected);
+  free(distances);
+  free(labels);
+  free(reached);
+  minimalist_graph_free(graph);
+}
+
 int main() {
   struct minimalist_graph* graph = NULL;
+  minimalist_graph_neighbor_list_t neighbors = NULL;
+  const uint32_t* neighbor_ids = NULL;
   graph =  minimalist_graph_new(0);
   minimalist_graph_add_edge(graph, a, b);
   minimalist_graph_add_edge(graph, b, c);
@@ -26,7 +382,67 @@ int main() {
   minimalist_graph_add_edge(graph, c, d);
   minimalist_graph_add_edge(graph, d, a);
   assert(minimalist_graph_cyclic(graph));
+  minimalist_graph_free(graph);
+
+  /* A parallel undirected edge is a cycle for both checks */
+  graph = minimalist_graph_new(0);
+  assert(minimalist_graph_try_add_edge(graph, a, b) == 1);
+  assert(!minimalist_graph_cyclic(graph));
+  assert(minimalist_graph_try_add_edge(graph, a, b) == 0);
+  assert(minimalist_graph_try_add_edge(graph, b, a) == 0);
+  minimalist_graph_add_edge(graph, b, a);
+  assert(minimalist_graph_cyclic(graph));
+  assert(minimalist_graph_remove_edge(graph, a, b) == 1);
+  assert(!minimalist_graph_cyclic(graph));
+  assert(minimalist_graph_try_add_edge(graph, a, a) == 0);
+  minimalist_graph_add_edge(graph, c, c);
+  assert(minimalist_graph_cyclic(graph));
+  minimalist_graph_free(graph);
+
+  graph = minimalist_graph_new(1);
+  minimalist_graph_add_edge(graph, a, b);
+  minimalist_graph_add_edge(graph, a, c);
+  assert(minimalist_graph_num_vertices(graph) == 3);
+  assert(minimalist_graph_vertex_id(graph, a) == 0);
+  assert(minimalist_graph_vertex_id(graph, c) == 2);
+  assert(minimalist_graph_vertex_id(graph, d) == MINIMALIST_GRAPH_INVALID);
+  assert(minimalist_graph_vertex(graph, 1) == b);
+  assert(minimalist_graph_vertex(graph, 3) == NULL);
+  assert(minimalist_graph_add_vertex(graph, b) == 1);
+  assert(minimalist_graph_add_vertex(graph, d) == 3);
+
+  neighbors = minimalist_graph_get_neighbors(graph, a);
+  assert(neighbors[0] == b && neighbors[1] == c && neighbors[2] == NULL);
+  free(neighbors);
+  neighbors = minimalist_graph_get_neighbors(graph, b);
+  assert(neighbors[0] == NULL);
+  free(neighbors);
+  assert(minimalist_graph_get_neighbors(graph, &ids) == NULL);
+
+  /* Enough vertices and edges to grow the ID table and spill the lists */
+  for (int i = 0; i < NUM_VERTICES; i++) {
+    assert(minimalist_graph_add_vertex(graph, &ids[i]) == (uint32_t)i + 4);
+  }
+  for (int i = 1; i < NUM_VERTICES; i++) {
+    minimalist_graph_add_edge_id(graph, 4, (uint32_t)i + 4);
+  }
+  for (int i = 0; i < NUM_VERTICES; i++) {
+    assert(minimalist_graph_vertex_id(graph, &ids[i]) == (uint32_t)i + 4);
+  }
+  assert(minimalist_graph_get_neighbor_ids(graph, 4, &neighbor_ids) ==
+         NUM_VERTICES - 1);
+  for (int i = 1; i < NUM_VERTICES; i++) {
+    assert(neighbor_ids[i - 1] == (uint32_t)i + 4);
+  }
+  minimalist_graph_free(graph);
 
+  test_try_add_edge(0);
+  test_try_add_edge(1);
+  test_remove_edge(0);
+  test_remove_edge(1);
+  test_load();
+  test_parallel(0);
+  test_parallel(1);
 
   return 0;
 }
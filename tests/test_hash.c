@@ -0,0 +1,71 @@
+#include <minimalist/hash.h>
+#include <minimalist/hash_map.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+int compare_strings(const void *a, const void *b) {
+  const char *str_a = a, *str_b = b;
+  return strcmp(str_a, str_b);
+}
+
+int compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+int main() {
+  unsigned char buffer[1024];
+  uint64_t hashes[sizeof(buffer) + 1];
+
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = (unsigned char)(i * 7 + 3);
+  }
+
+  /* Every prefix length takes a different path and should hash differently */
+  for (size_t len = 0; len <= sizeof(buffer); len++) {
+    hashes[len] = minimalist_hash_bytes(buffer, len, 0);
+    assert(hashes[len] == minimalist_hash_bytes(buffer, len, 0));
+    for (size_t j = 0; j < len; j++) {
+      assert(hashes[j] != hashes[len]);
+    }
+  }
+  assert(minimalist_hash_bytes(buffer, 32, 0) !=
+         minimalist_hash_bytes(buffer, 32, 1));
+
+  /* Flipping a single bit in a long input changes the hash */
+  uint64_t before = minimalist_hash_bytes(buffer, sizeof(buffer), 0);
+  buffer[700] ^= 1;
+  assert(before != minimalist_hash_bytes(buffer, sizeof(buffer), 0));
+
+  assert(minimalist_hash_u64(1) != minimalist_hash_u64(2));
+  assert(minimalist_hash_u32(1) != minimalist_hash_u32(2));
+  assert(minimalist_hash_string("key") == minimalist_hash_string("key"));
+  assert(minimalist_hash_string("keya") != minimalist_hash_string("keyb"));
+
+  struct minimalist_hash_map *map = NULL;
+  map = minimalist_hash_map_new(3, minimalist_hash_string, compare_strings);
+  assert(map != NULL);
+  minimalist_hash_map_set(map, "keya", "a");
+  minimalist_hash_map_set(map, "keyb", "b");
+  minimalist_hash_map_set(map, "keyc", "c");
+  assert(strcmp(minimalist_hash_map_get(map, "keya"), "a") == 0);
+  assert(strcmp(minimalist_hash_map_get(map, "keyb"), "b") == 0);
+  assert(strcmp(minimalist_hash_map_get(map, "keyc"), "c") == 0);
+  assert(minimalist_hash_map_get(map, "keyd") == NULL);
+  minimalist_hash_map_free(map);
+
+  map = minimalist_hash_map_new(64, minimalist_hash_pointer, compare_pointers);
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    minimalist_hash_map_set(map, &buffer[i], &hashes[i]);
+  }
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    assert(minimalist_hash_map_get(map, &buffer[i]) == &hashes[i]);
+  }
+  minimalist_hash_map_free(map);
+  return 0;
+}
@@ -1,11 +1,16 @@
+#include <minimalist/hash.h>
 #include <minimalist/hash_map.h>
 
 #ifndef NDEBUG
 #undef NDEBUG
 #endif
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#define NUM_BUILD 20000
+
 size_t hash_string(const void *x) {
   size_t hash = 0;
   int i = 0;
@@ -23,6 +28,45 @@ int compare_strings(const void *a, const void *b) {
   return strcmp(str_a, str_b);
 }
 
+int compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+void test_build_parallel(unsigned int threads) {
+  const void **keys = malloc(sizeof(void *) * NUM_BUILD);
+  void **values = malloc(sizeof(void *) * NUM_BUILD);
+  struct minimalist_hash_map *map = NULL;
+
+  /* Every key appears twice, the second time with a different value */
+  for (uintptr_t i = 0; i < NUM_BUILD; i++) {
+    keys[i] = (void *)(i % (NUM_BUILD / 2) + 1);
+    values[i] = (void *)(i + 1);
+  }
+  map = minimalist_hash_map_build_parallel(0,
+                                           minimalist_hash_pointer,
+                                           compare_pointers,
+                                           keys,
+                                           values,
+                                           NUM_BUILD,
+                                           threads);
+  assert(map != NULL);
+  for (uintptr_t i = 1; i <= NUM_BUILD / 2; i++) {
+    assert(minimalist_hash_map_get(map, (void *)i) ==
+           (void *)(i + NUM_BUILD / 2));
+  }
+  assert(minimalist_hash_map_get(map, (void *)(uintptr_t)(NUM_BUILD + 1)) ==
+         NULL);
+
+  /* Built entries can be removed and replaced like any other */
+  minimalist_hash_map_set(map, keys[0], NULL);
+  assert(minimalist_hash_map_get(map, keys[0]) == NULL);
+  minimalist_hash_map_set(map, keys[0], values[0]);
+  assert(minimalist_hash_map_get(map, keys[0]) == values[0]);
+  minimalist_hash_map_free(map);
+  free(keys);
+  free(values);
+}
+
 int main() {
   struct minimalist_hash_map* map = NULL;
   map = minimalist_hash_map_new(32, NULL, NULL);
@@ -36,6 +80,50 @@ int main() {
   minimalist_hash_map_set(map, "keyd", NULL);
   char* ret = minimalist_hash_map_get(map, "keyb");
   assert(value == ret);
+
+  const void *keys[] = {"keya", "keyb", "keyc", "keyb"};
+  void *values[4];
+  minimalist_hash_map_get_many(map, keys, 4, values);
+  assert(values[0] == NULL);
+  assert(values[1] == value);
+  assert(values[2] == NULL);
+  assert(values[3] == value);
+
+  /* Counting with a single lookup per update */
+  const char *words[] = {"a", "b", "a", "c", "a", "b"};
+  void **slot = NULL;
+  int inserted = 0, num_inserted = 0;
+  for (int i = 0; i < 6; i++) {
+    slot = minimalist_hash_map_upsert(map, words[i], &inserted);
+    assert(slot != NULL);
+    *slot = (char *)*slot + 1;
+    num_inserted += inserted;
+  }
+  assert(num_inserted == 3);
+  assert(minimalist_hash_map_get(map, "a") == (void *)3);
+  assert(minimalist_hash_map_get(map, "c") == (void *)1);
+
+  const void *old_key = NULL;
+  void *old_value = NULL;
+  assert(minimalist_hash_map_remove(map, "b", &old_key, &old_value));
+  assert(old_key == words[1] && old_value == (void *)2);
+  assert(!minimalist_hash_map_remove(map, "b", NULL, NULL));
+  assert(!minimalist_hash_map_contains(map, "b"));
+  slot = minimalist_hash_map_upsert(map, "b", &inserted);
+  assert(inserted && *slot == NULL);
+  assert(minimalist_hash_map_contains(map, "b"));
+  assert(minimalist_hash_map_get(map, "b") == NULL);
+  minimalist_hash_map_free(map);
+
+  assert(minimalist_hash_map_build_parallel(
+             0, hash_string, NULL, keys, values, 4, 1) == NULL);
+  map = minimalist_hash_map_build_parallel(
+      0, hash_string, compare_strings, keys, values, 0, 1);
+  assert(map != NULL);
+  assert(minimalist_hash_map_get(map, "keyb") == NULL);
   minimalist_hash_map_free(map);
+  test_build_parallel(1);
+  test_build_parallel(3);
+  test_build_parallel(0);
   return 0;
 }
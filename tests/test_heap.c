@@ -0,0 +1,90 @@
+#include <minimalist/heap.h>
+#include <minimalist/map.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdlib.h>
+
+#define NUM_VALUES 1000
+
+int compare_ints(const void *a, const void *b) {
+  const int *int_a = a, *int_b = b;
+  return (*int_a < *int_b) - (*int_a > *int_b);
+}
+
+static int values[NUM_VALUES];
+
+/* Pops the heap along a map run, which must visit values in the same order */
+static void pop_along(void *context, const void *key, void *value) {
+  assert(minimalist_heap_pop(context) == key);
+}
+
+static void check_sorted(struct minimalist_heap *heap, size_t expected) {
+  const int *value = NULL;
+  int last = -1;
+  size_t popped = 0;
+  while ((value = minimalist_heap_pop(heap)) != NULL) {
+    assert(*value >= last);
+    last = *value;
+    popped++;
+  }
+  assert(popped == expected);
+  assert(minimalist_heap_size(heap) == 0);
+}
+
+int main() {
+  struct minimalist_heap *heap = NULL;
+  const void *pointers[NUM_VALUES];
+  size_t handles[NUM_VALUES];
+  int lowered = -1;
+
+  for (int i = 0; i < NUM_VALUES; i++) {
+    values[i] = (i * 7919) % NUM_VALUES;
+    pointers[i] = &values[i];
+  }
+
+  heap = minimalist_heap_new(0, compare_ints);
+  assert(heap != NULL);
+  assert(minimalist_heap_pop(heap) == NULL);
+  for (int i = 0; i < NUM_VALUES; i++) {
+    handles[i] = minimalist_heap_push(heap, &values[i]);
+    assert(minimalist_heap_contains(heap, handles[i]));
+  }
+  assert(*(const int *)minimalist_heap_peek(heap) == 0);
+
+  /* Decrease a key to the front, then push another one back */
+  minimalist_heap_update(heap, handles[500], &lowered);
+  assert(minimalist_heap_peek(heap) == &lowered);
+  minimalist_heap_update(heap, handles[500], &values[500]);
+  assert(*(const int *)minimalist_heap_peek(heap) == 0);
+
+  assert(*(const int *)minimalist_heap_pop(heap) == 0);
+  assert(!minimalist_heap_contains(heap, handles[0]));
+  check_sorted(heap, NUM_VALUES - 1);
+  minimalist_heap_free(heap);
+
+  for (unsigned int arity = 2; arity <= 8; arity++) {
+    heap =
+        minimalist_heap_from_array(arity, compare_ints, pointers, NUM_VALUES);
+    assert(heap != NULL);
+    assert(minimalist_heap_size(heap) == NUM_VALUES);
+    minimalist_heap_update(heap, 10, &lowered);
+    assert(minimalist_heap_pop(heap) == &lowered);
+    check_sorted(heap, NUM_VALUES - 1);
+    minimalist_heap_free(heap);
+  }
+
+  /* The same compare orders a heap and a map alike */
+  struct minimalist_map *map = minimalist_map_new(compare_ints);
+  heap = minimalist_heap_from_array(0, compare_ints, pointers, NUM_VALUES);
+  for (int i = 0; i < NUM_VALUES; i++) {
+    minimalist_map_set(map, &values[i], NULL);
+  }
+  minimalist_map_run(map, pop_along, heap);
+  assert(minimalist_heap_size(heap) == 0);
+  minimalist_map_free(map);
+  minimalist_heap_free(heap);
+  return 0;
+}
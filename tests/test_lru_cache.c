@@ -0,0 +1,129 @@
+#include <minimalist/hash.h>
+#include <minimalist/lru_cache.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define KEY(x) ((const void *)(uintptr_t)(x))
+#define VALUE(x) ((void *)(uintptr_t)(x))
+
+#define NUM_MANY 200000
+
+int compare_pointers(const void *a, const void *b) {
+  return a != b;
+}
+
+static int evicted = 0;
+static uintptr_t last_evicted = 0;
+
+static void evict_fn(void *context, const void *key, void *value) {
+  evicted++;
+  last_evicted = (uintptr_t)key;
+}
+
+static size_t size_fn(const void *key, const void *value) {
+  return (uintptr_t)value;
+}
+
+int main() {
+  struct minimalist_lru_cache *cache = NULL;
+
+  cache = minimalist_lru_cache_new(4, 1, MINIMALIST_LRU_CACHE_LRU, NULL, NULL);
+  assert(cache == NULL);
+
+  /* LRU evicts the least recently used key */
+  cache = minimalist_lru_cache_new(3,
+                                   1,
+                                   MINIMALIST_LRU_CACHE_LRU,
+                                   minimalist_hash_pointer,
+                                   compare_pointers);
+  minimalist_lru_cache_set_evict_fn(cache, evict_fn, NULL);
+  minimalist_lru_cache_put(cache, KEY(1), VALUE(10));
+  minimalist_lru_cache_put(cache, KEY(2), VALUE(20));
+  minimalist_lru_cache_put(cache, KEY(3), VALUE(30));
+  assert(minimalist_lru_cache_get(cache, KEY(1)) == VALUE(10));
+  minimalist_lru_cache_put(cache, KEY(4), VALUE(40));
+  assert(evicted == 1 && last_evicted == 2);
+  assert(minimalist_lru_cache_get(cache, KEY(2)) == NULL);
+  assert(minimalist_lru_cache_size(cache) == 3);
+
+  minimalist_lru_cache_put(cache, KEY(1), VALUE(11));
+  assert(evicted == 2 && last_evicted == 1);
+  assert(minimalist_lru_cache_get(cache, KEY(1)) == VALUE(11));
+  minimalist_lru_cache_put(cache, KEY(3), NULL);
+  assert(evicted == 3 && last_evicted == 3);
+  assert(minimalist_lru_cache_size(cache) == 2);
+  minimalist_lru_cache_free(cache);
+  assert(evicted == 5);
+
+  /* SIEVE keeps visited keys and evicts the oldest unvisited one */
+  evicted = 0;
+  cache = minimalist_lru_cache_new(3,
+                                   1,
+                                   MINIMALIST_LRU_CACHE_SIEVE,
+                                   minimalist_hash_pointer,
+                                   compare_pointers);
+  minimalist_lru_cache_set_evict_fn(cache, evict_fn, NULL);
+  minimalist_lru_cache_put(cache, KEY(1), VALUE(10));
+  minimalist_lru_cache_put(cache, KEY(2), VALUE(20));
+  minimalist_lru_cache_put(cache, KEY(3), VALUE(30));
+  assert(minimalist_lru_cache_get(cache, KEY(1)) == VALUE(10));
+  minimalist_lru_cache_put(cache, KEY(4), VALUE(40));
+  assert(evicted == 1 && last_evicted == 2);
+  minimalist_lru_cache_put(cache, KEY(5), VALUE(50));
+  assert(evicted == 2 && last_evicted == 3);
+  assert(minimalist_lru_cache_get(cache, KEY(1)) == VALUE(10));
+  minimalist_lru_cache_free(cache);
+
+  /* Capacity in bytes across several shards */
+  evicted = 0;
+  cache = minimalist_lru_cache_new(400,
+                                   4,
+                                   MINIMALIST_LRU_CACHE_LRU,
+                                   minimalist_hash_pointer,
+                                   compare_pointers);
+  minimalist_lru_cache_set_evict_fn(cache, evict_fn, NULL);
+  minimalist_lru_cache_set_size_fn(cache, size_fn);
+  for (uintptr_t i = 1; i <= 1000; i++) {
+    minimalist_lru_cache_put(cache, KEY(i), VALUE(10));
+    assert(minimalist_lru_cache_size(cache) <= 400);
+  }
+  assert(minimalist_lru_cache_get(cache, KEY(1000)) == VALUE(10));
+  assert(evicted + minimalist_lru_cache_size(cache) / 10 == 1000);
+  minimalist_lru_cache_free(cache);
+  assert(evicted == 1000);
+
+  /* Shards grow their tables with their entries */
+  evicted = 0;
+  cache = minimalist_lru_cache_new(NUM_MANY,
+                                   2,
+                                   MINIMALIST_LRU_CACHE_LRU,
+                                   minimalist_hash_pointer,
+                                   compare_pointers);
+  minimalist_lru_cache_set_evict_fn(cache, evict_fn, NULL);
+  for (uintptr_t i = 1; i <= NUM_MANY; i++) {
+    minimalist_lru_cache_put(cache, KEY(i), VALUE(i));
+  }
+  assert(minimalist_lru_cache_size(cache) + evicted == NUM_MANY);
+  for (uintptr_t i = NUM_MANY; i > NUM_MANY - 1000; i--) {
+    assert(minimalist_lru_cache_get(cache, KEY(i)) == VALUE(i));
+  }
+  minimalist_lru_cache_free(cache);
+
+  /* No shard is left without room */
+  cache = minimalist_lru_cache_new(1,
+                                   8,
+                                   MINIMALIST_LRU_CACHE_LRU,
+                                   minimalist_hash_pointer,
+                                   compare_pointers);
+  for (uintptr_t i = 1; i <= 16; i++) {
+    minimalist_lru_cache_put(cache, KEY(i), VALUE(i));
+    assert(minimalist_lru_cache_get(cache, KEY(i)) == VALUE(i));
+  }
+  minimalist_lru_cache_free(cache);
+  return 0;
+}
@@ -4,9 +4,12 @@
 #undef NDEBUG
 #endif
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define NUM_KEYS 10000
+
 int compare_strings(const void *a, const void *b) {
   const char *str_a = a, *str_b = b;
   return strcmp(str_a, str_b);
@@ -18,6 +21,59 @@ static void run_fn(void* context, const void* key, void* value) {
   run_count++;
 }
 
+static uintptr_t last_key = 0;
+
+/* Addresses run from the lowest to the highest */
+static void check_order(void* context, const void* key, void* value) {
+  assert((uintptr_t)key > last_key);
+  assert(value == key);
+  last_key = (uintptr_t)key;
+  run_count++;
+}
+
+void test_entries(void) {
+  struct minimalist_map* map = minimalist_map_new(NULL);
+  static char keys[NUM_KEYS];
+  const void* old_key = NULL;
+  void* old_value = NULL;
+  void** slot = NULL;
+  int inserted = 0;
+  minimalist_map_keys_t remaining = NULL;
+
+  slot = minimalist_map_upsert(map, &keys[0], &inserted);
+  assert(slot != NULL && inserted && *slot == NULL);
+  assert(minimalist_map_contains(map, &keys[0]));
+  assert(minimalist_map_get(map, &keys[0]) == NULL);
+  *slot = &keys[0];
+  assert(minimalist_map_upsert(map, &keys[0], &inserted) == slot);
+  assert(!inserted);
+
+  /* Insert in an order that needs every kind of rebalancing */
+  for (int i = 1; i < NUM_KEYS; i++) {
+    int k = (int)((i * 7919L) % NUM_KEYS);
+    slot = minimalist_map_upsert(map, &keys[k], &inserted);
+    assert(inserted || k == 0);
+    *slot = &keys[k];
+  }
+  for (int i = 0; i < NUM_KEYS; i += 2) {
+    assert(minimalist_map_remove(map, &keys[i], &old_key, &old_value));
+    assert(old_key == &keys[i] && old_value == &keys[i]);
+    assert(!minimalist_map_remove(map, &keys[i], NULL, NULL));
+  }
+  for (int i = 0; i < NUM_KEYS; i++) {
+    assert(minimalist_map_contains(map, &keys[i]) == (i % 2));
+    assert(minimalist_map_get(map, &keys[i]) == (i % 2 ? &keys[i] : NULL));
+  }
+  run_count = 0;
+  minimalist_map_run(map, check_order, NULL);
+  assert(run_count == NUM_KEYS / 2);
+  for (int i = 1; i < NUM_KEYS; i += 2) {
+    assert(minimalist_map_remove(map, &keys[i], NULL, NULL));
+  }
+  assert(minimalist_map_keys(map, &remaining) == 0);
+  minimalist_map_free(map);
+}
+
 int main() {
   struct minimalist_map* map = NULL;
   map = minimalist_map_new(compare_strings);
@@ -43,6 +99,9 @@ int main() {
   int num_keys = minimalist_map_keys(map, &keys);
   assert(num_keys == 4);
 
+  free(keys);
   minimalist_map_free(map);
+
+  test_entries();
   return 0;
 }
@@ -0,0 +1,93 @@
+#include <minimalist/persistent_map.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdlib.h>
+
+#define NUM_KEYS 1000
+
+int compare_ints(const void *a, const void *b) {
+  const int *int_a = a, *int_b = b;
+  return (*int_a > *int_b) - (*int_a < *int_b);
+}
+
+static int keys[NUM_KEYS];
+static int values[NUM_KEYS];
+
+static int run_count = 0;
+static int last_key = 0;
+
+static void run_fn(void *context, const void *key, void *value) {
+  const int *int_key = key;
+  assert(run_count == 0 || *int_key < last_key);
+  last_key = *int_key;
+  run_count++;
+}
+
+int main() {
+  struct minimalist_persistent_map *versions[NUM_KEYS + 1];
+  struct minimalist_persistent_map *map = NULL, *next = NULL;
+
+  map = minimalist_persistent_map_new(compare_ints);
+  assert(map != NULL);
+  versions[0] = minimalist_persistent_map_retain(map);
+  for (int i = 0; i < NUM_KEYS; i++) {
+    keys[i] = (i * 7919) % NUM_KEYS;
+    values[i] = i;
+    next = minimalist_persistent_map_set(map, &keys[i], &values[i]);
+    assert(next != NULL);
+    minimalist_persistent_map_free(map);
+    map = next;
+    versions[i + 1] = minimalist_persistent_map_retain(map);
+  }
+
+  /* Every snapshot still sees exactly the keys set before it was taken */
+  for (int v = 0; v <= NUM_KEYS; v += 97) {
+    assert(minimalist_persistent_map_size(versions[v]) == (size_t)v);
+    for (int i = 0; i < NUM_KEYS; i++) {
+      int *value = minimalist_persistent_map_get(versions[v], &keys[i]);
+      assert(i < v ? value == &values[i] : value == NULL);
+    }
+  }
+
+  minimalist_persistent_map_run(map, run_fn, NULL);
+  assert(run_count == NUM_KEYS);
+
+  /* Overwrite and remove every other key */
+  for (int i = 0; i < NUM_KEYS; i += 2) {
+    next = minimalist_persistent_map_remove(map, &keys[i]);
+    minimalist_persistent_map_free(map);
+    map = next;
+  }
+  next = minimalist_persistent_map_set(map, &keys[1], &values[0]);
+  minimalist_persistent_map_free(map);
+  map = next;
+  assert(minimalist_persistent_map_size(map) == NUM_KEYS / 2);
+  assert(minimalist_persistent_map_get(map, &keys[1]) == &values[0]);
+  for (int i = 2; i < NUM_KEYS; i++) {
+    int *value = minimalist_persistent_map_get(map, &keys[i]);
+    assert(i % 2 ? value == &values[i] : value == NULL);
+    assert(minimalist_persistent_map_contains(map, &keys[i]) == i % 2);
+    assert(minimalist_persistent_map_get(versions[NUM_KEYS], &keys[i]) ==
+           &values[i]);
+  }
+
+  /* NULL values are stored, and removing a missing key changes nothing */
+  next = minimalist_persistent_map_set(map, &keys[1], NULL);
+  assert(minimalist_persistent_map_size(next) == NUM_KEYS / 2);
+  assert(minimalist_persistent_map_get(next, &keys[1]) == NULL);
+  assert(minimalist_persistent_map_contains(next, &keys[1]));
+  assert(minimalist_persistent_map_get(map, &keys[1]) == &values[0]);
+  minimalist_persistent_map_free(next);
+  next = minimalist_persistent_map_remove(map, &keys[0]);
+  assert(next == map);
+  minimalist_persistent_map_free(next);
+
+  for (int v = 0; v <= NUM_KEYS; v++) {
+    minimalist_persistent_map_free(versions[v]);
+  }
+  minimalist_persistent_map_free(map);
+  return 0;
+}
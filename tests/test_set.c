@@ -0,0 +1,64 @@
+#include <minimalist/set.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdlib.h>
+
+int compare_ints(const void *a, const void *b) {
+  const int *int_a = a, *int_b = b;
+  return (*int_a > *int_b) - (*int_a < *int_b);
+}
+
+static int values[] = {5, 3, 8, 1, 9, 2, 7};
+static int run_count = 0;
+static int last_value = 0;
+
+static void run_fn(void *context, const void *value) {
+  const int *int_value = value;
+  assert(run_count == 0 || *int_value < last_value);
+  last_value = *int_value;
+  run_count++;
+}
+
+int main() {
+  struct minimalist_set *set = minimalist_set_new(compare_ints);
+  int duplicate = 5, missing = 4;
+  assert(set != NULL);
+
+  for (int i = 0; i < 7; i++) {
+    minimalist_set_add(set, &values[i]);
+    minimalist_set_add(set, &duplicate);
+    for (int j = 0; j < 7; j++) {
+      assert(minimalist_set_exists(set, &values[j]) == (j <= i));
+    }
+    assert(!minimalist_set_exists(set, &missing));
+
+    run_count = 0;
+    minimalist_set_run(set, run_fn, NULL);
+    assert(run_count == i + 1);
+  }
+
+  /* Remove every value, then add again to the now empty set */
+  for (int i = 0; i < 7; i++) {
+    minimalist_set_remove(set, &values[i]);
+    minimalist_set_remove(set, &missing);
+    for (int j = 0; j < 7; j++) {
+      assert(minimalist_set_exists(set, &values[j]) == (j > i));
+    }
+    run_count = 0;
+    minimalist_set_run(set, run_fn, NULL);
+    assert(run_count == 6 - i);
+  }
+  minimalist_set_add(set, &values[0]);
+  assert(minimalist_set_exists(set, &values[0]));
+  minimalist_set_free(set);
+
+  set = minimalist_set_new(NULL);
+  run_count = 0;
+  minimalist_set_run(set, run_fn, NULL);
+  assert(run_count == 0);
+  minimalist_set_free(set);
+  return 0;
+}
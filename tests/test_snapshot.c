@@ -0,0 +1,140 @@
+#include <minimalist/hash.h>
+#include <minimalist/snapshot.h>
+
+#ifndef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_ENTRIES 1000
+
+int compare_strings(const void *a, const void *b) {
+  const char *str_a = a, *str_b = b;
+  return strcmp(str_a, str_b);
+}
+
+size_t string_size(const void *str) {
+  return strlen(str);
+}
+
+static char keys[NUM_ENTRIES][16];
+static char values[NUM_ENTRIES][16];
+
+static int run_count = 0;
+static char last_key[16];
+
+static void run_fn(void *context,
+                   const void *key,
+                   size_t key_len,
+                   const void *value,
+                   size_t value_len) {
+  char current[16] = {0};
+  memcpy(current, key, key_len);
+  assert(run_count == 0 || strcmp(last_key, current) < 0);
+  strcpy(last_key, current);
+  run_count++;
+}
+
+static void check(struct minimalist_snapshot *snapshot, size_t count) {
+  size_t value_len = 0;
+  assert(minimalist_snapshot_count(snapshot) == count);
+  for (int i = 0; i < NUM_ENTRIES; i++) {
+    const char *value =
+        minimalist_snapshot_get(snapshot, keys[i], strlen(keys[i]), &value_len);
+    assert(value != NULL);
+    assert(value_len == strlen(values[i]));
+    assert(memcmp(value, values[i], value_len) == 0);
+  }
+  assert(minimalist_snapshot_get(snapshot, "missing", 7, NULL) == NULL);
+  assert(minimalist_snapshot_get(snapshot, "key", 3, NULL) == NULL);
+}
+
+/* Writes a sorted snapshot header with the given fields and nothing else */
+static void write_header(const char *path,
+                         uint64_t count,
+                         uint64_t slots_offset,
+                         uint64_t data_offset,
+                         uint64_t file_size) {
+  uint64_t header[8] = {0};
+  FILE *file = fopen(path, "wb");
+  memcpy(header, "MINSNAP1", 8);
+  header[1] = 2;
+  header[2] = count;
+  header[4] = sizeof(header);
+  header[5] = slots_offset;
+  header[6] = data_offset;
+  header[7] = file_size;
+  fwrite(header, sizeof(header), 1, file);
+  fclose(file);
+}
+
+int main() {
+  const char *path = "test_snapshot.bin";
+  struct minimalist_snapshot *snapshot = NULL;
+
+  for (int i = 0; i < NUM_ENTRIES; i++) {
+    sprintf(keys[i], "key%d", i);
+    sprintf(values[i], "value%d", i * 3);
+  }
+
+  struct minimalist_hash_map *hash_map =
+      minimalist_hash_map_new(64, minimalist_hash_string, compare_strings);
+  for (int i = 0; i < NUM_ENTRIES; i++) {
+    minimalist_hash_map_set(hash_map, keys[i], values[i]);
+  }
+  assert(minimalist_hash_map_save(hash_map, path, string_size, string_size) ==
+         0);
+  minimalist_hash_map_free(hash_map);
+
+  assert(minimalist_map_open_mmap(path) == NULL);
+  snapshot = minimalist_hash_map_open_mmap(path);
+  assert(snapshot != NULL);
+  check(snapshot, NUM_ENTRIES);
+  minimalist_snapshot_close(snapshot);
+
+  struct minimalist_map *map = minimalist_map_new(compare_strings);
+  for (int i = 0; i < NUM_ENTRIES; i++) {
+    minimalist_map_set(map, keys[i], values[i]);
+  }
+  minimalist_map_set(map, "null", NULL);
+  assert(minimalist_map_save(map, path, string_size, string_size) == 0);
+  minimalist_map_free(map);
+
+  assert(minimalist_hash_map_open_mmap(path) == NULL);
+  snapshot = minimalist_map_open_mmap(path);
+  assert(snapshot != NULL);
+  check(snapshot, NUM_ENTRIES + 1);
+  /* NULL values come back as empty ones */
+  size_t value_len = 1;
+  assert(minimalist_snapshot_get(snapshot, "null", 4, &value_len) != NULL);
+  assert(value_len == 0);
+  minimalist_snapshot_run(snapshot, run_fn, NULL);
+  assert(run_count == NUM_ENTRIES + 1);
+  minimalist_snapshot_close(snapshot);
+
+  /* Headers must describe sections that fit the file */
+  write_header(path, 0, 64, 64, 64);
+  snapshot = minimalist_map_open_mmap(path);
+  assert(snapshot != NULL);
+  assert(minimalist_snapshot_count(snapshot) == 0);
+  minimalist_snapshot_close(snapshot);
+  write_header(path, 1 << 20, 64 + (32 << 20), 64 + (32 << 20), 0);
+  assert(minimalist_map_open_mmap(path) == NULL && errno == EINVAL);
+  write_header(path, 1 << 20, 64 + (32 << 20), 64 + (32 << 20), 64);
+  assert(minimalist_map_open_mmap(path) == NULL && errno == EINVAL);
+  write_header(path, 1, 64 + 32, 64 + 32, 64);
+  assert(minimalist_map_open_mmap(path) == NULL && errno == EINVAL);
+  write_header(path, 0, 64, 80, 64);
+  assert(minimalist_map_open_mmap(path) == NULL && errno == EINVAL);
+  write_header(path, 0, 64, 64, 80);
+  assert(minimalist_map_open_mmap(path) == NULL && errno == EINVAL);
+
+  assert(minimalist_map_open_mmap("does-not-exist.bin") == NULL);
+  remove(path);
+  return 0;
+}
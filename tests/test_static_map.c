@@ -0,0 +1,98 @@
+#include <minimalist/static_map.h>
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_ENTRIES 100000
+
+/* Generated at build time from test_static_map.tsv */
+MINIMALIST_STATIC_MAP_DECLARE(test_static_table);
+
+size_t string_size(const void *str) {
+  return strlen(str);
+}
+
+static char keys[NUM_ENTRIES][16];
+static char values[NUM_ENTRIES][16];
+static const void *key_list[NUM_ENTRIES];
+static const void *value_list[NUM_ENTRIES];
+
+static void check(const struct minimalist_static_map *map) {
+  size_t value_len = 0;
+  assert(minimalist_static_map_size(map) == NUM_ENTRIES);
+  for (int i = 0; i < NUM_ENTRIES; i++) {
+    const char *value =
+        minimalist_static_map_get(map, keys[i], strlen(keys[i]), &value_len);
+    assert(value != NULL);
+    assert(value_len == strlen(values[i]));
+    assert(memcmp(value, values[i], value_len) == 0);
+  }
+  assert(minimalist_static_map_get(map, "missing", 7, NULL) == NULL);
+  assert(minimalist_static_map_get(map, "key", 3, NULL) == NULL);
+  assert(minimalist_static_map_get(map, "key10", 4, NULL) != NULL);
+}
+
+int main() {
+  struct minimalist_static_map *map = NULL;
+  const struct minimalist_static_map *opened = NULL;
+  const void *blob = NULL;
+  uint64_t *copy = NULL;
+  size_t size = 0;
+  const char *duplicates[] = {"a", "b", "a"};
+  const char *value = NULL;
+
+  for (int i = 0; i < NUM_ENTRIES; i++) {
+    sprintf(keys[i], "key%d", i);
+    sprintf(values[i], "value%d", i * 7);
+    key_list[i] = keys[i];
+    value_list[i] = values[i];
+  }
+  map = minimalist_static_map_new(
+      key_list, value_list, NUM_ENTRIES, string_size, string_size);
+  assert(map != NULL);
+  check(map);
+
+  /* The blob is position independent */
+  blob = minimalist_static_map_blob(map, &size);
+  copy = malloc(size);
+  memcpy(copy, blob, size);
+  minimalist_static_map_free(map);
+  opened = minimalist_static_map_open(copy, size);
+  assert(opened != NULL);
+  check(opened);
+  assert(minimalist_static_map_open(copy, size - 8) == NULL);
+  assert(errno == EINVAL);
+  assert(minimalist_static_map_open((char *)copy + 1, size - 8) == NULL);
+  copy[0] ^= 1;
+  assert(minimalist_static_map_open(copy, size) == NULL);
+  free(copy);
+
+  map = minimalist_static_map_new(
+      (const void **)duplicates, (const void **)duplicates, 3,
+      string_size, string_size);
+  assert(map == NULL && errno == EINVAL);
+  map = minimalist_static_map_new(NULL, NULL, 0, string_size, string_size);
+  assert(map != NULL);
+  assert(minimalist_static_map_size(map) == 0);
+  assert(minimalist_static_map_get(map, "a", 1, NULL) == NULL);
+  assert(minimalist_static_map_write_c(map, "unused.c", "not valid") == -1);
+  minimalist_static_map_free(map);
+
+  /* Generated tables are usable as they are */
+  assert(minimalist_static_map_size(test_static_table) == 6);
+  value = minimalist_static_map_get(test_static_table, "green", 5, &size);
+  assert(value != NULL && strcmp(value, "#00ff00") == 0 && size == 8);
+  value = minimalist_static_map_get(test_static_table, "empty", 5, &size);
+  assert(value != NULL && strcmp(value, "") == 0);
+  assert(minimalist_static_map_get(test_static_table, "gray", 4, NULL) ==
+         NULL);
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Generates a C source file holding a static map as const data.
+ *
+ * Usage: static_map_gen NAME INPUT OUTPUT
+ *
+ * Each line of INPUT is a key, a tab and a value. Keys are stored without
+ * their terminating NUL, and values with it, so a value can be used as a
+ * string. Lines without a tab have an empty value.
+ */
+#include <minimalist/static_map.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t
+key_size(const void *key) {
+  return strlen(key);
+}
+
+static size_t
+value_size(const void *value) {
+  return strlen(value) + 1;
+}
+
+int
+main(int argc, char **argv) {
+  struct minimalist_static_map *map = NULL;
+  const void **keys = NULL, **values = NULL;
+  size_t n = 0, capacity = 0, len = 0;
+  char *line = NULL, *tab = NULL;
+  FILE *input = NULL;
+  int status = 1;
+
+  if (argc != 4) {
+    fprintf(stderr, "usage: %s NAME INPUT OUTPUT\n", argv[0]);
+    return 1;
+  }
+  input = fopen(argv[2], "r");
+  if (input == NULL) {
+    perror(argv[2]);
+    return 1;
+  }
+  while (getline(&line, &capacity, input) >= 0) {
+    len = strcspn(line, "\r\n");
+    line[len] = '\0';
+    if (len == 0) {
+      continue;
+    }
+    keys = realloc(keys, sizeof(void *) * (n + 1));
+    values = realloc(values, sizeof(void *) * (n + 1));
+    if (keys == NULL || values == NULL) {
+      perror(argv[0]);
+      return 1;
+    }
+    tab = strchr(line, '\t');
+    if (tab != NULL) {
+      *tab = '\0';
+    }
+    keys[n] = strdup(line);
+    values[n] = strdup(tab != NULL ? tab + 1 : "");
+    if (keys[n] == NULL || values[n] == NULL) {
+      perror(argv[0]);
+      return 1;
+    }
+    n++;
+  }
+  fclose(input);
+
+  map = minimalist_static_map_new(keys, values, n, key_size, value_size);
+  if (map == NULL) {
+    fprintf(stderr,
+            "%s: %s\n",
+            argv[2],
+            errno == EINVAL   ? "duplicate keys"
+            : errno == ERANGE ? "no perfect hash found for the keys"
+                              : strerror(errno));
+  } else if (minimalist_static_map_write_c(map, argv[3], argv[1]) != 0) {
+    perror(argv[3]);
+  } else {
+    status = 0;
+  }
+  minimalist_static_map_free(map);
+  for (size_t i = 0; i < n; i++) {
+    free((void *)keys[i]);
+    free((void *)values[i]);
+  }
+  free(keys);
+  free(values);
+  free(line);
+  return status;
+}